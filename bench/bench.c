@@ -0,0 +1,466 @@
+/*
+    Copyright (c) 2023 Warren Galyen <wgalyen@mechanikadesign.com>
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+/* Includes ============================================================================= */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "proxima.h"
+
+/* Macros =============================================================================== */
+
+// clang-format off
+
+#define TARGET_FPS          60
+
+#define DEFAULT_STEP_COUNT  600
+
+#define PYRAMID_COUNT       8
+#define PYRAMID_BASE_COUNT  20
+
+#define CIRCLES_BODY_COUNT  4096
+
+#define RAIN_MAX_COUNT      2048
+#define RAIN_SPAWN_COUNT    4
+
+#define STORM_BODY_COUNT    1024
+#define STORM_RAY_COUNT     512
+
+// clang-format on
+
+/* Typedefs ============================================================================= */
+
+typedef struct _Scene {
+    const char *name;
+    float cellSize;
+    prVector2 gravity;
+    void (*init)(prWorld *w);
+    void (*update)(prWorld *w, int step);
+    int (*query)(prWorld *w);
+} Scene;
+
+typedef struct _SceneResult {
+    int bodyCount, stepCount;
+    double totalTime;
+    double p50Time, p99Time;
+    prWorldStats stats;
+    double iterationCount;
+    double candidatePairCount, contactCount;
+    double hashCellCount, allocationCount;
+    double queryTime;
+    int queryHitCount;
+} SceneResult;
+
+/* Constants ============================================================================ */
+
+static const float DELTA_TIME = 1.0f / TARGET_FPS;
+
+static const prMaterial MATERIAL_BOX = { .density = 1.0f, .friction = 0.5f };
+
+static const prMaterial MATERIAL_CIRCLE = { .density = 1.0f,
+                                            .friction = 0.35f,
+                                            .restitution = 0.1f };
+
+static const prMaterial MATERIAL_GROUND = { .density = 1.0f, .friction = 0.6f };
+
+/* Private Function Prototypes ========================================================== */
+
+static void InitPyramids(prWorld *w);
+static void InitCircles(prWorld *w);
+static void InitPolygonRain(prWorld *w);
+static void UpdatePolygonRain(prWorld *w, int step);
+static void InitRaycastStorm(prWorld *w);
+static int QueryRaycastStorm(prWorld *w);
+
+static void AddStaticBox(prWorld *w, prVector2 position, float width, float height);
+static void AddContainer(prWorld *w, float width, float height);
+static prShape *CreateRandomPolygon(prMaterial material, float radius);
+
+static SceneResult RunScene(const Scene *scene,
+                            prBroadPhaseType broadPhase,
+                            int threadCount,
+                            int stepCount);
+
+static void ReleaseWorldWithShapes(prWorld *w);
+
+static float GetRandomFloat(float min, float max);
+static int CompareTimes(const void *t1, const void *t2);
+
+/* Private Variables ==================================================================== */
+
+static uint32_t randomState;
+
+static prRay rays[STORM_RAY_COUNT];
+static prRaycastHit rayHits[STORM_RAY_COUNT];
+
+static const Scene scenes[] = {
+    { .name = "pyramids",
+      .cellSize = 2.0f,
+      .gravity = { .y = 9.8f },
+      .init = InitPyramids },
+    { .name = "circles",
+      .cellSize = 2.0f,
+      .gravity = { .y = 9.8f },
+      .init = InitCircles },
+    { .name = "polygon-rain",
+      .cellSize = 4.0f,
+      .gravity = { .y = 9.8f },
+      .init = InitPolygonRain,
+      .update = UpdatePolygonRain },
+    { .name = "raycast-storm",
+      .cellSize = 4.0f,
+      .init = InitRaycastStorm,
+      .query = QueryRaycastStorm }
+};
+
+static const char *broadPhaseNames[] = {
+    [PR_BROAD_PHASE_SPATIAL_HASH] = "spatial-hash",
+    [PR_BROAD_PHASE_PERSISTENT_SPATIAL_HASH] = "persistent-spatial-hash",
+    [PR_BROAD_PHASE_DYNAMIC_TREE] = "dynamic-tree"
+};
+
+/* Public Functions ===================================================================== */
+
+int main(int argc, char *argv[]) {
+    prBroadPhaseType broadPhase = PR_BROAD_PHASE_PERSISTENT_SPATIAL_HASH;
+
+    int threadCount = 1, stepCount = DEFAULT_STEP_COUNT;
+
+    const char *sceneName = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-n") == 0 && i + 1 < argc) {
+            stepCount = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-t") == 0 && i + 1 < argc) {
+            threadCount = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-b") == 0 && i + 1 < argc) {
+            const char *name = argv[++i];
+
+            int j = 0;
+
+            for (; j < (int) (sizeof broadPhaseNames / sizeof *broadPhaseNames);
+                 j++)
+                if (strcmp(name, broadPhaseNames[j]) == 0) break;
+
+            if (j == (int) (sizeof broadPhaseNames / sizeof *broadPhaseNames)) {
+                fprintf(stderr, "bench: unknown broad phase '%s'\n", name);
+
+                return 1;
+            }
+
+            broadPhase = j;
+        } else if (argv[i][0] != '-' && sceneName == NULL) {
+            sceneName = argv[i];
+        } else {
+            fprintf(stderr,
+                    "usage: %s [-n steps] [-t threads] "
+                    "[-b spatial-hash|persistent-spatial-hash|dynamic-tree] "
+                    "[scene]\n",
+                    argv[0]);
+
+            return 1;
+        }
+    }
+
+    if (stepCount <= 0) stepCount = DEFAULT_STEP_COUNT;
+
+    bool found = false;
+
+    for (int i = 0; i < (int) (sizeof scenes / sizeof *scenes); i++) {
+        if (sceneName != NULL && strcmp(sceneName, scenes[i].name) != 0)
+            continue;
+
+        found = true;
+
+        randomState = 0x2545F491;
+
+        const SceneResult result = RunScene(&scenes[i],
+                                            broadPhase,
+                                            threadCount,
+                                            stepCount);
+
+        const double inverseStepCount = 1000.0 / result.stepCount;
+
+        // NOTE: Each scene is reported as a single line of JSON.
+        printf("{\"scene\":\"%s\",\"broad_phase\":\"%s\",\"threads\":%d,"
+               "\"bodies\":%d,\"steps\":%d,\"seconds\":%.6f,"
+               "\"steps_per_sec\":%.3f,\"p50_ms\":%.6f,\"p99_ms\":%.6f,"
+               "\"broad_phase_ms\":%.6f,\"narrow_phase_ms\":%.6f,"
+               "\"warm_start_ms\":%.6f,\"solve_ms\":%.6f,"
+               "\"integrate_ms\":%.6f,\"iterations\":%.3f,"
+               "\"pairs\":%.3f,\"contacts\":%.3f,\"hash_cells\":%.3f,"
+               "\"allocations\":%.3f,"
+               "\"raycast_ms\":%.6f,\"raycast_hits\":%d}\n",
+               scenes[i].name,
+               broadPhaseNames[broadPhase],
+               threadCount,
+               result.bodyCount,
+               result.stepCount,
+               result.totalTime,
+               result.stepCount / result.totalTime,
+               1000.0 * result.p50Time,
+               1000.0 * result.p99Time,
+               result.stats.broadPhaseTime * inverseStepCount,
+               result.stats.narrowPhaseTime * inverseStepCount,
+               result.stats.warmStartTime * inverseStepCount,
+               result.stats.solveTime * inverseStepCount,
+               result.stats.integrateTime * inverseStepCount,
+               result.iterationCount / result.stepCount,
+               result.candidatePairCount / result.stepCount,
+               result.contactCount / result.stepCount,
+               result.hashCellCount / result.stepCount,
+               result.allocationCount / result.stepCount,
+               result.queryTime * inverseStepCount,
+               result.queryHitCount);
+
+        fflush(stdout);
+    }
+
+    if (!found) {
+        fprintf(stderr, "bench: unknown scene '%s'\n", sceneName);
+
+        return 1;
+    }
+
+    return 0;
+}
+
+/* Private Functions ==================================================================== */
+
+static void InitPyramids(prWorld *w) {
+    AddStaticBox(w, (prVector2) { .y = 1.0f }, 400.0f, 2.0f);
+
+    for (int i = 0; i < PYRAMID_COUNT; i++) {
+        const float offsetX = (i - 0.5f * PYRAMID_COUNT) * (PYRAMID_BASE_COUNT + 4.0f);
+
+        for (int j = 0; j < PYRAMID_BASE_COUNT; j++) {
+            for (int k = 0; k < PYRAMID_BASE_COUNT - j; k++) {
+                const prVector2 position = { .x = offsetX + k + 0.5f * j,
+                                             .y = -0.5f - j };
+
+                prAddBodyToWorld(w,
+                                 prCreateBodyFromShape(
+                                     PR_BODY_DYNAMIC,
+                                     position,
+                                     prCreateRectangle(MATERIAL_BOX,
+                                                       1.0f,
+                                                       1.0f)));
+            }
+        }
+    }
+}
+
+static void InitCircles(prWorld *w) {
+    AddContainer(w, 72.0f, 128.0f);
+
+    // NOTE: The container has 3 static bodies, and the rest are circles.
+    const int circleCount = CIRCLES_BODY_COUNT - 3;
+
+    for (int i = 0; i < circleCount; i++) {
+        const prVector2 position = {
+            .x = -34.65f + 1.1f * (i % 64) + ((i / 64) % 2) * 0.25f,
+            .y = -1.0f - 1.1f * (i / 64)
+        };
+
+        prAddBodyToWorld(w,
+                         prCreateBodyFromShape(PR_BODY_DYNAMIC,
+                                               position,
+                                               prCreateCircle(MATERIAL_CIRCLE,
+                                                              0.5f)));
+    }
+}
+
+static void InitPolygonRain(prWorld *w) {
+    AddContainer(w, 96.0f, 128.0f);
+}
+
+static void UpdatePolygonRain(prWorld *w, int step) {
+    for (int i = 0; i < RAIN_SPAWN_COUNT; i++) {
+        if (prGetBodyCountForWorld(w) >= RAIN_MAX_COUNT) return;
+
+        prBody *b = prCreateBodyFromShape(
+            PR_BODY_DYNAMIC,
+            (prVector2) { .x = GetRandomFloat(-44.0f, 44.0f),
+                          .y = GetRandomFloat(-48.0f, -32.0f) },
+            CreateRandomPolygon(MATERIAL_BOX, GetRandomFloat(0.4f, 1.0f)));
+
+        prSetBodyAngle(b, GetRandomFloat(0.0f, 2.0f * M_PI));
+
+        prAddBodyToWorld(w, b);
+    }
+}
+
+static void InitRaycastStorm(prWorld *w) {
+    for (int i = 0; i < STORM_BODY_COUNT; i++) {
+        const prVector2 position = { .x = GetRandomFloat(-64.0f, 64.0f),
+                                     .y = GetRandomFloat(-64.0f, 64.0f) };
+
+        prShape *s = (i % 2 == 0)
+                         ? prCreateCircle(MATERIAL_CIRCLE,
+                                          GetRandomFloat(0.25f, 1.0f))
+                         : CreateRandomPolygon(MATERIAL_BOX,
+                                               GetRandomFloat(0.25f, 1.0f));
+
+        prAddBodyToWorld(w, prCreateBodyFromShape(PR_BODY_STATIC, position, s));
+    }
+}
+
+static int QueryRaycastStorm(prWorld *w) {
+    for (int i = 0; i < STORM_RAY_COUNT; i++) {
+        const float angle = GetRandomFloat(0.0f, 2.0f * M_PI);
+
+        rays[i] = (prRay) { .origin = { .x = GetRandomFloat(-64.0f, 64.0f),
+                                        .y = GetRandomFloat(-64.0f, 64.0f) },
+                            .direction = { .x = cosf(angle), .y = sinf(angle) },
+                            .maxDistance = 64.0f };
+    }
+
+    return prComputeRaycastsForWorld(w,
+                                     rays,
+                                     STORM_RAY_COUNT,
+                                     PR_RAYCAST_CLOSEST,
+                                     rayHits);
+}
+
+static void AddStaticBox(prWorld *w, prVector2 position, float width, float height) {
+    prAddBodyToWorld(w,
+                     prCreateBodyFromShape(PR_BODY_STATIC,
+                                           position,
+                                           prCreateRectangle(MATERIAL_GROUND,
+                                                             width,
+                                                             height)));
+}
+
+static void AddContainer(prWorld *w, float width, float height) {
+    AddStaticBox(w, (prVector2) { .y = 1.0f }, width + 4.0f, 2.0f);
+
+    AddStaticBox(w,
+                 (prVector2) { .x = -0.5f * width - 1.0f, .y = -0.5f * height },
+                 2.0f,
+                 height);
+    AddStaticBox(w,
+                 (prVector2) { .x = 0.5f * width + 1.0f, .y = -0.5f * height },
+                 2.0f,
+                 height);
+}
+
+static prShape *CreateRandomPolygon(prMaterial material, float radius) {
+    prVertices vertices = { .count = 3 + (int) GetRandomFloat(0.0f, 5.99f) };
+
+    for (int i = 0; i < vertices.count; i++) {
+        const float angle = (2.0f * M_PI * i) / vertices.count;
+
+        vertices.data[i] = (prVector2) { .x = radius * cosf(angle),
+                                         .y = radius * sinf(angle) };
+    }
+
+    return prCreatePolygon(material, &vertices);
+}
+
+static SceneResult RunScene(const Scene *scene,
+                            prBroadPhaseType broadPhase,
+                            int threadCount,
+                            int stepCount) {
+    SceneResult result = { .stepCount = stepCount };
+
+    prWorld *w = prCreateWorldFromConfig(
+        (prWorldConfig) { .gravity = scene->gravity,
+                          .cellSize = scene->cellSize,
+                          .broadPhase = broadPhase,
+                          .threadCount = threadCount });
+
+    scene->init(w);
+
+    double *stepTimes = malloc(stepCount * sizeof *stepTimes);
+
+    for (int i = 0; i < stepCount; i++) {
+        // NOTE: Spawning new bodies is not included in the step time.
+        if (scene->update != NULL) scene->update(w, i);
+
+        const double startTime = prGetCurrentTime();
+
+        prStepWorld(w, DELTA_TIME);
+
+        const double stepTime = prGetCurrentTime();
+
+        if (scene->query != NULL) result.queryHitCount += scene->query(w);
+
+        const double endTime = prGetCurrentTime();
+
+        // NOTE: The queries are timed separately from the step itself.
+        stepTimes[i] = stepTime - startTime;
+
+        result.totalTime += stepTimes[i];
+        result.queryTime += endTime - stepTime;
+
+        const prWorldStats stats = prGetWorldStats(w);
+
+        result.stats.broadPhaseTime += stats.broadPhaseTime;
+        result.stats.narrowPhaseTime += stats.narrowPhaseTime;
+        result.stats.warmStartTime += stats.warmStartTime;
+        result.stats.solveTime += stats.solveTime;
+        result.stats.integrateTime += stats.integrateTime;
+
+        result.iterationCount += stats.iterationCount;
+
+        result.candidatePairCount += stats.candidatePairCount;
+        result.contactCount += stats.contactCount;
+        result.hashCellCount += stats.hashCellCount;
+        result.allocationCount += stats.allocationCount;
+    }
+
+    qsort(stepTimes, stepCount, sizeof *stepTimes, CompareTimes);
+
+    result.p50Time = stepTimes[(stepCount - 1) / 2];
+    result.p99Time = stepTimes[((stepCount - 1) * 99) / 100];
+
+    result.bodyCount = prGetBodyCountForWorld(w);
+
+    free(stepTimes);
+
+    ReleaseWorldWithShapes(w);
+
+    return result;
+}
+
+static void ReleaseWorldWithShapes(prWorld *w) {
+    for (int i = 0; i < prGetBodyCountForWorld(w); i++)
+        prReleaseShape(prGetBodyShape(prGetBodyFromWorld(w, i)));
+
+    prReleaseWorld(w);
+}
+
+static float GetRandomFloat(float min, float max) {
+    // NOTE: Xorshift32, so that each scene is the same on every platform.
+    randomState ^= randomState << 13;
+    randomState ^= randomState >> 17;
+    randomState ^= randomState << 5;
+
+    return min + (max - min) * ((randomState >> 8) * (1.0f / 16777216.0f));
+}
+
+static int CompareTimes(const void *t1, const void *t2) {
+    const double time1 = *(const double *) t1, time2 = *(const double *) t2;
+
+    return (time1 > time2) - (time1 < time2);
+}
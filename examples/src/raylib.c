@@ -214,9 +214,7 @@ static void UpdateExample(void) {
         const Font font = GetFontDefault();
 
         DrawTextEx(font,
-                   TextFormat("%d/%d bodies",
-                              prGetBodyCountForWorld(world),
-                              PR_WORLD_MAX_OBJECT_COUNT),
+                   TextFormat("%d bodies", prGetBodyCountForWorld(world)),
                    (Vector2) { .x = 8.0f, .y = 32.0f },
                    font.baseSize,
                    2.0f,
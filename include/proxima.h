@@ -40,26 +40,38 @@ extern "C" {
 
 // clang-format off
 
+/* Defines the margin of each enlarged AABB in a dynamic AABB tree. */
+#define PR_BROAD_PHASE_AABB_MARGIN        0.1f
+
 /* Defines the maximum number of vertices for a convex polygon. */
-#define PR_GEOMETRY_MAX_VERTEX_COUNT  8
+#define PR_GEOMETRY_MAX_VERTEX_COUNT      8
 
 /* Defines how many pixels represent a unit of length (meter). */
-#define PR_GEOMETRY_PIXELS_PER_UNIT   16.0f
+#define PR_GEOMETRY_PIXELS_PER_UNIT       16.0f
 
 /* Defines the 'bias factor' for the Baumgarte stabilization scheme. */
-#define PR_WORLD_BAUMGARTE_FACTOR     0.24f
+#define PR_WORLD_BAUMGARTE_FACTOR         0.24f
 
 /* Defines the 'slop' for the Baumgarte stabilization scheme. */
-#define PR_WORLD_BAUMGARTE_SLOP       0.01f
+#define PR_WORLD_BAUMGARTE_SLOP           0.01f
 
 /* Defines the default gravity acceleration vector for a world. */
-#define PR_WORLD_DEFAULT_GRAVITY      ((prVector2) { .y = 9.8f })
+#define PR_WORLD_DEFAULT_GRAVITY          ((prVector2) { .y = 9.8f })
+
+/* Defines the default iteration count for the constraint solver. */
+#define PR_WORLD_ITERATION_COUNT          10
+
+/* Defines the default maximum number of steps for each call to `prUpdateWorld()`. */
+#define PR_WORLD_MAX_STEP_COUNT           8
 
-/* Defines the iteration count for the constraint solver. */
-#define PR_WORLD_ITERATION_COUNT      10
+/* Defines the default linear speed threshold for a body to fall asleep. */
+#define PR_WORLD_SLEEP_LINEAR_THRESHOLD   0.05f
 
-/* Defines the maximum number of objects in a world. */
-#define PR_WORLD_MAX_OBJECT_COUNT     4096
+/* Defines the default angular speed threshold for a body to fall asleep. */
+#define PR_WORLD_SLEEP_ANGULAR_THRESHOLD  0.035f
+
+/* Defines the default time for a body to rest before it falls asleep, in seconds. */
+#define PR_WORLD_TIME_TO_SLEEP            0.5f
 
 // clang-format on
 
@@ -77,9 +89,60 @@ extern "C" {
     #define PR_API_INLINE inline
 #endif
 
+#ifdef _MSC_VER
+    #define PR_API_THREAD_LOCAL __declspec(thread)
+#else
+    #define PR_API_THREAD_LOCAL __thread
+#endif
+
+/* 
+    Defines an integer type that can be shared between threads, along with
+    the macros that atomically increment (or decrement) the integer at the given address,
+    then return its new value.
+*/
+#if defined(PR_DISABLE_THREADS)
+    #define PR_API_ATOMIC_INT            int
+    #define PR_API_ATOMIC_INCREMENT(p)   (++*(p))
+    #define PR_API_ATOMIC_DECREMENT(p)   (--*(p))
+#elif defined(_MSC_VER)
+    #include <intrin.h>
+
+    #define PR_API_ATOMIC_INT            volatile long
+    #define PR_API_ATOMIC_INCREMENT(p)   _InterlockedIncrement(p)
+    #define PR_API_ATOMIC_DECREMENT(p)   _InterlockedDecrement(p)
+#elif defined(__STDC_VERSION__) && (__STDC_VERSION__ >= 201112L) \
+    && !defined(__STDC_NO_ATOMICS__)
+    #include <stdatomic.h>
+
+    #define PR_API_ATOMIC_INT            _Atomic int
+    #define PR_API_ATOMIC_INCREMENT(p)   (atomic_fetch_add((p), 1) + 1)
+    #define PR_API_ATOMIC_DECREMENT(p)   (atomic_fetch_sub((p), 1) - 1)
+#else
+    #define PR_API_ATOMIC_INT            int
+    #define PR_API_ATOMIC_INCREMENT(p)   __atomic_add_fetch((p), 1, __ATOMIC_ACQ_REL)
+    #define PR_API_ATOMIC_DECREMENT(p)   __atomic_sub_fetch((p), 1, __ATOMIC_ACQ_REL)
+#endif
+
 /* Empty-initializes the given object. */
 #define PR_API_STRUCT_ZERO(T) ((T) { 0 })
 
+/* 
+    Evaluates the given expressions, which update the profiling counters,
+    unless `PR_DISABLE_STATS` is defined.
+*/
+#ifdef PR_DISABLE_STATS
+    #define PR_API_STATS(...) ((void) 0)
+#else
+    #define PR_API_STATS(...) ((void) (__VA_ARGS__))
+#endif
+
+// NOTE: Threads are not available on the Web, unless built with `-pthread`.
+#if defined(__EMSCRIPTEN__) && !defined(__EMSCRIPTEN_PTHREADS__)
+    #ifndef PR_DISABLE_THREADS
+        #define PR_DISABLE_THREADS
+    #endif
+#endif
+
 /* Typedefs ============================================================================= */
 
 /* A structure that represents a two-dimensional vector. */
@@ -104,6 +167,30 @@ typedef struct _prBody prBody;
 /* A structure that represents a simulation container. */
 typedef struct _prWorld prWorld;
 
+/* (From 'allocator.c') ================================================================= */
+
+/* 
+    A structure that represents a set of memory allocation functions,
+    which receive `ctx` as their last argument.
+*/
+typedef struct _prAllocator {
+    void *(*allocate)(size_t size, void *ctx);
+    void *(*reallocate)(void *ptr, size_t size, void *ctx);
+    void (*release)(void *ptr, void *ctx);
+    void *ctx;
+} prAllocator;
+
+/* 
+    A structure that represents a pool of fixed-size memory blocks, 
+    which are allocated in chunks of blocks.
+*/
+typedef struct _prPool {
+    size_t blockSize;
+    void *freeList, *chunks;
+    struct _prPool *next;
+    bool registered;
+} prPool;
+
 /* (From 'broad-phase.c') =============================================================== */
 
 /* A structure that represents a spatial hash. */
@@ -112,6 +199,18 @@ typedef struct _prSpatialHash prSpatialHash;
 /* A callback function type for `prQuerySpatialHash()`. */
 typedef bool (*prHashQueryFunc)(int index, void *ctx);
 
+/* 
+    A callback function type for `prRaycastSpatialHash()` and `prRaycastDynamicTree()`,
+    which returns the new maximum distance of the ray (or `0.0f` to stop the query).
+*/
+typedef float (*prHashRaycastFunc)(int index, void *ctx);
+
+/* A callback function type for `prQuerySpatialHashPairs()`. */
+typedef bool (*prHashPairQueryFunc)(int firstIndex, int secondIndex, void *ctx);
+
+/* A structure that represents a dynamic AABB (bounding volume) tree. */
+typedef struct _prDynamicTree prDynamicTree;
+
 /* (From 'collision.c') ================================================================= */
 
 /* A structure that represents the contact points of two colliding bodies. */
@@ -153,7 +252,9 @@ typedef struct _prRaycastHit {
 typedef enum _prShapeType {
     PR_SHAPE_UNKNOWN,
     PR_SHAPE_CIRCLE,
-    PR_SHAPE_POLYGON
+    PR_SHAPE_POLYGON,
+    PR_SHAPE_CHAIN,
+    PR_SHAPE_COMPOUND
 } prShapeType;
 
 /* A structure that represents the physical quantities of a collision shape. */
@@ -183,12 +284,43 @@ typedef enum _prBodyType {
 typedef enum prBodyFlag {
     PR_FLAG_NONE,
     PR_FLAG_INFINITE_MASS,
-    PR_FLAG_INFINITE_INERTIA
+    PR_FLAG_INFINITE_INERTIA,
+    PR_FLAG_BULLET = 4,
+    PR_FLAG_SENSOR = 8
 } prBodyFlag;
 
 /* A data type that represents the property flags of a rigid body. */
 typedef uint_fast8_t prBodyFlags;
 
+/* 
+    A structure that represents the collision filter of a rigid body.
+    Two bodies in the same nonzero `group` always collide if the group is positive,
+    and never collide if it is negative; otherwise, each body must have a `category`
+    bit in the `mask` of the other. (The default category is `1`, in a mask of `~0`.)
+*/
+typedef struct _prCollisionFilter {
+    uint32_t category, mask;
+    int32_t group;
+} prCollisionFilter;
+
+/* 
+    A structure that represents the simulation state of a rigid body, without its shape
+    (but with its previous transform, for interpolation).
+*/
+typedef struct _prBodyState {
+    prVector2 position;
+    float angle;
+    prVector2 previousPosition;
+    float previousAngle;
+    prVector2 velocity;
+    float angularVelocity;
+    prVector2 force;
+    float torque;
+    float gravityScale;
+    float sleepTime;
+    uint32_t sleeping;
+} prBodyState;
+
 /*
     A structure that represents the position of an object in meters,
     the rotation data of an object and the angle of an object in radians.
@@ -206,8 +338,74 @@ typedef struct _prBodyPair {
     prBody *first, *second;
 } prBodyPair;
 
+/* 
+    A structure that represents the motion data of multiple rigid bodies,
+    stored as a structure of arrays.
+*/
+typedef struct _prBodyStorage {
+    prBodyType *types;
+    bool *sleeping;
+    float *positionX, *positionY, *angles;
+    float *velocityX, *velocityY, *angularVelocities;
+    float *forceX, *forceY, *torques;
+    float *masses, *inverseMasses, *inverseInertias, *gravityScales;
+    int count;
+} prBodyStorage;
+
+/* A structure that represents a contact constraint between two bodies in a body storage. */
+typedef struct _prContactConstraint {
+    int first, second;
+    prCollision *collision;
+} prContactConstraint;
+
+/* A structure that represents the scratch memory of the contact constraint solver. */
+typedef struct _prSolverBuffer {
+    int *lastBatches;
+    int *batchLanes, *batchSizes;
+} prSolverBuffer;
+
+/* (From 'thread-pool.c') =============================================================== */
+
+/* A structure that represents a pool of worker threads. */
+typedef struct _prThreadPool prThreadPool;
+
+/* 
+    A callback function type for `prRunThreadPool()`, 
+    which will be called for the range `[start, end)` on the thread with `threadIndex`.
+*/
+typedef void (*prThreadPoolFunc)(int start, int end, int threadIndex, void *ctx);
+
 /* (From 'world.c') ===================================================================== */
 
+/* An enumeration that represents the type of the broad-phase algorithm of a world. */
+typedef enum _prBroadPhaseType {
+    PR_BROAD_PHASE_SPATIAL_HASH,
+    PR_BROAD_PHASE_PERSISTENT_SPATIAL_HASH,
+    PR_BROAD_PHASE_DYNAMIC_TREE
+} prBroadPhaseType;
+
+/* A structure that represents the configuration of a world. */
+typedef struct _prWorldConfig {
+    prVector2 gravity;
+    float cellSize;
+    prBroadPhaseType broadPhase;
+    int threadCount;
+    int maxStepCount, subStepCount;
+    int iterationCount;
+    float solverTolerance;
+    bool deterministic;
+    prAllocator allocator;
+} prWorldConfig;
+
+/* 
+    A structure that represents a handle to a rigid body in a world,
+    which becomes invalid once the body is removed from the world.
+*/
+typedef struct _prBodyHandle {
+    int index;
+    uint32_t generation;
+} prBodyHandle;
+
 /* A callback function type for a collision event. */
 typedef void (*prCollisionEventFunc)(prBodyPair key, prCollision *value);
 
@@ -219,31 +417,248 @@ typedef struct _prCollisionHandler {
 /* A callback function type for `prComputeRaycastForWorld()`. */
 typedef void (*prRaycastQueryFunc)(prRaycastHit raycastHit);
 
+/* An enumeration that represents the mode of `prComputeRaycastsForWorld()`. */
+typedef enum _prRaycastMode {
+    PR_RAYCAST_CLOSEST,
+    PR_RAYCAST_ANY
+} prRaycastMode;
+
+/* A structure that represents the information about a shape cast hit. */
+typedef struct _prShapeCastHit {
+    prBody *body;
+    prVector2 point;
+    prVector2 normal;
+    float fraction;
+} prShapeCastHit;
+
+/* 
+    A structure that represents the time spent on each phase of a step, in seconds,
+    the number of iterations the constraint solver needed in that step, 
+    and the profiling counters of that step (which are all zero 
+    if `PR_DISABLE_STATS` is defined).
+*/
+typedef struct _prWorldStats {
+    double broadPhaseTime;
+    double narrowPhaseTime;
+    double warmStartTime;
+    double solveTime;
+    double integrateTime;
+    int iterationCount;
+    int candidatePairCount, contactCount;
+    int hashCellCount, allocationCount;
+} prWorldStats;
+
+/* 
+    A structure that represents the sensor events of the last step of a world, 
+    where each event pairs a sensor body (`first`) and the body touching it (`second`).
+*/
+typedef struct _prSensorEvents {
+    const prBodyPair *beginEvents, *endEvents;
+    int beginCount, endCount;
+} prSensorEvents;
+
+/* 
+    A structure that represents a contact between two bodies in the last step of a world,
+    with the normal and tangent impulses applied at each contact point 
+    in the last iteration of the constraint solver.
+*/
+typedef struct _prContactInfo {
+    prBodyHandle first, second;
+    prVector2 normal;
+    struct {
+        prVector2 point;
+        float depth;
+        float normalImpulse, tangentImpulse;
+    } points[2];
+    int count;
+} prContactInfo;
+
+/* A structure that represents the contacts of the last step of a world. */
+typedef struct _prWorldContacts {
+    const prContactInfo *contacts;
+    int count;
+} prWorldContacts;
+
+/* 
+    A structure that represents the transforms of the bodies of a world 
+    at the end of its last step, in the same order as `prGetBodyFromWorld()`.
+*/
+typedef struct _prWorldTransforms {
+    const prBodyHandle *handles;
+    const prTransform *transforms;
+    int count;
+} prWorldTransforms;
+
 /* Public Function Prototypes =========================================================== */
 
+/* (From 'allocator.c') ================================================================= */
+
+/* Returns the allocator used when no other allocator has been given. */
+prAllocator prGetDefaultAllocator(void);
+
+/* 
+    Sets the allocator used when no other allocator has been given,
+    or restores the standard library functions if any function of `a` is `NULL`.
+    (This function must be called before anything else is created.)
+*/
+void prSetDefaultAllocator(prAllocator a);
+
+/* 
+    Makes `a` the allocator for new memory on the calling thread 
+    (or the default allocator if `a` is `NULL`), then returns the previous one.
+*/
+const prAllocator *prSetCurrentAllocator(const prAllocator *a);
+
+/* Returns the allocator for new memory on the calling thread. */
+const prAllocator *prGetCurrentAllocator(void);
+
+/* Allocates a zero-initialized block of `size` bytes with the current allocator. */
+void *prAllocateMemory(size_t size);
+
+/* 
+    Resizes the block at `ptr` to `size` bytes with the allocator 
+    that allocated it (or allocates a new block if `ptr` is `NULL`).
+*/
+void *prReallocateMemory(void *ptr, size_t size);
+
+/* Releases the block at `ptr` with the allocator that allocated it. */
+void prReleaseMemory(void *ptr);
+
+/* 
+    Returns the number of blocks allocated (or resized) on the calling thread so far,
+    or `0` if `PR_DISABLE_STATS` is defined.
+*/
+size_t prGetAllocationCount(void);
+
+/* 
+    Takes a zero-initialized block from `p`, allocating more blocks
+    with the default allocator if `p` has run out of blocks.
+    (The blocks of a pool may outlive any world, so they never come from 
+    the current allocator; use `prSetDefaultAllocator()` to choose their allocator.)
+*/
+void *prAllocateFromPool(prPool *p);
+
+/* Returns the block at `ptr` to `p`. */
+void prReleaseToPool(prPool *p, void *ptr);
+
+/* Releases each chunk of blocks of `p` whose blocks are all unused. */
+void prTrimPool(prPool *p);
+
+/* 
+    Calls `prTrimPool()` for each pool that first allocated a chunk of blocks 
+    on the calling thread, including the pools of bodies and shapes.
+    (A thread that created bodies or shapes should call this function before it exits.)
+*/
+void prTrimPools(void);
+
 /* (From 'broad-phase.c') =============================================================== */
 
 /* Creates a new spatial hash with the given `cellSize`. */
 prSpatialHash *prCreateSpatialHash(float cellSize);
 
+/* 
+    Creates a new spatial hash with the given `cellSize`, which keeps its elements
+    across steps and only moves the elements whose range of cells has changed.
+*/
+prSpatialHash *prCreatePersistentSpatialHash(float cellSize);
+
 /* Releases the memory allocated for `sh`. */
 void prReleaseSpatialHash(prSpatialHash *sh);
 
 /* Return the cell size of `sh`. */
 float prGetSpatialHashCellSize(const prSpatialHash *sh);
 
+/* Returns `true` if `sh` keeps its elements across steps. */
+bool prIsSpatialHashPersistent(const prSpatialHash *sh);
+
+/* 
+    Returns the number of times a cell of `sh` has been updated (or visited 
+    by a query) so far, or `0` if `PR_DISABLE_STATS` is defined.
+*/
+size_t prGetSpatialHashTouchCount(const prSpatialHash *sh);
+
 /* Erases all elements prom `sh`. */
 void prClearSpatialHash(prSpatialHash *sh);
 
 /* Inserts a `key`-`value` pair into `sh`. */
 void prInsertToSpatialHash(prSpatialHash *sh, prAABB key, int value);
 
+/* 
+    Updates the `key` of `value` in `sh`, assuming `sh` is a persistent spatial hash.
+    (If `sh` is not persistent, this function will behave like `prInsertToSpatialHash()`.)
+*/
+void prUpdateSpatialHash(prSpatialHash *sh, prAABB key, int value);
+
+/* Removes `value` from `sh`, assuming `sh` is a persistent spatial hash. */
+void prRemoveFromSpatialHash(prSpatialHash *sh, int value);
+
 /* Query `sh` for any objects that overlap the given `aabb`. */
 void prQuerySpatialHash(prSpatialHash *sh,
                         prAABB aabb,
                         prHashQueryFunc func,
                         void *ctx);
 
+/* 
+    Query `sh` for any objects that are likely to intersect the given `ray`,
+    visiting the cells along `ray` in order until `func` returns a distance
+    shorter than the distance to the next cell.
+*/
+void prRaycastSpatialHash(prSpatialHash *sh,
+                          prRay ray,
+                          prHashRaycastFunc func,
+                          void *ctx);
+
+/* 
+    Query `sh` for all pairs of objects that are likely to overlap each other,
+    then calls `func` exactly once for each pair.
+*/
+void prQuerySpatialHashPairs(prSpatialHash *sh,
+                             prHashPairQueryFunc func,
+                             void *ctx);
+
+/* 
+    Creates a new dynamic AABB tree, which stores the AABB of each value
+    enlarged by `margin` in order to avoid updating the tree on small movements.
+*/
+prDynamicTree *prCreateDynamicTree(float margin);
+
+/* Releases the memory allocated for `dt`. */
+void prReleaseDynamicTree(prDynamicTree *dt);
+
+/* Erases all elements prom `dt`. */
+void prClearDynamicTree(prDynamicTree *dt);
+
+/* Returns the AABB margin of `dt`. */
+float prGetDynamicTreeMargin(const prDynamicTree *dt);
+
+/* Returns the enlarged AABB of `value` in `dt`, or an empty AABB if there is none. */
+prAABB prGetDynamicTreeAABB(const prDynamicTree *dt, int value);
+
+/* 
+    Inserts `value` into `dt` with the given `key`, or updates the `key` of `value`
+    if `value` is already in `dt`, but only if `key` is no longer contained 
+    in its enlarged AABB, then returns `true` if the enlarged AABB of `value` changed.
+*/
+bool prUpdateDynamicTree(prDynamicTree *dt, prAABB key, int value);
+
+/* Removes `value` from `dt`. */
+void prRemoveFromDynamicTree(prDynamicTree *dt, int value);
+
+/* Query `dt` for any objects that are likely to overlap the given `aabb`. */
+void prQueryDynamicTree(prDynamicTree *dt,
+                        prAABB aabb,
+                        prHashQueryFunc func,
+                        void *ctx);
+
+/* 
+    Query `dt` for any objects that are likely to intersect the given `ray`,
+    shortening `ray` to the distance returned by `func` for each object.
+*/
+void prRaycastDynamicTree(prDynamicTree *dt,
+                          prRay ray,
+                          prHashRaycastFunc func,
+                          void *ctx);
+
 /* (From 'collision.c') ================================================================= */
 
 /*
@@ -256,6 +671,37 @@ bool prComputeCollision(const prShape *s1,
                         prTransform tx2,
                         prCollision *collision);
 
+/* 
+    Checks whether the collision shapes of `b1` and `b2` are colliding,
+    using the world-space vertices and normals cached in `b1` and `b2`,
+    then stores the collision information to `collision`.
+*/
+bool prComputeBodyCollision(const prBody *b1,
+                            const prBody *b2,
+                            prCollision *collision);
+
+/* 
+    Checks whether the collision shapes of `b1` and `b2` are colliding like
+    `prComputeBodyCollision()`, but if both shapes are polygons, tests the axis 
+    at `axis` first (if it is not `-1`), then stores the axis that separates 
+    (or least penetrates) the polygons to `axis`.
+*/
+bool prComputeBodyCollisionWithAxis(const prBody *b1,
+                                    const prBody *b2,
+                                    prCollision *collision,
+                                    int *axis);
+
+/*
+    Checks whether the collision shapes of `b1` and `b2` are colliding like
+    `prComputeBodyCollision()`, but only between the child of the first shape 
+    at `child / n` and the child of the second shape at `child % n`, 
+    where `n` is `prGetShapeChildCount()` of the second shape.
+*/
+bool prComputeBodyCollisionWithChild(const prBody *b1,
+                                     const prBody *b2,
+                                     int child,
+                                     prCollision *collision);
+
 /* Casts a `ray` against `b`. */
 bool prComputeRaycast(const prBody *b, prRay ray, prRaycastHit *raycastHit);
 
@@ -270,7 +716,37 @@ prShape *prCreateRectangle(prMaterial material, float width, float height);
 /* Creates a 'convex polygon' collision shape. */
 prShape *prCreatePolygon(prMaterial material, const prVertices *vertices);
 
-/* Releases the memory allocated for `s`. */
+/* 
+    Creates a 'chain' collision shape, which is a series of line segments
+    connecting `count` `vertices` (and the last vertex to the first one
+    if `loop` is `true`) without any area. (It is meant for static bodies.)
+*/
+prShape *prCreateChain(prMaterial material,
+                       const prVector2 *vertices,
+                       int count,
+                       bool loop);
+
+/* 
+    Creates a 'compound' collision shape, which is made of `count` 'circle'
+    or 'polygon' collision `shapes`, each placed at its own local `offsets`, 
+    adding a reference to each shape. (Only the position and the angle 
+    of each offset are used, and `material` is used for the whole shape.)
+*/
+prShape *prCreateCompound(prMaterial material,
+                          prShape **shapes,
+                          const prTransform *offsets,
+                          int count);
+
+/* 
+    Adds a reference to `s`, so that `s` stays alive until 
+    a matching call to `prReleaseShape()`, then returns `s`.
+*/
+prShape *prRetainShape(prShape *s);
+
+/* 
+    Removes a reference from `s`, then releases the memory allocated for `s`
+    if there are no references left.
+*/
 void prReleaseShape(prShape *s);
 
 /* Returns the type of `s`. */
@@ -297,9 +773,25 @@ float prGetShapeMass(const prShape *s);
 /* Returns the moment of inertia of `s`. */
 float prGetShapeInertia(const prShape *s);
 
+/* Returns the mass of `s` with the given `density`, ignoring the material of `s`. */
+float prComputeShapeMass(const prShape *s, float density);
+
+/* 
+    Returns the moment of inertia of `s` with the given `density`,
+    ignoring the material of `s`.
+*/
+float prComputeShapeInertia(const prShape *s, float density);
+
 /* Returns the AABB (Axis-Aligned Bounding Box) of `s`. */
 prAABB prGetShapeAABB(const prShape *s, prTransform tx);
 
+/* 
+    Returns the number of children of `s`, which is the number of line segments 
+    of a 'chain' collision shape, the number of shapes of a 'compound' 
+    collision shape, or `1` for any other collision shape.
+*/
+int prGetShapeChildCount(const prShape *s);
+
 /* Returns the radius of `s`, assuming `s` is a 'circle' collision shape. */
 float prGetCircleRadius(const prShape *s);
 
@@ -321,6 +813,67 @@ prVector2 prGetPolygonNormal(const prShape *s, int index);
 /* Returns the normals of `s`, assuming `s` is a 'polygon' collision shape. */
 const prVertices *prGetPolygonNormals(const prShape *s);
 
+/* 
+    Transforms the vertices and normals of `s` through `tx`, then stores them
+    to `vertices` and `normals`, assuming `s` is a 'polygon' collision shape.
+*/
+void prTransformPolygon(const prShape *s,
+                        prTransform tx,
+                        prVertices *vertices,
+                        prVertices *normals);
+
+/* Returns the number of vertices of `s`, assuming `s` is a 'chain' collision shape. */
+int prGetChainVertexCount(const prShape *s);
+
+/* 
+    Returns a vertex with the given `index` of `s`, 
+    assuming `s` is a 'chain' collision shape. 
+*/
+prVector2 prGetChainVertex(const prShape *s, int index);
+
+/* 
+    Returns the number of line segments of `s`, 
+    assuming `s` is a 'chain' collision shape.
+*/
+int prGetChainSegmentCount(const prShape *s);
+
+/* 
+    Returns `true` if the last vertex of `s` is connected to the first one,
+    assuming `s` is a 'chain' collision shape.
+*/
+bool prIsChainLoop(const prShape *s);
+
+/* 
+    Calls `func` with the index of each line segment of `s` with the transform `tx`
+    whose AABB overlaps `aabb`, assuming `s` is a 'chain' collision shape.
+    (This function does not modify `s`, so it can be called on multiple threads.)
+*/
+void prQueryChain(const prShape *s,
+                  prTransform tx,
+                  prAABB aabb,
+                  prHashQueryFunc func,
+                  void *ctx);
+
+/* 
+    Returns the shape with the given `index` of `s`, 
+    assuming `s` is a 'compound' collision shape.
+*/
+const prShape *prGetCompoundChild(const prShape *s, int index);
+
+/* 
+    Returns the local offset of the shape with the given `index` of `s`, 
+    assuming `s` is a 'compound' collision shape.
+*/
+prTransform prGetCompoundChildOffset(const prShape *s, int index);
+
+/* 
+    Returns the transform of the shape with the given `index` of `s`
+    when `s` has the transform `tx`, assuming `s` is a 'compound' collision shape.
+*/
+prTransform prGetCompoundChildTransform(const prShape *s,
+                                        int index,
+                                        prTransform tx);
+
 /* Sets the type of `s` to `type`. */
 void prSetShapeType(prShape *s, prShapeType type);
 
@@ -353,7 +906,7 @@ prBody *prCreateBody(prBodyType type, prVector2 position);
 /* Creates a rigid body at `position`, then attaches `s` to it. */
 prBody *prCreateBodyFromShape(prBodyType type, prVector2 position, prShape *s);
 
-/* Releases the memory allocated for `b`. */
+/* Releases the memory allocated for `b`, including its reference to its collision shape. */
 void prReleaseBody(prBody *b);
 
 /* Returns the type of `b`. */
@@ -365,9 +918,27 @@ prBodyFlags prGetBodyFlags(const prBody *b);
 /* Returns the collision shape of `b`. */
 prShape *prGetBodyShape(const prBody *b);
 
+/* 
+    Returns the material of `b`, which is the material of its collision shape
+    unless it was overridden by `prSetBodyMaterial()`.
+*/
+prMaterial prGetBodyMaterial(const prBody *b);
+
+/* Returns the collision filter of `b`. */
+prCollisionFilter prGetBodyFilter(const prBody *b);
+
+/* Returns the simulation state of `b`. */
+prBodyState prGetBodyState(const prBody *b);
+
 /* Returns the transform of `b`. */
 prTransform prGetBodyTransform(const prBody *b);
 
+/* 
+    Returns the transform of `b` interpolated by `alpha` between its previous
+    transform (which is `alpha = 0`) and its current transform (`alpha = 1`).
+*/
+prTransform prGetBodyInterpolatedTransform(const prBody *b, float alpha);
+
 /* Returns the position of `b`. */
 prVector2 prGetBodyPosition(const prBody *b);
 
@@ -398,21 +969,69 @@ float prGetBodyAngularVelocity(const prBody *b);
 /* Returns the AABB (Axis-Aligned Bounding Box) of `b`. */
 prAABB prGetBodyAABB(const prBody *b);
 
+/* 
+    Returns the vertices of the collision shape of `b` in world space,
+    assuming the collision shape of `b` is a 'polygon' collision shape.
+*/
+const prVertices *prGetBodyVertices(const prBody *b);
+
+/* 
+    Returns the normals of the collision shape of `b` in world space,
+    assuming the collision shape of `b` is a 'polygon' collision shape.
+*/
+const prVertices *prGetBodyNormals(const prBody *b);
+
 /* Returns the user data of `b`. */
 void *prGetBodyUserData(const prBody *b);
 
+/* Returns `true` if `b` is sleeping. */
+bool prIsBodySleeping(const prBody *b);
+
+/* Returns the time that `b` has been resting for, in seconds. */
+float prGetBodySleepTime(const prBody *b);
+
+/* 
+    Returns `true` if `b` was moved, or its type or collision shape was changed, 
+    since it was last marked as not moved.
+*/
+bool prHasBodyMoved(const prBody *b);
+
+/* Returns the world that `b` was added to, or `NULL` if there is none. */
+prWorld *prGetBodyWorld(const prBody *b);
+
+/* Returns the index of `b` in the body storage of its world, or `-1` if there is none. */
+int prGetBodyStorageIndex(const prBody *b);
+
 /* Sets the `type` of `b`. */
 void prSetBodyType(prBody *b, prBodyType type);
 
 /* Sets the property `flags` of `b`. */
 void prSetBodyFlags(prBody *b, prBodyFlags flags);
 
-/*
-    Attaches the collision `s`hape to `b`. If `s` is `NULL`,
-    it will detach the current collision shape prom `b`.
+/* 
+    Attaches the collision `s`hape to `b`, adding a reference to `s`. 
+    If `s` is `NULL`, it will detach the current collision shape from `b`.
 */
 void prSetBodyShape(prBody *b, prShape *s);
 
+/* 
+    Overrides the material of the collision shape of `b` with `material`,
+    without modifying the collision shape (which might be shared by other bodies).
+*/
+void prSetBodyMaterial(prBody *b, prMaterial material);
+
+/* Makes `b` use the material of its collision shape again. */
+void prResetBodyMaterial(prBody *b);
+
+/* Sets the collision `filter` of `b`. */
+void prSetBodyFilter(prBody *b, prCollisionFilter filter);
+
+/* 
+    Restores the simulation `state` of `b` exactly as it was returned 
+    by `prGetBodyState()`, without waking up `b`.
+*/
+void prSetBodyState(prBody *b, prBodyState state);
+
 /* Sets the transform of `b` to `tx`. */
 void prSetBodyTransform(prBody *b, prTransform tx);
 
@@ -431,12 +1050,31 @@ void prSetBodyVelocity(prBody *b, prVector2 v);
 /* Sets the `angularVelocity` of `b`. */
 void prSetBodyAngularVelocity(prBody *b, float angularVelocity);
 
+/* Sets the world that `b` was added to (or `NULL` if it was removed from its world). */
+void prSetBodyWorld(prBody *b, prWorld *w);
+
+/* Sets the index of `b` in the body storage of its world. */
+void prSetBodyStorageIndex(prBody *b, int index);
+
+/* 
+    Puts `b` to sleep if `sleeping` is `true`, 
+    otherwise wakes up `b` and resets its sleep time. 
+    (The rest of the island of `b` wakes up at the next step of its world.)
+*/
+void prSetBodySleeping(prBody *b, bool sleeping);
+
+/* Marks `b` as moved if `moved` is `true`, otherwise marks `b` as not moved. */
+void prSetBodyMoved(prBody *b, bool moved);
+
 /* Sets the user data of `b` to `ctx`. */
 void prSetBodyUserData(prBody *b, void *ctx);
 
 /* Checks if the given `point` lies inside `b`. */
 bool prBodyContainsPoint(const prBody *b, prVector2 point);
 
+/* Checks if the collision filters of `b1` and `b2` allow them to collide. */
+bool prShouldBodiesCollide(const prBody *b1, const prBody *b2);
+
 /* Clears accumulated forces on `b`. */
 void prClearBodyForces(prBody *b);
 
@@ -461,12 +1099,124 @@ void prIntegrateForBodyVelocity(prBody *b, float dt);
 /* Integrates the velocity of `b` over `dt` to calculate the position of `b`. */
 void prIntegrateForBodyPosition(prBody *b, float dt);
 
+/* 
+    Adds `dt` to the sleep time of `b` if the speed of `b` is under the 
+    given thresholds, otherwise resets the sleep time of `b`.
+*/
+void prUpdateBodySleepTime(prBody *b,
+                           float dt,
+                           float linearThreshold,
+                           float angularThreshold);
+
+/* Saves the current transform of `b` as its previous transform, for interpolation. */
+void prUpdateBodyPreviousTransform(prBody *b);
+
 /* Resolves the collision between `b1` and `b2`. */
 void prResolveCollision(prBody *b1,
                         prBody *b2,
                         prCollision *ctx,
                         float inverseDt);
 
+/* Resizes `bs` to hold the motion data of `count` bodies. */
+void prResizeBodyStorage(prBodyStorage *bs, int count);
+
+/* Releases the memory allocated for the arrays of `bs`. */
+void prReleaseBodyStorage(prBodyStorage *bs);
+
+/* 
+    Copies the motion data of `b` to `bs` at `index`, or fills `bs` at `index`
+    with the motion data of a static, sleeping body if `b` is `NULL`.
+*/
+void prLoadBodyToStorage(prBodyStorage *bs, int index, const prBody *b);
+
+/* 
+    Copies the velocities in `bs` at `index` back to `b`, then updates 
+    the transform and the AABB of `b` if `b` is neither static nor sleeping.
+*/
+void prStoreBodyFromStorage(const prBodyStorage *bs, int index, prBody *b);
+
+/* 
+    Applies the `g`ravity acceleration vector and the accumulated forces 
+    to each body in `bs`, then integrates the accelerations over `dt`
+    to calculate the velocities of the bodies.
+*/
+void prIntegrateBodyStorageVelocities(prBodyStorage *bs,
+                                      prVector2 g,
+                                      float dt);
+
+/* Integrates the velocity of each body in `bs` over `dt` to calculate its position. */
+void prIntegrateBodyStoragePositions(prBodyStorage *bs, float dt);
+
+/* Applies accumulated impulses to the bodies in `bs` at `i1` and `i2`. */
+void prApplyAccumulatedImpulsesToStorage(prBodyStorage *bs,
+                                         int i1,
+                                         int i2,
+                                         prCollision *ctx);
+
+/* Resolves the collision between the bodies in `bs` at `i1` and `i2`. */
+void prResolveCollisionForStorage(prBodyStorage *bs,
+                                  int i1,
+                                  int i2,
+                                  prCollision *ctx,
+                                  float inverseDt);
+
+/* 
+    Resolves the `count` contact `constraints` of the bodies in `bs` for up to 
+    `iterationCount` times, using `sb` as scratch memory, then returns the number 
+    of iterations done. If `tolerance` is positive, this stops early once 
+    no impulse of an iteration is larger than `tolerance`.
+*/
+int prSolveContactConstraints(prBodyStorage *bs,
+                              prContactConstraint *constraints,
+                              int count,
+                              int iterationCount,
+                              float tolerance,
+                              float inverseDt,
+                              prSolverBuffer *sb);
+
+/* Releases the memory allocated for the arrays of `sb`. */
+void prReleaseSolverBuffer(prSolverBuffer *sb);
+
+/* (From 'thread-pool.c') =============================================================== */
+
+/*
+    Creates a new thread pool with `threadCount` threads,
+    including the thread that will call `prRunThreadPool()`.
+*/
+prThreadPool *prCreateThreadPool(int threadCount);
+
+/* Releases the memory allocated for `tp`, after stopping all of its threads. */
+void prReleaseThreadPool(prThreadPool *tp);
+
+/* Returns the number of threads in `tp`. */
+int prGetThreadPoolThreadCount(const prThreadPool *tp);
+
+/* 
+    Returns the number of blocks allocated (or resized) by the worker threads 
+    of `tp` so far, or `0` if `PR_DISABLE_STATS` is defined.
+*/
+size_t prGetThreadPoolAllocationCount(const prThreadPool *tp);
+
+/*
+    Splits the range `[0, count)` into batches, then calls `func` for each batch
+    on the threads of `tp` (including the calling thread) and waits for all of them.
+*/
+void prRunThreadPool(prThreadPool *tp,
+                     int count,
+                     prThreadPoolFunc func,
+                     void *ctx);
+
+/*
+    Splits the range `[0, count)` into batches of at least `minBatchSize` elements, 
+    then calls `func` for each batch on the threads of `tp` 
+    (including the calling thread) and waits for all of them.
+*/
+void prRunThreadPoolWithBatchSize(prThreadPool *tp,
+                                  int count,
+                                  int minBatchSize,
+                                  prThreadPoolFunc func,
+                                  void *ctx);
+
 /* (From 'timer.c') ===================================================================== */
 
 /* Returns the current time of the monotonic clock, in seconds. */
@@ -480,6 +1230,9 @@ double prGetCurrentTime(void);
 */
 prWorld *prCreateWorld(prVector2 gravity, float cellSize);
 
+/* Creates a world with the given `config`uration. */
+prWorld *prCreateWorldFromConfig(prWorldConfig config);
+
 /* Releases the memory allocated for `w`. */
 void prReleaseWorld(prWorld *w);
 
@@ -498,21 +1251,146 @@ prBody *prGetBodyFromWorld(const prWorld *w, int index);
 /* Returns the number of rigid bodies in `w`. */
 int prGetBodyCountForWorld(const prWorld *w);
 
+/* Returns the handle of `b` in `w`, or an invalid handle if `b` is not in `w`. */
+prBodyHandle prGetBodyHandle(const prWorld *w, const prBody *b);
+
+/* Returns the rigid body referenced by `handle` in `w`, or `NULL` if there is none. */
+prBody *prGetBodyFromHandle(const prWorld *w, prBodyHandle handle);
+
 /* Returns the gravity acceleration vector of `w`. */
 prVector2 prGetWorldGravity(const prWorld *w);
 
+/* Returns the type of the broad-phase algorithm of `w`. */
+prBroadPhaseType prGetWorldBroadPhaseType(const prWorld *w);
+
+/* Returns the number of threads used for the narrow phase of `w`. */
+int prGetWorldThreadCount(const prWorld *w);
+
+/* Returns the maximum number of iterations for the constraint solver of `w`. */
+int prGetWorldIterationCount(const prWorld *w);
+
+/* Returns the impulse tolerance for the constraint solver of `w` to stop early. */
+float prGetWorldSolverTolerance(const prWorld *w);
+
+/* Returns the maximum number of steps for each call to `prUpdateWorld()` with `w`. */
+int prGetWorldMaxStepCount(const prWorld *w);
+
+/* Returns the number of sub-steps for each step of `prUpdateWorld()` with `w`. */
+int prGetWorldSubStepCount(const prWorld *w);
+
+/* 
+    Returns how far the time left over from the last call to `prUpdateWorld()`
+    with `w` is into the next step, from `0` to `1`, for interpolating the transforms
+    of the bodies in `w` with `prGetBodyInterpolatedTransform()`.
+*/
+float prGetWorldInterpolationAlpha(const prWorld *w);
+
+/* Returns the time spent on each phase of the last step of `w`. */
+prWorldStats prGetWorldStats(const prWorld *w);
+
+/* 
+    Returns the bodies that started (or stopped) touching a sensor body
+    in the last step of `w`, which stay valid until the next step of `w`.
+*/
+prSensorEvents prGetWorldSensorEvents(const prWorld *w);
+
+/* 
+    Returns the contacts of the last step of `w` as a contiguous array,
+    which stays valid until the next step of `w`.
+    (The array is only filled on the first call after each step of `w`,
+    so stepping `w` costs nothing extra if this function is never called.)
+*/
+prWorldContacts prGetWorldContacts(prWorld *w);
+
+/* 
+    Returns the handles and the transforms of the bodies in `w` as contiguous arrays, 
+    which stay valid until the next step of `w`.
+    (The arrays are only filled on the first call after each step of `w`,
+    so stepping `w` costs nothing extra if this function is never called.)
+*/
+prWorldTransforms prGetWorldTransforms(prWorld *w);
+
+/* 
+    Returns `true` if the results of stepping `w` only depend on the state of `w`,
+    and not on the history of its broad phase.
+*/
+bool prIsWorldDeterministic(const prWorld *w);
+
+/* Returns `true` if the bodies in `w` are allowed to fall asleep. */
+bool prIsWorldSleepingEnabled(const prWorld *w);
+
 /* Sets the collision event `handler` of `w`. */
 void prSetWorldCollisionHandler(prWorld *w, prCollisionHandler handler);
 
 /* Sets the `gravity` acceleration vector of `w`. */
 void prSetWorldGravity(prWorld *w, prVector2 gravity);
 
+/* Sets the number of threads used for the narrow phase of `w`. */
+void prSetWorldThreadCount(prWorld *w, int threadCount);
+
+/* Sets the maximum number of iterations for the constraint solver of `w`. */
+void prSetWorldIterationCount(prWorld *w, int iterationCount);
+
+/* 
+    Sets the impulse `tolerance` for the constraint solver of `w`, so that it stops 
+    once no impulse of an iteration is larger than `tolerance` (or `0` to disable).
+*/
+void prSetWorldSolverTolerance(prWorld *w, float tolerance);
+
+/* 
+    Sets the maximum number of steps for each call to `prUpdateWorld()` with `w`,
+    dropping the time that could not be caught up with.
+*/
+void prSetWorldMaxStepCount(prWorld *w, int maxStepCount);
+
+/* 
+    Sets the number of sub-steps for each step of `prUpdateWorld()` with `w`,
+    splitting the solver iterations of a step between its sub-steps.
+*/
+void prSetWorldSubStepCount(prWorld *w, int subStepCount);
+
+/* 
+    Enables or disables the deterministic mode of `w`, which sorts the pairs 
+    of bodies found in the broad phase of `w` by the indexes of their bodies.
+*/
+void prSetWorldDeterministic(prWorld *w, bool enabled);
+
+/* 
+    Allows or disallows the bodies in `w` to fall asleep. 
+    Disabling sleeping will wake up all bodies in `w`.
+*/
+void prSetWorldSleepingEnabled(prWorld *w, bool enabled);
+
+/* 
+    Sets the speed thresholds and the time for the bodies in `w`
+    to rest before they fall asleep.
+*/
+void prSetWorldSleepThresholds(prWorld *w,
+                               float linearThreshold,
+                               float angularThreshold,
+                               float timeToSleep);
+
+/* 
+    Marks the broad-phase data structure of `w` as out of date, 
+    so that the next query of `w` updates it first.
+*/
+void prMarkWorldBroadPhaseDirty(prWorld *w);
+
 /* Proceeds the simulation over the time step `dt`, in seconds. */
 void prStepWorld(prWorld *w, float dt);
 
+/* 
+    Proceeds the simulation of each of the `count` worlds in `worlds` over
+    the time step `dt`, in seconds, stepping different worlds in parallel 
+    on the threads of `tp` (or one after another if `tp` is `NULL`).
+*/
+void prStepWorlds(prWorld **worlds, int count, float dt, prThreadPool *tp);
+
 /*
     Proceeds the simulation over the time step `dt`, in seconds,
     which will always run independent of the pramerate.
+    This runs at most a few steps (and their sub-steps) for each call,
+    saving the previous transforms of the bodies in `w` before each step.
 */
 void prUpdateWorld(prWorld *w, float dt);
 
@@ -522,8 +1400,154 @@ void prUpdateWorld(prWorld *w, float dt);
 */
 void prComputeRaycastForWorld(prWorld *w, prRay ray, prRaycastQueryFunc func);
 
+/* 
+    Casts each of the `count` rays in `rays` against all objects in `w`,
+    stores the closest hit (or any hit, if `mode` is `PR_RAYCAST_ANY`) of each ray
+    to `hits` (with `NULL` as the body of a miss), then returns the number of hits.
+*/
+int prComputeRaycastsForWorld(prWorld *w,
+                              const prRay *rays,
+                              int count,
+                              prRaycastMode mode,
+                              prRaycastHit *hits);
+
+/* 
+    Finds all bodies in `w` whose AABBs overlap `aabb`, stores up to `capacity`
+    of them to `bodies`, then returns the number of bodies found.
+*/
+int prQueryWorldAABB(prWorld *w, prAABB aabb, prBody **bodies, int capacity);
+
+/* 
+    Finds all bodies in `w` that contain `point`, stores up to `capacity`
+    of them to `bodies`, then returns the number of bodies found.
+*/
+int prQueryWorldPoint(prWorld *w,
+                      prVector2 point,
+                      prBody **bodies,
+                      int capacity);
+
+/* 
+    Sweeps `s` with the transform `tx` along `translation` against all bodies in `w`,
+    stores up to `capacity` of the closest hits (sorted by their fractions
+    of `translation`) to `hits`, then returns the number of hits found.
+*/
+int prComputeShapeCastForWorld(prWorld *w,
+                               const prShape *s,
+                               prTransform tx,
+                               prVector2 translation,
+                               prShapeCastHit *hits,
+                               int capacity);
+
+/* 
+    Saves the state of `w` (the state of each body, the contact cache and 
+    the time left over by `prUpdateWorld()`) to `buffer` if it has at least 
+    `size` bytes, then returns the size of the state.
+    The state is in native byte order, and can be copied like any other memory.
+*/
+size_t prSaveWorldState(const prWorld *w, void *buffer, size_t size);
+
+/* 
+    Restores the state of `w` exactly from `buffer`, which must be 
+    saved by `prSaveWorldState()` while `w` had the same bodies as now.
+    The steps after the restore repeat the steps after the save with any 
+    broad phase, since new contacts are always inserted in the same order.
+*/
+bool prLoadWorldState(prWorld *w, const void *buffer, size_t size);
+
+/* 
+    Saves the state of `w` like `prSaveWorldState()`, but only with 
+    the bodies whose states are different from the ones in the `base` state.
+*/
+size_t prSaveWorldStateDelta(const prWorld *w,
+                             const void *base,
+                             size_t baseSize,
+                             void *buffer,
+                             size_t size);
+
+/* 
+    Restores the state of `w` exactly from the `base` state and
+    the `delta` state saved by `prSaveWorldStateDelta()` against `base`,
+    like `prLoadWorldState()`.
+*/
+bool prLoadWorldStateDelta(prWorld *w,
+                           const void *base,
+                           size_t baseSize,
+                           const void *delta,
+                           size_t deltaSize);
+
 /* Inline Functions ===================================================================== */
 
+/* 
+    Returns the sine of `angle` plus `quadrant` right angles, computed only with 
+    `fmod()` and basic arithmetic operations on doubles, so that the result 
+    is the same on every platform (as long as floating-point contraction is disabled).
+*/
+PR_API_INLINE float prPortableSin(float angle, int quadrant) {
+    // NOTE: `fmod()` is always exact, unlike `sinf()` and `cosf()`.
+    const double x = fmod(angle, 6.28318530717958647693);
+
+    if (x != x) return (float) x;
+
+    const double k = (double) (int) (x * 0.63661977236758134308
+                                     + ((x < 0.0) ? -0.5 : 0.5));
+
+    // NOTE: `x` is reduced to `[-π/4, π/4]` with a two-part value of `π/2`.
+    const double r = (x - k * 1.57079632673412561417)
+                     - k * 6.07710050650619224932e-11;
+
+    const double r2 = r * r;
+
+    double result = 0.0;
+
+    quadrant = ((int) k + quadrant) & 3;
+
+    // NOTE: These are the Taylor series of `cos(r)` and `sin(r)`, in Horner's form.
+    if (quadrant & 1) {
+        result = 2.08767569878680989792e-9;
+
+        result = result * r2 - 2.75573192239858906526e-7;
+        result = result * r2 + 2.48015873015873015873e-5;
+        result = result * r2 - 1.38888888888888888889e-3;
+        result = result * r2 + 4.16666666666666666667e-2;
+        result = result * r2 - 0.5;
+        result = result * r2 + 1.0;
+    } else {
+        result = -2.50521083854417187751e-8;
+
+        result = result * r2 + 2.75573192239858906526e-6;
+        result = result * r2 - 1.98412698412698412698e-4;
+        result = result * r2 + 8.33333333333333333333e-3;
+        result = result * r2 - 1.66666666666666666667e-1;
+        result = result * r2 * r + r;
+    }
+
+    return (float) ((quadrant & 2) ? -result : result);
+}
+
+/* 
+    Returns the sine of `angle`, which is computed with `prPortableSin()` 
+    if `PR_DETERMINISTIC` is defined.
+*/
+PR_API_INLINE float prSin(float angle) {
+#ifdef PR_DETERMINISTIC
+    return prPortableSin(angle, 0);
+#else
+    return sinf(angle);
+#endif
+}
+
+/* 
+    Returns the cosine of `angle`, which is computed with `prPortableSin()` 
+    if `PR_DETERMINISTIC` is defined.
+*/
+PR_API_INLINE float prCos(float angle) {
+#ifdef PR_DETERMINISTIC
+    return prPortableSin(angle, 1);
+#else
+    return cosf(angle);
+#endif
+}
+
 /* Adds `v1` and `v2`. */
 PR_API_INLINE prVector2 prVector2Add(prVector2 v1, prVector2 v2) {
     return (prVector2) { v1.x + v2.x, v1.y + v2.y };
@@ -595,8 +1619,8 @@ PR_API_INLINE prVector2 prVector2RightNormal(prVector2 v) {
 
 /* Rotates `v` through the `angle` about the origin of a coordinate plane. */
 PR_API_INLINE prVector2 prVector2Rotate(prVector2 v, float angle) {
-    const float _sin = sinf(angle);
-    const float _cos = cosf(angle);
+    const float _sin = prSin(angle);
+    const float _cos = prCos(angle);
 
     return (prVector2) { v.x * _cos - v.y * _sin, v.x * _sin + v.y * _cos };
 }
@@ -672,6 +1696,12 @@ PR_API_INLINE float prUnitsToPixels(float k) {
                : 0.0f;
 }
 
+/* Checks whether `a1` and `a2` overlap. */
+PR_API_INLINE bool prAABBsOverlap(prAABB a1, prAABB a2) {
+    return (a1.x <= a2.x + a2.width && a2.x <= a1.x + a1.width)
+           && (a1.y <= a2.y + a2.height && a2.y <= a1.y + a1.height);
+}
+
 #ifdef __cplusplus
 }
 #endif
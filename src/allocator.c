@@ -0,0 +1,357 @@
+/*
+    Copyright (c) 2023 Warren Galyen <wgalyen@mechanikadesign.com>
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+/* Includes ============================================================================= */
+
+#include <string.h>
+
+#include "proxima.h"
+
+/* Constants ============================================================================ */
+
+/* 
+    The size of the header in front of each block of memory, which stores
+    the allocator of the block (rounded up to keep the block aligned to 16 bytes).
+*/
+static const size_t ALLOCATION_HEADER_SIZE = (sizeof(prAllocator) + 15)
+                                             & ~((size_t) 15);
+
+/* The number of blocks allocated at once when a memory pool runs out of blocks. */
+static const int POOL_CHUNK_BLOCK_COUNT = 64;
+
+/* 
+    The size of the header in front of each chunk of a memory pool, which stores
+    the next chunk of the pool (rounded up to keep the blocks aligned to 16 bytes).
+*/
+static const size_t POOL_CHUNK_HEADER_SIZE = (sizeof(void *) + 15)
+                                             & ~((size_t) 15);
+
+/* Private Function Prototypes ========================================================== */
+
+/* Wrappers for the allocation functions of the C standard library. */
+static void *prAllocateDefault(size_t size, void *ctx);
+static void *prReallocateDefault(void *ptr, size_t size, void *ctx);
+static void prReleaseDefault(void *ptr, void *ctx);
+
+/* Allocates a zero-initialized block of `size` bytes with `a`. */
+static void *prAllocateMemoryWith(const prAllocator *a, size_t size);
+
+/* Returns the size of each block of `p`, including its padding. */
+static PR_API_INLINE size_t prGetPoolBlockSize(const prPool *p);
+
+/* A comparison function for `qsort()` that sorts the chunks of a pool by address. */
+static int prComparePoolChunks(const void *c1, const void *c2);
+
+/* 
+    Returns the index of the chunk in the sorted `chunks` that contains `block`,
+    or `-1` if there is none.
+*/
+static int prFindPoolChunk(unsigned char *const *chunks,
+                           int count,
+                           const void *block,
+                           size_t chunkSize);
+
+/* Private Variables ==================================================================== */
+
+static prAllocator defaultAllocator = { .allocate = prAllocateDefault,
+                                        .reallocate = prReallocateDefault,
+                                        .release = prReleaseDefault };
+
+static PR_API_THREAD_LOCAL const prAllocator *currentAllocator = NULL;
+
+static PR_API_THREAD_LOCAL size_t allocationCount = 0;
+
+static PR_API_THREAD_LOCAL prPool *pools = NULL;
+
+/* Public Functions ===================================================================== */
+
+/* Returns the allocator used when no other allocator has been given. */
+prAllocator prGetDefaultAllocator(void) {
+    return defaultAllocator;
+}
+
+/* 
+    Sets the allocator used when no other allocator has been given,
+    or restores the standard library functions if any function of `a` is `NULL`.
+    (This function must be called before anything else is created.)
+*/
+void prSetDefaultAllocator(prAllocator a) {
+    if (a.allocate == NULL || a.reallocate == NULL || a.release == NULL)
+        a = (prAllocator) { .allocate = prAllocateDefault,
+                            .reallocate = prReallocateDefault,
+                            .release = prReleaseDefault };
+
+    defaultAllocator = a;
+}
+
+/* 
+    Makes `a` the allocator for new memory on the calling thread 
+    (or the default allocator if `a` is `NULL`), then returns the previous one.
+*/
+const prAllocator *prSetCurrentAllocator(const prAllocator *a) {
+    const prAllocator *result = currentAllocator;
+
+    currentAllocator = a;
+
+    return result;
+}
+
+/* Returns the allocator for new memory on the calling thread. */
+const prAllocator *prGetCurrentAllocator(void) {
+    return currentAllocator;
+}
+
+/* Allocates a zero-initialized block of `size` bytes with the current allocator. */
+void *prAllocateMemory(size_t size) {
+    return prAllocateMemoryWith((currentAllocator != NULL) ? currentAllocator
+                                                           : &defaultAllocator,
+                                size);
+}
+
+/* 
+    Resizes the block at `ptr` to `size` bytes with the allocator 
+    that allocated it (or allocates a new block if `ptr` is `NULL`).
+*/
+void *prReallocateMemory(void *ptr, size_t size) {
+    if (ptr == NULL) return prAllocateMemory(size);
+
+    unsigned char *header = (unsigned char *) ptr - ALLOCATION_HEADER_SIZE;
+
+    prAllocator a;
+
+    memcpy(&a, header, sizeof a);
+
+    PR_API_STATS(allocationCount++);
+
+    // NOTE: The header is moved along with the rest of the block.
+    header = a.reallocate(header, ALLOCATION_HEADER_SIZE + size, a.ctx);
+
+    return (header != NULL) ? header + ALLOCATION_HEADER_SIZE : NULL;
+}
+
+/* Releases the block at `ptr` with the allocator that allocated it. */
+void prReleaseMemory(void *ptr) {
+    if (ptr == NULL) return;
+
+    unsigned char *header = (unsigned char *) ptr - ALLOCATION_HEADER_SIZE;
+
+    prAllocator a;
+
+    memcpy(&a, header, sizeof a);
+
+    a.release(header, a.ctx);
+}
+
+/* 
+    Returns the number of blocks allocated (or resized) on the calling thread so far,
+    or `0` if `PR_DISABLE_STATS` is defined.
+*/
+size_t prGetAllocationCount(void) {
+    return allocationCount;
+}
+
+/* 
+    Takes a zero-initialized block from `p`, allocating more blocks
+    with the default allocator if `p` has run out of blocks.
+*/
+void *prAllocateFromPool(prPool *p) {
+    if (p == NULL || p->blockSize == 0) return NULL;
+
+    if (p->freeList == NULL) {
+        const size_t blockSize = prGetPoolBlockSize(p);
+
+        unsigned char *chunk = prAllocateMemoryWith(&defaultAllocator,
+                                                    POOL_CHUNK_HEADER_SIZE
+                                                        + POOL_CHUNK_BLOCK_COUNT
+                                                              * blockSize);
+
+        if (chunk == NULL) return NULL;
+
+        // NOTE: The chunks of `p` are only released by `prTrimPool()`.
+        *(void **) chunk = p->chunks, p->chunks = chunk;
+
+        if (!p->registered) p->next = pools, pools = p, p->registered = true;
+
+        for (int i = POOL_CHUNK_BLOCK_COUNT - 1; i >= 0; i--) {
+            void *block = chunk + POOL_CHUNK_HEADER_SIZE + i * blockSize;
+
+            *(void **) block = p->freeList, p->freeList = block;
+        }
+    }
+
+    void *result = p->freeList;
+
+    p->freeList = *(void **) result;
+
+    memset(result, 0, p->blockSize);
+
+    return result;
+}
+
+/* Returns the block at `ptr` to `p`. */
+void prReleaseToPool(prPool *p, void *ptr) {
+    if (p == NULL || ptr == NULL) return;
+
+    *(void **) ptr = p->freeList, p->freeList = ptr;
+}
+
+/* Releases each chunk of blocks of `p` whose blocks are all unused. */
+void prTrimPool(prPool *p) {
+    if (p == NULL || p->chunks == NULL) return;
+
+    const size_t chunkSize = POOL_CHUNK_BLOCK_COUNT * prGetPoolBlockSize(p);
+
+    int chunkCount = 0;
+
+    for (void *chunk = p->chunks; chunk != NULL; chunk = *(void **) chunk)
+        chunkCount++;
+
+    unsigned char **chunks = prAllocateMemoryWith(&defaultAllocator,
+                                                  chunkCount
+                                                      * (sizeof *chunks
+                                                         + sizeof(int)));
+
+    if (chunks == NULL) return;
+
+    int *freeCounts = (int *) (chunks + chunkCount);
+
+    {
+        int i = 0;
+
+        for (void *chunk = p->chunks; chunk != NULL; chunk = *(void **) chunk)
+            chunks[i++] = chunk;
+    }
+
+    qsort(chunks, chunkCount, sizeof *chunks, prComparePoolChunks);
+
+    /*
+        NOTE: The free list of `p` may also hold blocks from the chunks
+        of other pools, if they were released on another thread.
+    */
+    for (void *block = p->freeList; block != NULL; block = *(void **) block) {
+        const int index = prFindPoolChunk(chunks, chunkCount, block, chunkSize);
+
+        if (index >= 0) freeCounts[index]++;
+    }
+
+    for (void **link = &p->freeList; *link != NULL;) {
+        const int index = prFindPoolChunk(chunks, chunkCount, *link, chunkSize);
+
+        if (index >= 0 && freeCounts[index] == POOL_CHUNK_BLOCK_COUNT)
+            *link = *(void **) *link;
+        else
+            link = (void **) *link;
+    }
+
+    p->chunks = NULL;
+
+    for (int i = 0; i < chunkCount; i++) {
+        if (freeCounts[i] == POOL_CHUNK_BLOCK_COUNT)
+            prReleaseMemory(chunks[i]);
+        else
+            *(void **) chunks[i] = p->chunks, p->chunks = chunks[i];
+    }
+
+    prReleaseMemory(chunks);
+}
+
+/* 
+    Calls `prTrimPool()` for each pool that first allocated a chunk of blocks 
+    on the calling thread, including the pools of bodies and shapes.
+    (A thread that created bodies or shapes should call this function before it exits.)
+*/
+void prTrimPools(void) {
+    for (prPool *p = pools; p != NULL; p = p->next)
+        prTrimPool(p);
+}
+
+/* Private Functions ==================================================================== */
+
+static void *prAllocateDefault(size_t size, void *ctx) {
+    return malloc(size);
+}
+
+static void *prReallocateDefault(void *ptr, size_t size, void *ctx) {
+    return realloc(ptr, size);
+}
+
+static void prReleaseDefault(void *ptr, void *ctx) {
+    free(ptr);
+}
+
+/* Allocates a zero-initialized block of `size` bytes with `a`. */
+static void *prAllocateMemoryWith(const prAllocator *a, size_t size) {
+    unsigned char *header = a->allocate(ALLOCATION_HEADER_SIZE + size, a->ctx);
+
+    PR_API_STATS(allocationCount++);
+
+    if (header == NULL) return NULL;
+
+    // NOTE: Each block remembers its allocator, so that it can be freed anywhere.
+    memcpy(header, a, sizeof *a);
+
+    memset(header + ALLOCATION_HEADER_SIZE, 0, size);
+
+    return header + ALLOCATION_HEADER_SIZE;
+}
+
+/* Returns the size of each block of `p`, including its padding. */
+static PR_API_INLINE size_t prGetPoolBlockSize(const prPool *p) {
+    // NOTE: Each block must be able to hold the next block of the free list.
+    return (p->blockSize + 15) & ~((size_t) 15);
+}
+
+/* A comparison function for `qsort()` that sorts the chunks of a pool by address. */
+static int prComparePoolChunks(const void *c1, const void *c2) {
+    const uintptr_t a1 = (uintptr_t) *(unsigned char *const *) c1;
+    const uintptr_t a2 = (uintptr_t) *(unsigned char *const *) c2;
+
+    return (a1 > a2) - (a1 < a2);
+}
+
+/* 
+    Returns the index of the chunk in the sorted `chunks` that contains `block`,
+    or `-1` if there is none.
+*/
+static int prFindPoolChunk(unsigned char *const *chunks,
+                           int count,
+                           const void *block,
+                           size_t chunkSize) {
+    const uintptr_t address = (uintptr_t) block;
+
+    int low = 0, high = count - 1;
+
+    while (low <= high) {
+        const int mid = low + (high - low) / 2;
+
+        const uintptr_t start = (uintptr_t) chunks[mid] + POOL_CHUNK_HEADER_SIZE;
+
+        if (address < start)
+            high = mid - 1;
+        else if (address >= start + chunkSize)
+            low = mid + 1;
+        else
+            return mid;
+    }
+
+    return -1;
+}
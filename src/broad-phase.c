@@ -22,11 +22,17 @@
 
 /* Includes ============================================================================= */
 
-#define STB_DS_IMPLEMENTATION
-#include "external/stb_ds.h"
+#include <float.h>
 
 #include "proxima.h"
 
+// NOTE: All arrays and hash maps are allocated with the current allocator.
+#define STBDS_REALLOC(context, ptr, size) prReallocateMemory(ptr, size)
+#define STBDS_FREE(context, ptr)          prReleaseMemory(ptr)
+
+#define STB_DS_IMPLEMENTATION
+#include "external/stb_ds.h"
+
 /* Typedefs ============================================================================= */
 
 /* A structure that represents the key of a spatial hash entry. */
@@ -43,20 +49,131 @@ typedef struct _prSpatialHashEntry {
     prSpatialHashValue value;
 } prSpatialHashEntry;
 
+/* A structure that represents the range of cells covered by a spatial hash value. */
+typedef struct _prSpatialHashRange {
+    int minX, minY, maxX, maxY;
+} prSpatialHashRange;
+
+/* A structure that represents the information of a value in a spatial hash. */
+typedef struct _prSpatialHashProxy {
+    prAABB key;
+    prSpatialHashRange range;
+    uint32_t stamp;
+} prSpatialHashProxy;
+
 /* A struct that represents a spatial hash. */
 struct _prSpatialHash {
     float cellSize, inverseCellSize;
-    prSpatialHashValue queryResult;
+    bool persistent;
+    uint32_t epoch;
+    size_t touchCount;
     prSpatialHashEntry *entries;
+    prSpatialHashProxy *proxies;
+};
+
+/* A structure that represents a node of a dynamic tree. */
+typedef struct _prDynamicTreeNode {
+    prAABB aabb;
+    prVector2 position;
+    int parent, left, right;
+    int height, value;
+} prDynamicTreeNode;
+
+/* A structure that represents a dynamic AABB tree. */
+struct _prDynamicTree {
+    float margin;
+    int root, freeList;
+    prDynamicTreeNode *nodes;
+    int *leaves, *stack;
 };
 
+/* Constants ============================================================================ */
+
+/* A constant that represents a value which is not in a spatial hash. */
+static const prSpatialHashProxy EMPTY_PROXY = {
+    .range = { .minX = 0, .minY = 0, .maxX = -1, .maxY = -1 }
+};
+
+/* 
+    The multiplier for the displacement of a value in a dynamic tree, 
+    by which its enlarged AABB is stretched ahead when the value moves out of it.
+*/
+static const float TREE_DISPLACEMENT_FACTOR = 1.0f;
+
 /* Private Function Prototypes ========================================================== */
 
+/* Returns the range of cells in `sh` that overlap the given `aabb`. */
+static PR_API_INLINE prSpatialHashRange
+prComputeSpatialHashRange(const prSpatialHash *sh, prAABB aabb);
+
+/* Checks whether the cell at (`x`, `y`) lies inside `range`. */
+static PR_API_INLINE bool
+prSpatialHashRangeContains(prSpatialHashRange range, int x, int y);
+
+/* Adds `value` to the cell at (`x`, `y`) of `sh`. */
+static void prAddToSpatialHashCell(prSpatialHash *sh, int x, int y, int value);
+
+/* Removes `value` from the cell at (`x`, `y`) of `sh`. */
+static void
+prRemoveFromSpatialHashCell(prSpatialHash *sh, int x, int y, int value);
+
+/* Returns the information of `value` in `sh`, creating it if necessary. */
+static prSpatialHashProxy *prGetSpatialHashProxy(prSpatialHash *sh, int value);
+
+/* Starts a new query on `sh`, then returns its stamp. */
+static uint32_t prBeginSpatialHashQuery(prSpatialHash *sh);
+
+/* Returns the AABB of the cell at (`x`, `y`) of `sh`. */
+static PR_API_INLINE prAABB prGetSpatialHashCellAABB(const prSpatialHash *sh,
+                                                     int x,
+                                                     int y);
+
+/* 
+    Calls `func` for each value in `entry` that has not been stamped with `stamp`,
+    then returns the new maximum distance of the ray.
+*/
+static float prRaycastSpatialHashCell(prSpatialHash *sh,
+                                      prSpatialHashEntry *entry,
+                                      uint32_t stamp,
+                                      float maxDistance,
+                                      prHashRaycastFunc func,
+                                      void *ctx);
+
+/* Allocates a new node from `dt`, then returns its index. */
+static int prAllocateDynamicTreeNode(prDynamicTree *dt);
+
+/* Returns the node with the given `index` to the free list of `dt`. */
+static void prFreeDynamicTreeNode(prDynamicTree *dt, int index);
+
+/* Inserts the leaf node with the given `index` into `dt`. */
+static void prInsertDynamicTreeLeaf(prDynamicTree *dt, int index);
+
+/* Removes the leaf node with the given `index` from `dt`. */
+static void prRemoveDynamicTreeLeaf(prDynamicTree *dt, int index);
+
+/* Refits and balances the ancestors of the node with the given `index`. */
+static void prRefitDynamicTree(prDynamicTree *dt, int index);
+
 /* 
-    Returns ​a negative integer value if `a` is less than `b`, ​a positive integer value 
-    if `a` is greater than `b` and zero if `a` and `b` are equivalent.
+    Performs a left or right rotation if the node with the given `index` is imbalanced,
+    then returns the index of the new subtree root.
 */
-static int prQSortCompare(const void *a, const void *b);
+static int prBalanceDynamicTree(prDynamicTree *dt, int index);
+
+/* Returns the smallest AABB that contains both `a1` and `a2`. */
+static PR_API_INLINE prAABB prCombineAABBs(prAABB a1, prAABB a2);
+
+/* Returns the perimeter of `a`. */
+static PR_API_INLINE float prGetAABBPerimeter(prAABB a);
+
+/* Checks whether `a1` contains `a2`. */
+static PR_API_INLINE bool prAABBContainsAABB(prAABB a1, prAABB a2);
+
+/* 
+    Checks whether the line segment from `origin` to `origin + delta` 
+    intersects `a`. 
+*/
+static bool prAABBIntersectsSegment(prAABB a, prVector2 origin, prVector2 delta);
 
 /* Public Functions ===================================================================== */
 
@@ -64,8 +181,8 @@ static int prQSortCompare(const void *a, const void *b);
 prSpatialHash *prCreateSpatialHash(float cellSize) {
     if (cellSize <= 0.0f) return NULL;
 
-    // NOTE: `sh->queryResult` and `sh->entries` must be initialized to `NULL`
-    prSpatialHash *sh = calloc(1, sizeof *sh);
+    // NOTE: `sh->entries` and `sh->proxies` must be initialized to `NULL`
+    prSpatialHash *sh = prAllocateMemory(sizeof *sh);
 
     sh->cellSize = cellSize;
     sh->inverseCellSize = 1.0f / cellSize;
@@ -73,6 +190,18 @@ prSpatialHash *prCreateSpatialHash(float cellSize) {
     return sh;
 }
 
+/* 
+    Creates a new spatial hash with the given `cellSize`, which keeps its elements
+    across steps and only moves the elements whose range of cells has changed.
+*/
+prSpatialHash *prCreatePersistentSpatialHash(float cellSize) {
+    prSpatialHash *sh = prCreateSpatialHash(cellSize);
+
+    if (sh != NULL) sh->persistent = true;
+
+    return sh;
+}
+
 /* Releases the memory allocated by `sh`. */
 void prReleaseSpatialHash(prSpatialHash *sh) {
     if (sh == NULL) return;
@@ -80,17 +209,20 @@ void prReleaseSpatialHash(prSpatialHash *sh) {
     for (int i = 0; i < hmlen(sh->entries); i++)
         arrfree(sh->entries[i].value);
 
-    hmfree(sh->entries), arrfree(sh->queryResult), free(sh);
+    hmfree(sh->entries), arrfree(sh->proxies);
+
+    prReleaseMemory(sh);
 }
 
 /* Erases all elements from `sh`. */
 void prClearSpatialHash(prSpatialHash *sh) {
     if (sh == NULL) return;
 
-    arrsetlen(sh->queryResult, 0);
-
     for (int i = 0; i < hmlen(sh->entries); i++)
         arrsetlen(sh->entries[i].value, 0);
+
+    for (int i = 0; i < arrlen(sh->proxies); i++)
+        sh->proxies[i].range = EMPTY_PROXY.range;
 }
 
 /* Returns the cell size of `sh`. */
@@ -98,34 +230,92 @@ float prGetSpatialHashCellSize(const prSpatialHash *sh) {
     return (sh != NULL) ? sh->cellSize : 0.0f;
 }
 
+/* Returns `true` if `sh` keeps its elements across steps. */
+bool prIsSpatialHashPersistent(const prSpatialHash *sh) {
+    return (sh != NULL) ? sh->persistent : false;
+}
+
+/* 
+    Returns the number of times a cell of `sh` has been updated (or visited 
+    by a query) so far, or `0` if `PR_DISABLE_STATS` is defined.
+*/
+size_t prGetSpatialHashTouchCount(const prSpatialHash *sh) {
+    return (sh != NULL) ? sh->touchCount : 0;
+}
+
 /* Inserts a `key`-`value` pair into `sh`. */
 void prInsertToSpatialHash(prSpatialHash *sh, prAABB key, int value) {
-    if (sh == NULL) return;
+    if (sh == NULL || value < 0) return;
 
-    const float inverseCellSize = sh->inverseCellSize;
+    // NOTE: A persistent spatial hash must keep track of the range of each value
+    if (sh->persistent) {
+        prUpdateSpatialHash(sh, key, value);
 
-    const int minX = key.x * inverseCellSize;
-    const int minY = key.y * inverseCellSize;
+        return;
+    }
 
-    const int maxX = (key.x + key.width) * inverseCellSize;
-    const int maxY = (key.y + key.height) * inverseCellSize;
+    const prSpatialHashRange range = prComputeSpatialHashRange(sh, key);
 
-    for (int y = minY; y <= maxY; y++)
-        for (int x = minX; x <= maxX; x++) {
-            const prSpatialHashKey key = { x, y };
+    for (int y = range.minY; y <= range.maxY; y++)
+        for (int x = range.minX; x <= range.maxX; x++)
+            prAddToSpatialHashCell(sh, x, y, value);
 
-            prSpatialHashEntry *entry = hmgetp_null(sh->entries, key);
+    prSpatialHashProxy *proxy = prGetSpatialHashProxy(sh, value);
 
-            if (entry != NULL) {
-                arrput(entry->value, value);
-            } else {
-                prSpatialHashEntry newEntry = { .key = key };
+    proxy->key = key, proxy->range = range;
+}
+
+/* 
+    Updates the `key` of `value` in `sh`, assuming `sh` is a persistent spatial hash.
+    (If `sh` is not persistent, this function will behave like `prInsertToSpatialHash()`.)
+*/
+void prUpdateSpatialHash(prSpatialHash *sh, prAABB key, int value) {
+    if (sh == NULL || value < 0) return;
 
-                arrput(newEntry.value, value);
+    if (!sh->persistent) {
+        prInsertToSpatialHash(sh, key, value);
 
-                hmputs(sh->entries, newEntry);
-            }
-        }
+        return;
+    }
+
+    prSpatialHashProxy *proxy = prGetSpatialHashProxy(sh, value);
+
+    const prSpatialHashRange oldRange = proxy->range;
+    const prSpatialHashRange newRange = prComputeSpatialHashRange(sh, key);
+
+    proxy->key = key;
+
+    // NOTE: Most of the values (e.g. static bodies) will not move at all!
+    if (oldRange.minX == newRange.minX && oldRange.minY == newRange.minY
+        && oldRange.maxX == newRange.maxX && oldRange.maxY == newRange.maxY)
+        return;
+
+    for (int y = oldRange.minY; y <= oldRange.maxY; y++)
+        for (int x = oldRange.minX; x <= oldRange.maxX; x++)
+            if (!prSpatialHashRangeContains(newRange, x, y))
+                prRemoveFromSpatialHashCell(sh, x, y, value);
+
+    for (int y = newRange.minY; y <= newRange.maxY; y++)
+        for (int x = newRange.minX; x <= newRange.maxX; x++)
+            if (!prSpatialHashRangeContains(oldRange, x, y))
+                prAddToSpatialHashCell(sh, x, y, value);
+
+    proxy->range = newRange;
+}
+
+/* Removes `value` from `sh`, assuming `sh` is a persistent spatial hash. */
+void prRemoveFromSpatialHash(prSpatialHash *sh, int value) {
+    if (sh == NULL || !sh->persistent || value < 0
+        || value >= arrlen(sh->proxies))
+        return;
+
+    const prSpatialHashRange range = sh->proxies[value].range;
+
+    for (int y = range.minY; y <= range.maxY; y++)
+        for (int x = range.minX; x <= range.maxX; x++)
+            prRemoveFromSpatialHashCell(sh, x, y, value);
+
+    sh->proxies[value].range = EMPTY_PROXY.range;
 }
 
 /* Query `sh` for any objects that are likely to overlap the given `aabb`. */
@@ -133,69 +323,820 @@ void prQuerySpatialHash(prSpatialHash *sh,
                         prAABB aabb,
                         prHashQueryFunc func,
                         void *ctx) {
-    if (sh == NULL) return;
-
-    const float inverseCellSize = sh->inverseCellSize;
-
-    const int minX = aabb.x * inverseCellSize;
-    const int minY = aabb.y * inverseCellSize;
+    if (sh == NULL || func == NULL) return;
 
-    const int maxX = (aabb.x + aabb.width) * inverseCellSize;
-    const int maxY = (aabb.y + aabb.height) * inverseCellSize;
+    const prSpatialHashRange range = prComputeSpatialHashRange(sh, aabb);
 
-    arrsetlen(sh->queryResult, 0);
+    /*
+        NOTE: Instead of collecting and sorting the objects in the query result,
+        each object is stamped as soon as it has been reported, so that
+        the callback function will be called only once for each object.
+    */
+    const uint32_t stamp = prBeginSpatialHashQuery(sh);
 
-    for (int y = minY; y <= maxY; y++) {
-        for (int x = minX; x <= maxX; x++) {
+    for (int y = range.minY; y <= range.maxY; y++) {
+        for (int x = range.minX; x <= range.maxX; x++) {
             const prSpatialHashKey key = { x, y };
 
             const prSpatialHashEntry *entry = hmgetp_null(sh->entries, key);
 
+            PR_API_STATS(sh->touchCount++);
+
             if (entry == NULL) continue;
 
-            for (int i = 0; i < arrlen(entry->value); i++)
-                arrput(sh->queryResult, entry->value[i]);
+            for (int i = 0; i < arrlen(entry->value); i++) {
+                const int value = entry->value[i];
+
+                if (sh->proxies[value].stamp == stamp) continue;
+
+                sh->proxies[value].stamp = stamp;
+
+                func(value, ctx);
+            }
+        }
+    }
+}
+
+/* 
+    Query `sh` for any objects that are likely to intersect the given `ray`,
+    visiting the cells along `ray` in order until `func` returns a distance
+    shorter than the distance to the next cell.
+*/
+void prRaycastSpatialHash(prSpatialHash *sh,
+                          prRay ray,
+                          prHashRaycastFunc func,
+                          void *ctx) {
+    if (sh == NULL || func == NULL || ray.maxDistance <= 0.0f) return;
+
+    const prVector2 direction = prVector2Normalize(ray.direction);
+
+    if (direction.x == 0.0f && direction.y == 0.0f) return;
+
+    const uint32_t stamp = prBeginSpatialHashQuery(sh);
+
+    float maxDistance = ray.maxDistance;
+
+    /*
+        NOTE: Walking a very long ray cell by cell would visit more cells
+        than there are in `sh`, so every non-empty cell is tested instead.
+    */
+    const float cellCount = (fabsf(direction.x) + fabsf(direction.y))
+                            * (maxDistance * sh->inverseCellSize);
+
+    if (!(cellCount < hmlen(sh->entries))) {
+        for (int i = 0; i < hmlen(sh->entries); i++) {
+            const prSpatialHashKey key = sh->entries[i].key;
+
+            const prAABB aabb = prGetSpatialHashCellAABB(sh, key.x, key.y);
+
+            if (!prAABBIntersectsSegment(aabb,
+                                         ray.origin,
+                                         prVector2ScalarMultiply(direction,
+                                                                 maxDistance)))
+                continue;
+
+            maxDistance = prRaycastSpatialHashCell(sh,
+                                                   &sh->entries[i],
+                                                   stamp,
+                                                   maxDistance,
+                                                   func,
+                                                   ctx);
+
+            if (maxDistance <= 0.0f) return;
+        }
+
+        return;
+    }
+
+    const float originX = ray.origin.x * sh->inverseCellSize;
+    const float originY = ray.origin.y * sh->inverseCellSize;
+
+    int cellX = floorf(originX), cellY = floorf(originY);
+
+    const int stepX = (direction.x > 0.0f) ? 1 : -1;
+    const int stepY = (direction.y > 0.0f) ? 1 : -1;
+
+    // NOTE: https://en.wikipedia.org/wiki/Digital_differential_analyzer_(graphics_algorithm)
+    const float deltaX = (direction.x != 0.0f)
+                             ? fabsf(sh->cellSize / direction.x)
+                             : FLT_MAX;
+    const float deltaY = (direction.y != 0.0f)
+                             ? fabsf(sh->cellSize / direction.y)
+                             : FLT_MAX;
+
+    float nextX = FLT_MAX, nextY = FLT_MAX;
+
+    if (direction.x != 0.0f)
+        nextX = ((cellX + (stepX > 0)) - originX) * sh->cellSize / direction.x;
+
+    if (direction.y != 0.0f)
+        nextY = ((cellY + (stepY > 0)) - originY) * sh->cellSize / direction.y;
+
+    // NOTE: The ray crosses at most `cellCount + 2` cell boundaries.
+    const int maxCellCount = cellCount + 3.0f;
+
+    for (int i = 0; i < maxCellCount; i++) {
+        /*
+            NOTE: The cells are visited as if the coordinates were floored,
+            but `prComputeSpatialHashRange()` truncates the coordinates
+            towards zero, so the negative cells must be shifted by one.
+        */
+        const prSpatialHashKey key = { .x = cellX + (cellX < 0),
+                                       .y = cellY + (cellY < 0) };
+
+        prSpatialHashEntry *entry = hmgetp_null(sh->entries, key);
+
+        if (entry != NULL) {
+            maxDistance = prRaycastSpatialHashCell(sh,
+                                                   entry,
+                                                   stamp,
+                                                   maxDistance,
+                                                   func,
+                                                   ctx);
+
+            if (maxDistance <= 0.0f) return;
+        }
+
+        float distance = 0.0f;
+
+        if (nextX < nextY) {
+            distance = nextX, nextX += deltaX, cellX += stepX;
+        } else {
+            distance = nextY, nextY += deltaY, cellY += stepY;
+        }
+
+        if (distance > maxDistance) return;
+    }
+}
+
+/* 
+    Query `sh` for all pairs of objects that are likely to overlap each other,
+    then calls `func` exactly once for each pair.
+*/
+void prQuerySpatialHashPairs(prSpatialHash *sh,
+                             prHashPairQueryFunc func,
+                             void *ctx) {
+    if (sh == NULL || func == NULL) return;
+
+    PR_API_STATS(sh->touchCount += hmlen(sh->entries));
+
+    for (int i = 0; i < hmlen(sh->entries); i++) {
+        const prSpatialHashKey key = sh->entries[i].key;
+        const prSpatialHashValue value = sh->entries[i].value;
+
+        const int valueCount = arrlen(value);
+
+        for (int j = 0; j < valueCount; j++) {
+            const prSpatialHashProxy proxy1 = sh->proxies[value[j]];
+
+            for (int k = j + 1; k < valueCount; k++) {
+                if (value[j] == value[k]) continue;
+
+                const prSpatialHashProxy proxy2 = sh->proxies[value[k]];
+
+                /*
+                    NOTE: Two objects may share more than one cell, so a pair is 
+                    only reported from the cell at the top-left corner of 
+                    the intersection of their ranges of cells.
+                */
+                const int minX = (proxy1.range.minX > proxy2.range.minX)
+                                     ? proxy1.range.minX
+                                     : proxy2.range.minX;
+                const int minY = (proxy1.range.minY > proxy2.range.minY)
+                                     ? proxy1.range.minY
+                                     : proxy2.range.minY;
+
+                if (key.x != minX || key.y != minY) continue;
+
+                if (!prAABBsOverlap(proxy1.key, proxy2.key)) continue;
+
+                if (value[j] < value[k])
+                    func(value[j], value[k], ctx);
+                else
+                    func(value[k], value[j], ctx);
+            }
         }
     }
+}
+
+/* 
+    Creates a new dynamic AABB tree, which stores the AABB of each value
+    enlarged by `margin` in order to avoid updating the tree on small movements.
+*/
+prDynamicTree *prCreateDynamicTree(float margin) {
+    if (margin < 0.0f) return NULL;
+
+    // NOTE: `dt->nodes`, `dt->leaves` and `dt->stack` must be initialized to `NULL`
+    prDynamicTree *dt = prAllocateMemory(sizeof *dt);
+
+    dt->margin = margin;
+    dt->root = dt->freeList = -1;
+
+    return dt;
+}
+
+/* Releases the memory allocated by `dt`. */
+void prReleaseDynamicTree(prDynamicTree *dt) {
+    if (dt == NULL) return;
+
+    arrfree(dt->nodes), arrfree(dt->leaves), arrfree(dt->stack);
+
+    prReleaseMemory(dt);
+}
+
+/* Erases all elements from `dt`. */
+void prClearDynamicTree(prDynamicTree *dt) {
+    if (dt == NULL) return;
+
+    dt->root = dt->freeList = -1;
+
+    arrsetlen(dt->nodes, 0), arrsetlen(dt->leaves, 0);
+}
+
+/* Returns the AABB margin of `dt`. */
+float prGetDynamicTreeMargin(const prDynamicTree *dt) {
+    return (dt != NULL) ? dt->margin : 0.0f;
+}
+
+/* Returns the enlarged AABB of `value` in `dt`, or an empty AABB if there is none. */
+prAABB prGetDynamicTreeAABB(const prDynamicTree *dt, int value) {
+    if (dt == NULL || value < 0 || value >= arrlen(dt->leaves)
+        || dt->leaves[value] < 0)
+        return PR_API_STRUCT_ZERO(prAABB);
 
-    const size_t oldLength = arrlen(sh->queryResult);
+    return dt->nodes[dt->leaves[value]].aabb;
+}
+
+/* 
+    Inserts `value` into `dt` with the given `key`, or updates the `key` of `value`
+    if `value` is already in `dt`, but only if `key` is no longer contained 
+    in its enlarged AABB, then returns `true` if the enlarged AABB of `value` changed.
+*/
+bool prUpdateDynamicTree(prDynamicTree *dt, prAABB key, int value) {
+    if (dt == NULL || value < 0) return false;
+
+    while (arrlen(dt->leaves) <= value)
+        arrput(dt->leaves, -1);
+
+    int leafIndex = dt->leaves[value];
 
-    if (oldLength > 1) {
-        // NOTE: Sort the array first, then remove duplicates!
-        qsort(sh->queryResult,
-              oldLength,
-              sizeof *(sh->queryResult),
-              prQSortCompare);
+    prVector2 displacement = { .x = 0.0f, .y = 0.0f };
 
-        size_t newLength = 0;
+    if (leafIndex >= 0) {
+        // NOTE: Most of the values (e.g. static bodies) will not move at all!
+        if (prAABBContainsAABB(dt->nodes[leafIndex].aabb, key)) return false;
 
-        for (int i = 0; i < oldLength; i++)
-            if (sh->queryResult[i] != sh->queryResult[i + 1])
-                sh->queryResult[newLength++] = sh->queryResult[i];
+        displacement = (prVector2) {
+            .x = key.x - dt->nodes[leafIndex].position.x,
+            .y = key.y - dt->nodes[leafIndex].position.y
+        };
 
-        if (sh->queryResult[newLength - 1] != sh->queryResult[oldLength - 1])
-            sh->queryResult[newLength++] = sh->queryResult[oldLength - 1];
+        prRemoveDynamicTreeLeaf(dt, leafIndex);
+    } else {
+        leafIndex = prAllocateDynamicTreeNode(dt);
 
-        arrsetlen(sh->queryResult, newLength);
+        dt->nodes[leafIndex].value = value;
+
+        dt->leaves[value] = leafIndex;
     }
 
     /*
-        NOTE: For each object in the query result, the callback function will be called
-        with the user data pointer `ctx`.
+        NOTE: The enlarged AABB is also stretched ahead along the displacement 
+        since the last update, as a moving value will likely keep moving that way.
     */
-    for (int i = 0; i < arrlen(sh->queryResult); i++)
-        func(sh->queryResult[i], ctx);
+    displacement = prVector2ScalarMultiply(displacement, TREE_DISPLACEMENT_FACTOR);
+
+    dt->nodes[leafIndex].aabb = (prAABB) {
+        .x = key.x - dt->margin + fminf(displacement.x, 0.0f),
+        .y = key.y - dt->margin + fminf(displacement.y, 0.0f),
+        .width = key.width + 2.0f * dt->margin + fabsf(displacement.x),
+        .height = key.height + 2.0f * dt->margin + fabsf(displacement.y)
+    };
+
+    dt->nodes[leafIndex].position = (prVector2) { .x = key.x, .y = key.y };
+
+    prInsertDynamicTreeLeaf(dt, leafIndex);
+
+    return true;
+}
+
+/* Removes `value` from `dt`. */
+void prRemoveFromDynamicTree(prDynamicTree *dt, int value) {
+    if (dt == NULL || value < 0 || value >= arrlen(dt->leaves)) return;
+
+    const int leafIndex = dt->leaves[value];
+
+    if (leafIndex < 0) return;
+
+    prRemoveDynamicTreeLeaf(dt, leafIndex);
+    prFreeDynamicTreeNode(dt, leafIndex);
+
+    dt->leaves[value] = -1;
+}
+
+/* Query `dt` for any objects that are likely to overlap the given `aabb`. */
+void prQueryDynamicTree(prDynamicTree *dt,
+                        prAABB aabb,
+                        prHashQueryFunc func,
+                        void *ctx) {
+    if (dt == NULL || dt->root < 0 || func == NULL) return;
+
+    arrsetlen(dt->stack, 0);
+
+    arrput(dt->stack, dt->root);
+
+    while (arrlen(dt->stack) > 0) {
+        const int index = arrpop(dt->stack);
+
+        const prDynamicTreeNode node = dt->nodes[index];
+
+        if (!prAABBsOverlap(node.aabb, aabb)) continue;
+
+        if (node.height == 0) {
+            func(node.value, ctx);
+        } else {
+            arrput(dt->stack, node.right);
+            arrput(dt->stack, node.left);
+        }
+    }
+}
+
+/* 
+    Query `dt` for any objects that are likely to intersect the given `ray`,
+    shortening `ray` to the distance returned by `func` for each object.
+*/
+void prRaycastDynamicTree(prDynamicTree *dt,
+                          prRay ray,
+                          prHashRaycastFunc func,
+                          void *ctx) {
+    if (dt == NULL || dt->root < 0 || func == NULL || ray.maxDistance <= 0.0f)
+        return;
+
+    const prVector2 direction = prVector2Normalize(ray.direction);
+
+    float maxDistance = ray.maxDistance;
+
+    prVector2 delta = prVector2ScalarMultiply(direction, maxDistance);
+
+    arrsetlen(dt->stack, 0);
+
+    arrput(dt->stack, dt->root);
+
+    while (arrlen(dt->stack) > 0) {
+        const int index = arrpop(dt->stack);
+
+        const prDynamicTreeNode node = dt->nodes[index];
+
+        if (!prAABBIntersectsSegment(node.aabb, ray.origin, delta)) continue;
+
+        if (node.height == 0) {
+            const float distance = func(node.value, ctx);
+
+            if (maxDistance <= distance) continue;
+
+            if (distance <= 0.0f) return;
+
+            maxDistance = distance;
+
+            delta = prVector2ScalarMultiply(direction, maxDistance);
+        } else {
+            arrput(dt->stack, node.right);
+            arrput(dt->stack, node.left);
+        }
+    }
 }
 
 /* Private Functions ==================================================================== */
 
+/* Returns the range of cells in `sh` that overlap the given `aabb`. */
+static PR_API_INLINE prSpatialHashRange
+prComputeSpatialHashRange(const prSpatialHash *sh, prAABB aabb) {
+    const float inverseCellSize = sh->inverseCellSize;
+
+    return (prSpatialHashRange) {
+        .minX = aabb.x * inverseCellSize,
+        .minY = aabb.y * inverseCellSize,
+        .maxX = (aabb.x + aabb.width) * inverseCellSize,
+        .maxY = (aabb.y + aabb.height) * inverseCellSize
+    };
+}
+
+/* Checks whether the cell at (`x`, `y`) lies inside `range`. */
+static PR_API_INLINE bool
+prSpatialHashRangeContains(prSpatialHashRange range, int x, int y) {
+    return (x >= range.minX && x <= range.maxX)
+           && (y >= range.minY && y <= range.maxY);
+}
+
+/* Adds `value` to the cell at (`x`, `y`) of `sh`. */
+static void prAddToSpatialHashCell(prSpatialHash *sh, int x, int y, int value) {
+    const prSpatialHashKey key = { x, y };
+
+    prSpatialHashEntry *entry = hmgetp_null(sh->entries, key);
+
+    PR_API_STATS(sh->touchCount++);
+
+    if (entry != NULL) {
+        arrput(entry->value, value);
+    } else {
+        prSpatialHashEntry newEntry = { .key = key };
+
+        arrput(newEntry.value, value);
+
+        hmputs(sh->entries, newEntry);
+    }
+}
+
+/* Removes `value` from the cell at (`x`, `y`) of `sh`. */
+static void
+prRemoveFromSpatialHashCell(prSpatialHash *sh, int x, int y, int value) {
+    const prSpatialHashKey key = { x, y };
+
+    prSpatialHashEntry *entry = hmgetp_null(sh->entries, key);
+
+    PR_API_STATS(sh->touchCount++);
+
+    if (entry == NULL) return;
+
+    for (int i = 0; i < arrlen(entry->value); i++) {
+        if (entry->value[i] != value) continue;
+
+        // NOTE: The order of values in a cell does not matter.
+        arrdelswap(entry->value, i);
+
+        /*
+            NOTE: An empty cell would still be visited by every pair query
+            (and every long raycast), so it is removed from `sh` right away.
+        */
+        if (arrlen(entry->value) == 0) {
+            arrfree(entry->value);
+
+            hmdel(sh->entries, key);
+        }
+
+        return;
+    }
+}
+
+/* Returns the information of `value` in `sh`, creating it if necessary. */
+static prSpatialHashProxy *prGetSpatialHashProxy(prSpatialHash *sh, int value) {
+    while (arrlen(sh->proxies) <= value)
+        arrput(sh->proxies, EMPTY_PROXY);
+
+    return &sh->proxies[value];
+}
+
+/* Starts a new query on `sh`, then returns its stamp. */
+static uint32_t prBeginSpatialHashQuery(prSpatialHash *sh) {
+    // NOTE: Resets all stamps once in a while, when the stamp wraps around.
+    if (++sh->epoch == 0) {
+        for (int i = 0; i < arrlen(sh->proxies); i++)
+            sh->proxies[i].stamp = 0;
+
+        sh->epoch = 1;
+    }
+
+    return sh->epoch;
+}
+
+/* Returns the AABB of the cell at (`x`, `y`) of `sh`. */
+static PR_API_INLINE prAABB prGetSpatialHashCellAABB(const prSpatialHash *sh,
+                                                     int x,
+                                                     int y) {
+    /*
+        NOTE: Since `prComputeSpatialHashRange()` truncates the coordinates 
+        towards zero, the cells next to the axes are twice as large.
+    */
+    return (prAABB) { .x = ((x > 0) ? x : x - 1) * sh->cellSize,
+                      .y = ((y > 0) ? y : y - 1) * sh->cellSize,
+                      .width = ((x == 0) ? 2 : 1) * sh->cellSize,
+                      .height = ((y == 0) ? 2 : 1) * sh->cellSize };
+}
+
 /* 
-    Returns ​a negative integer value if `a` is less than `b`, ​a positive integer value 
-    if `a` is greater than `b` and zero if `a` and `b` are equivalent.
+    Calls `func` for each value in `entry` that has not been stamped with `stamp`,
+    then returns the new maximum distance of the ray.
 */
-static int prQSortCompare(const void *a, const void *b) {
-    const int x = *(const int *) a;
-    const int y = *(const int *) b;
+static float prRaycastSpatialHashCell(prSpatialHash *sh,
+                                      prSpatialHashEntry *entry,
+                                      uint32_t stamp,
+                                      float maxDistance,
+                                      prHashRaycastFunc func,
+                                      void *ctx) {
+    PR_API_STATS(sh->touchCount++);
+
+    for (int i = 0; i < arrlen(entry->value); i++) {
+        const int value = entry->value[i];
+
+        if (sh->proxies[value].stamp == stamp) continue;
+
+        sh->proxies[value].stamp = stamp;
+
+        const float distance = func(value, ctx);
+
+        if (maxDistance > distance) maxDistance = distance;
+
+        if (maxDistance <= 0.0f) break;
+    }
+
+    return maxDistance;
+}
+
+/* Allocates a new node from `dt`, then returns its index. */
+static int prAllocateDynamicTreeNode(prDynamicTree *dt) {
+    int result = dt->freeList;
+
+    if (result >= 0) {
+        dt->freeList = dt->nodes[result].parent;
+    } else {
+        result = arrlen(dt->nodes);
+
+        arrput(dt->nodes, PR_API_STRUCT_ZERO(prDynamicTreeNode));
+    }
+
+    dt->nodes[result] = (prDynamicTreeNode) {
+        .parent = -1, .left = -1, .right = -1, .height = 0, .value = -1
+    };
+
+    return result;
+}
+
+/* Returns the node with the given `index` to the free list of `dt`. */
+static void prFreeDynamicTreeNode(prDynamicTree *dt, int index) {
+    // NOTE: The `parent` field of a free node points to the next free node.
+    dt->nodes[index].parent = dt->freeList;
+    dt->nodes[index].height = -1;
+
+    dt->freeList = index;
+}
+
+/* Inserts the leaf node with the given `index` into `dt`. */
+static void prInsertDynamicTreeLeaf(prDynamicTree *dt, int index) {
+    if (dt->root < 0) {
+        dt->root = index, dt->nodes[index].parent = -1;
+
+        return;
+    }
+
+    const prAABB leafAABB = dt->nodes[index].aabb;
+
+    int siblingIndex = dt->root;
+
+    /*
+        NOTE: Finds the best sibling for the new leaf node 
+        with the surface area heuristic (SAH), using perimeters instead of areas.
+    */
+    while (dt->nodes[siblingIndex].height > 0) {
+        const prDynamicTreeNode node = dt->nodes[siblingIndex];
+
+        const float perimeter = prGetAABBPerimeter(node.aabb);
+        const float combinedPerimeter = prGetAABBPerimeter(
+            prCombineAABBs(node.aabb, leafAABB));
 
-    return (x > y) - (x < y);
-}
\ No newline at end of file
+        // NOTE: The cost of creating a new parent for this node and the new leaf.
+        const float cost = 2.0f * combinedPerimeter;
+
+        // NOTE: The minimum cost of pushing the new leaf further down the tree.
+        const float inheritanceCost = 2.0f * (combinedPerimeter - perimeter);
+
+        float childCosts[2];
+
+        const int childIndexes[2] = { node.left, node.right };
+
+        for (int i = 0; i < 2; i++) {
+            const prDynamicTreeNode child = dt->nodes[childIndexes[i]];
+
+            const float childPerimeter = prGetAABBPerimeter(
+                prCombineAABBs(child.aabb, leafAABB));
+
+            childCosts[i] = (child.height == 0)
+                                ? childPerimeter + inheritanceCost
+                                : (childPerimeter
+                                   - prGetAABBPerimeter(child.aabb))
+                                      + inheritanceCost;
+        }
+
+        if (cost < childCosts[0] && cost < childCosts[1]) break;
+
+        siblingIndex = (childCosts[0] < childCosts[1]) ? childIndexes[0]
+                                                       : childIndexes[1];
+    }
+
+    const int oldParentIndex = dt->nodes[siblingIndex].parent;
+    const int newParentIndex = prAllocateDynamicTreeNode(dt);
+
+    dt->nodes[newParentIndex].parent = oldParentIndex;
+    dt->nodes[newParentIndex].left = siblingIndex;
+    dt->nodes[newParentIndex].right = index;
+    dt->nodes[newParentIndex].height = dt->nodes[siblingIndex].height + 1;
+    dt->nodes[newParentIndex].aabb = prCombineAABBs(dt->nodes[siblingIndex]
+                                                        .aabb,
+                                                    leafAABB);
+
+    if (oldParentIndex >= 0) {
+        if (dt->nodes[oldParentIndex].left == siblingIndex)
+            dt->nodes[oldParentIndex].left = newParentIndex;
+        else
+            dt->nodes[oldParentIndex].right = newParentIndex;
+    } else {
+        dt->root = newParentIndex;
+    }
+
+    dt->nodes[siblingIndex].parent = dt->nodes[index].parent = newParentIndex;
+
+    prRefitDynamicTree(dt, newParentIndex);
+}
+
+/* Removes the leaf node with the given `index` from `dt`. */
+static void prRemoveDynamicTreeLeaf(prDynamicTree *dt, int index) {
+    if (dt->root == index) {
+        dt->root = -1;
+
+        return;
+    }
+
+    const int parentIndex = dt->nodes[index].parent;
+    const int grandParentIndex = dt->nodes[parentIndex].parent;
+
+    const int siblingIndex = (dt->nodes[parentIndex].left == index)
+                                 ? dt->nodes[parentIndex].right
+                                 : dt->nodes[parentIndex].left;
+
+    dt->nodes[siblingIndex].parent = grandParentIndex;
+
+    if (grandParentIndex >= 0) {
+        if (dt->nodes[grandParentIndex].left == parentIndex)
+            dt->nodes[grandParentIndex].left = siblingIndex;
+        else
+            dt->nodes[grandParentIndex].right = siblingIndex;
+
+        prFreeDynamicTreeNode(dt, parentIndex);
+
+        prRefitDynamicTree(dt, grandParentIndex);
+    } else {
+        dt->root = siblingIndex;
+
+        prFreeDynamicTreeNode(dt, parentIndex);
+    }
+
+    dt->nodes[index].parent = -1;
+}
+
+/* Refits and balances the ancestors of the node with the given `index`. */
+static void prRefitDynamicTree(prDynamicTree *dt, int index) {
+    while (index >= 0) {
+        index = prBalanceDynamicTree(dt, index);
+
+        prDynamicTreeNode *node = &dt->nodes[index];
+
+        const prDynamicTreeNode left = dt->nodes[node->left];
+        const prDynamicTreeNode right = dt->nodes[node->right];
+
+        node->height = 1 + ((left.height > right.height) ? left.height
+                                                          : right.height);
+        node->aabb = prCombineAABBs(left.aabb, right.aabb);
+
+        index = node->parent;
+    }
+}
+
+/* 
+    Performs a left or right rotation if the node with the given `index` is imbalanced,
+    then returns the index of the new subtree root.
+*/
+static int prBalanceDynamicTree(prDynamicTree *dt, int index) {
+    prDynamicTreeNode *a = &dt->nodes[index];
+
+    if (a->height < 2) return index;
+
+    const int bIndex = a->left, cIndex = a->right;
+
+    prDynamicTreeNode *b = &dt->nodes[bIndex], *c = &dt->nodes[cIndex];
+
+    const int balance = c->height - b->height;
+
+    /*
+        NOTE: If `c` is too tall, `c` will be rotated up and become 
+        the new subtree root; the same goes for `b`.
+    */
+    if (balance > 1 || balance < -1) {
+        const int upIndex = (balance > 1) ? cIndex : bIndex;
+        const int otherIndex = (balance > 1) ? bIndex : cIndex;
+
+        prDynamicTreeNode *up = &dt->nodes[upIndex];
+        prDynamicTreeNode *other = &dt->nodes[otherIndex];
+
+        const int fIndex = up->left, gIndex = up->right;
+
+        prDynamicTreeNode *f = &dt->nodes[fIndex], *g = &dt->nodes[gIndex];
+
+        // NOTE: Swaps `a` and `up`.
+        up->left = index;
+        up->parent = a->parent;
+
+        a->parent = upIndex;
+
+        if (up->parent >= 0) {
+            if (dt->nodes[up->parent].left == index)
+                dt->nodes[up->parent].left = upIndex;
+            else
+                dt->nodes[up->parent].right = upIndex;
+        } else {
+            dt->root = upIndex;
+        }
+
+        // NOTE: The taller child of `up` stays with `up`.
+        const int keptIndex = (f->height > g->height) ? fIndex : gIndex;
+        const int movedIndex = (f->height > g->height) ? gIndex : fIndex;
+
+        prDynamicTreeNode *kept = &dt->nodes[keptIndex];
+        prDynamicTreeNode *moved = &dt->nodes[movedIndex];
+
+        up->right = keptIndex;
+
+        if (balance > 1)
+            a->right = movedIndex;
+        else
+            a->left = movedIndex;
+
+        moved->parent = index;
+
+        a->aabb = prCombineAABBs(other->aabb, moved->aabb);
+        up->aabb = prCombineAABBs(a->aabb, kept->aabb);
+
+        a->height = 1 + ((other->height > moved->height) ? other->height
+                                                          : moved->height);
+        up->height = 1 + ((a->height > kept->height) ? a->height
+                                                      : kept->height);
+
+        return upIndex;
+    }
+
+    return index;
+}
+
+/* Returns the smallest AABB that contains both `a1` and `a2`. */
+static PR_API_INLINE prAABB prCombineAABBs(prAABB a1, prAABB a2) {
+    const float minX = fminf(a1.x, a2.x), minY = fminf(a1.y, a2.y);
+
+    const float maxX = fmaxf(a1.x + a1.width, a2.x + a2.width);
+    const float maxY = fmaxf(a1.y + a1.height, a2.y + a2.height);
+
+    return (prAABB) {
+        .x = minX, .y = minY, .width = maxX - minX, .height = maxY - minY
+    };
+}
+
+/* Returns the perimeter of `a`. */
+static PR_API_INLINE float prGetAABBPerimeter(prAABB a) {
+    return 2.0f * (a.width + a.height);
+}
+
+/* Checks whether `a1` contains `a2`. */
+static PR_API_INLINE bool prAABBContainsAABB(prAABB a1, prAABB a2) {
+    return (a1.x <= a2.x && a1.y <= a2.y)
+           && (a2.x + a2.width <= a1.x + a1.width)
+           && (a2.y + a2.height <= a1.y + a1.height);
+}
+
+/* 
+    Checks whether the line segment from `origin` to `origin + delta` 
+    intersects `a`. 
+*/
+static bool prAABBIntersectsSegment(prAABB a, prVector2 origin, prVector2 delta) {
+    const float minValues[2] = { a.x, a.y };
+    const float maxValues[2] = { a.x + a.width, a.y + a.height };
+
+    const float origins[2] = { origin.x, origin.y };
+    const float deltas[2] = { delta.x, delta.y };
+
+    float minLambda = 0.0f, maxLambda = 1.0f;
+
+    // NOTE: https://en.wikipedia.org/wiki/Slab_method
+    for (int i = 0; i < 2; i++) {
+        if (deltas[i] == 0.0f) {
+            if (origins[i] < minValues[i] || origins[i] > maxValues[i])
+                return false;
+
+            continue;
+        }
+
+        const float inverseDelta = 1.0f / deltas[i];
+
+        float lambda1 = (minValues[i] - origins[i]) * inverseDelta;
+        float lambda2 = (maxValues[i] - origins[i]) * inverseDelta;
+
+        if (lambda1 > lambda2) {
+            const float temp = lambda1;
+
+            lambda1 = lambda2, lambda2 = temp;
+        }
+
+        if (minLambda < lambda1) minLambda = lambda1;
+        if (maxLambda > lambda2) maxLambda = lambda2;
+
+        if (minLambda > maxLambda) return false;
+    }
+
+    return true;
+}
@@ -35,6 +35,39 @@ typedef struct _prEdge {
     int count;
 } prEdge;
 
+/* A structure that represents a collision shape transformed to world space. */
+typedef struct _prTransformedShape {
+    const prShape *shape;
+    prTransform tx;
+    const prVertices *vertices, *normals;
+} prTransformedShape;
+
+/* 
+    A structure that represents a line segment of a 'chain' collision shape 
+    in world space, with the vertex after it (if it is not the last segment).
+*/
+typedef struct _prChainSegment {
+    prVector2 data[2];
+    prVector2 next;
+    bool hasPrevious, hasNext;
+} prChainSegment;
+
+/* A structure that represents the context data for `prChainQueryCallback()`. */
+typedef struct _prChainQueryCtx {
+    const prTransformedShape *s1, *s2;
+    prCollision *collision;
+    float maxDepth;
+    bool colliding;
+} prChainQueryCtx;
+
+/* A structure that represents the context data for `prChainRaycastQueryCallback()`. */
+typedef struct _prChainRaycastQueryCtx {
+    prTransformedShape chain;
+    prRay ray;
+    prRaycastHit *hit;
+    float minLambda;
+} prChainRaycastQueryCtx;
+
 /* Private Function Prototypes ========================================================== */
 
 /* 
@@ -43,15 +76,22 @@ typedef struct _prEdge {
 */
 static bool prClipEdge(prEdge *e, prVector2 v, float dot);
 
+/* 
+    Checks whether `s1` and `s2` are colliding, testing the separating axis 
+    at `axis` first (if any), then stores the collision information to `collision`.
+*/
+static bool prComputeTransformedCollision(const prTransformedShape *s1,
+                                          const prTransformedShape *s2,
+                                          prCollision *collision,
+                                          int *axis);
+
 /* 
     Checks whether `s1` and `s2` are colliding,
     assuming `s1` and `s2` are 'circle' collision shapes,
     then stores the collision information to `collision`.
 */
-static bool prComputeCollisionCircles(const prShape *s1,
-                                      prTransform tx1,
-                                      const prShape *s2,
-                                      prTransform tx2,
+static bool prComputeCollisionCircles(const prTransformedShape *s1,
+                                      const prTransformedShape *s2,
                                       prCollision *collision);
 
 /* 
@@ -59,23 +99,86 @@ static bool prComputeCollisionCircles(const prShape *s1,
     assuming `s1` is a 'circle' collision shape and `s2` is a 'polygon' collision shape,
     then stores the collision information to `collision`.
 */
-static bool prComputeCollisionCirclePoly(const prShape *s1,
-                                         prTransform tx1,
-                                         const prShape *s2,
-                                         prTransform tx2,
+static bool prComputeCollisionCirclePoly(const prTransformedShape *s1,
+                                         const prTransformedShape *s2,
                                          prCollision *collision);
 
 /* 
     Checks whether `s1` and `s2` are colliding,
     assuming `s1` and `s2` are 'polygon' collision shapes,
+    testing the separating axis at `axis` first (if any),
+    then stores the collision information to `collision`.
+*/
+static bool prComputeCollisionPolys(const prTransformedShape *s1,
+                                    const prTransformedShape *s2,
+                                    prCollision *collision,
+                                    int *axis);
+
+/* 
+    Computes the contact points of the edges `edge1` and `edge2` of two polygons
+    colliding along `direction`, then stores them to `collision`.
+*/
+static bool prComputePolyContacts(prEdge edge1,
+                                  prEdge edge2,
+                                  prVector2 direction,
+                                  prCollision *collision);
+
+/* 
+    Checks whether `s1` and `s2` are colliding, assuming either of them is
+    a 'chain' collision shape, along the line segment of the chain at `index`,
     then stores the collision information to `collision`.
 */
-static bool prComputeCollisionPolys(const prShape *s1,
-                                    prTransform tx1,
-                                    const prShape *s2,
-                                    prTransform tx2,
+static bool prComputeCollisionChain(const prTransformedShape *s1,
+                                    const prTransformedShape *s2,
+                                    int index,
                                     prCollision *collision);
 
+/* 
+    Checks whether `circle` and `segment` are colliding, then stores
+    the collision information from `circle` to `segment` (or the other way around
+    if `flipped` is `true`) to `collision`.
+*/
+static bool prComputeCollisionCircleSegment(const prTransformedShape *circle,
+                                            const prChainSegment *segment,
+                                            bool flipped,
+                                            prCollision *collision);
+
+/* 
+    Checks whether `poly` and `segment` are colliding, then stores
+    the collision information from `poly` to `segment` (or the other way around
+    if `flipped` is `true`) to `collision`.
+*/
+static bool prComputeCollisionPolySegment(const prTransformedShape *poly,
+                                          const prChainSegment *segment,
+                                          bool flipped,
+                                          prCollision *collision);
+
+/* 
+    Checks whether `s1` and `s2` are colliding, assuming either of them is 
+    a 'compound' collision shape, then stores the deepest collision information 
+    between their children to `collision`.
+*/
+static bool prComputeCollisionCompound(const prTransformedShape *s1,
+                                       const prTransformedShape *s2,
+                                       prCollision *collision);
+
+/* Casts a `ray` against `ts`. */
+static bool prComputeTransformedRaycast(const prTransformedShape *ts,
+                                        prRay ray,
+                                        prRaycastHit *raycastHit);
+
+/* 
+    A callback function for `prQueryChain()` that keeps the deepest collision
+    between the shapes of `ctx` along each line segment of the chain.
+*/
+static bool prChainQueryCallback(int index, void *ctx);
+
+/* 
+    A callback function for `prQueryChain()` that will be called
+    during `prComputeRaycast()`.
+*/
+static bool prChainRaycastQueryCallback(int index, void *ctx);
+
 /* Computes the intersection of a circle and a line. */
 static bool prComputeIntersectionCircleLine(prVector2 center,
                                             float radius,
@@ -83,26 +186,55 @@ static bool prComputeIntersectionCircleLine(prVector2 center,
                                             prVector2 direction,
                                             float *lambda);
 
-/* Computes the intersection of two lines. */
-static bool prComputeIntersectionLines(prVector2 origin1,
-                                       prVector2 direction1,
-                                       prVector2 origin2,
-                                       prVector2 direction2,
-                                       float *lambda);
+/* 
+    Computes the intersection of a ray from `origin1` along `direction1`
+    and a line segment from `origin2` to `origin2 + direction2`.
+*/
+static bool prComputeIntersectionRaySegment(prVector2 origin1,
+                                            prVector2 direction1,
+                                            prVector2 origin2,
+                                            prVector2 direction2,
+                                            float *lambda);
 
 /* Returns the edge of `s` that is most perpendicular to `v`. */
-static prEdge prGetContactEdge(const prShape *s, prTransform tx, prVector2 v);
+static prEdge prGetContactEdge(const prTransformedShape *s, prVector2 v);
+
+/* 
+    Returns the line segment of `s` (a 'chain' collision shape) at `index`,
+    transformed through the transform of `s`.
+*/
+static prChainSegment prGetChainSegment(const prTransformedShape *s,
+                                        int index);
+
+/* 
+    Stores the child of `s` at `index` to `child`, with its vertices and normals
+    transformed to `vertices` and `normals` if `s` is a 'compound' collision shape.
+    (Any other collision shape is its own child, including a 'chain' collision shape.)
+*/
+static void prGetTransformedChild(const prTransformedShape *s,
+                                  int index,
+                                  prTransformedShape *child,
+                                  prVertices *vertices,
+                                  prVertices *normals);
+
+/* Returns the depth of the deepest contact point in `collision`. */
+static PR_API_INLINE float prGetCollisionDepth(const prCollision *collision);
 
 /* Finds the axis of minimum penetration from `s1` to `s2`, then returns its index. */
-static int prGetSeparatingAxisIndex(const prShape *s1,
-                                    prTransform tx1,
-                                    const prShape *s2,
-                                    prTransform tx2,
+static int prGetSeparatingAxisIndex(const prTransformedShape *s1,
+                                    const prTransformedShape *s2,
                                     float *depth);
 
+/* 
+    Returns the distance from `s1` to `s2` along the normal of `s1` at `index`,
+    which is negative if `s1` and `s2` overlap along that normal.
+*/
+static float prGetSeparatingAxisDepth(const prTransformedShape *s1,
+                                      const prTransformedShape *s2,
+                                      int index);
+
 /* Finds the vertex farthest along `v`, then returns its index. */
-static int
-prGetSupportPointIndex(const prVertices *vertices, prTransform tx, prVector2 v);
+static int prGetSupportPointIndex(const prVertices *vertices, prVector2 v);
 
 /* Public Functions ===================================================================== */
 
@@ -117,99 +249,137 @@ bool prComputeCollision(const prShape *s1,
                         prCollision *collision) {
     if (s1 == NULL || s2 == NULL) return false;
 
-    prShapeType t1 = prGetShapeType(s1);
-    prShapeType t2 = prGetShapeType(s2);
+    prVertices vertices1, normals1, vertices2, normals2;
+
+    // NOTE: Each vertex and normal is transformed only once for each call.
+    prTransformPolygon(s1, tx1, &vertices1, &normals1);
+    prTransformPolygon(s2, tx2, &vertices2, &normals2);
+
+    return prComputeTransformedCollision(
+        &(const prTransformedShape) { .shape = s1,
+                                      .tx = tx1,
+                                      .vertices = &vertices1,
+                                      .normals = &normals1 },
+        &(const prTransformedShape) { .shape = s2,
+                                      .tx = tx2,
+                                      .vertices = &vertices2,
+                                      .normals = &normals2 },
+        collision,
+        NULL);
+}
 
-    if (t1 == PR_SHAPE_CIRCLE && t2 == PR_SHAPE_CIRCLE)
-        return prComputeCollisionCircles(s1, tx1, s2, tx2, collision);
-    else if ((t1 == PR_SHAPE_CIRCLE && t2 == PR_SHAPE_POLYGON)
-             || (t1 == PR_SHAPE_POLYGON && t2 == PR_SHAPE_CIRCLE))
-        return prComputeCollisionCirclePoly(s1, tx1, s2, tx2, collision);
-    else if (t1 == PR_SHAPE_POLYGON && t2 == PR_SHAPE_POLYGON)
-        return prComputeCollisionPolys(s1, tx1, s2, tx2, collision);
-    else
-        return false;
+/* 
+    Checks whether the collision shapes of `b1` and `b2` are colliding,
+    using the world-space vertices and normals cached in `b1` and `b2`,
+    then stores the collision information to `collision`.
+*/
+bool prComputeBodyCollision(const prBody *b1,
+                            const prBody *b2,
+                            prCollision *collision) {
+    return prComputeBodyCollisionWithAxis(b1, b2, collision, NULL);
 }
 
-bool prComputeRaycast(const prBody *b, prRay ray, prRaycastHit *raycastHit) {
-    if (b == NULL) return false;
-    ray.direction = prVector2Normalize(ray.direction);
+/* 
+    Checks whether the collision shapes of `b1` and `b2` are colliding like
+    `prComputeBodyCollision()`, but if both shapes are polygons, tests the axis 
+    at `axis` first (if it is not `-1`), then stores the axis that separates 
+    (or least penetrates) the polygons to `axis`.
+*/
+bool prComputeBodyCollisionWithAxis(const prBody *b1,
+                                    const prBody *b2,
+                                    prCollision *collision,
+                                    int *axis) {
+    const prShape *s1 = prGetBodyShape(b1), *s2 = prGetBodyShape(b2);
 
-    const prShape *s = prGetBodyShape(b);
-    prTransform tx = prGetBodyTransform(b);
+    if (s1 == NULL || s2 == NULL) return false;
 
-    prShapeType type = prGetShapeType(s);
+    // NOTE: A pair of circles needs neither the vertices nor the normals.
+    if (prGetShapeType(s1) == PR_SHAPE_CIRCLE
+        && prGetShapeType(s2) == PR_SHAPE_CIRCLE)
+        return prComputeCollisionCircles(
+            &(const prTransformedShape) { .shape = s1,
+                                          .tx = prGetBodyTransform(b1) },
+            &(const prTransformedShape) { .shape = s2,
+                                          .tx = prGetBodyTransform(b2) },
+            collision);
+
+    return prComputeTransformedCollision(
+        &(const prTransformedShape) { .shape = s1,
+                                      .tx = prGetBodyTransform(b1),
+                                      .vertices = prGetBodyVertices(b1),
+                                      .normals = prGetBodyNormals(b1) },
+        &(const prTransformedShape) { .shape = s2,
+                                      .tx = prGetBodyTransform(b2),
+                                      .vertices = prGetBodyVertices(b2),
+                                      .normals = prGetBodyNormals(b2) },
+        collision,
+        axis);
+}
 
-    float lambda = FLT_MAX;
+/* 
+    Checks whether the collision shapes of `b1` and `b2` are colliding like
+    `prComputeBodyCollision()`, but only between the child of the first shape 
+    at `child / n` and the child of the second shape at `child % n`, 
+    where `n` is `prGetShapeChildCount()` of the second shape.
+*/
+bool prComputeBodyCollisionWithChild(const prBody *b1,
+                                     const prBody *b2,
+                                     int child,
+                                     prCollision *collision) {
+    const prShape *s1 = prGetBodyShape(b1), *s2 = prGetBodyShape(b2);
 
-    if (type == PR_SHAPE_CIRCLE) {
-        bool intersects = prComputeIntersectionCircleLine(tx.position,
-                                                          prGetCircleRadius(s),
-                                                          ray.origin,
-                                                          ray.direction,
-                                                          &lambda);
+    if (s1 == NULL || s2 == NULL) return false;
 
-        bool result = (lambda >= 0.0f) && (lambda <= ray.maxDistance);
+    const int childCount = prGetShapeChildCount(s2);
 
-        if (raycastHit != NULL) {
-            raycastHit->body = (prBody *) b;
+    if (child < 0 || child >= prGetShapeChildCount(s1) * childCount)
+        return false;
 
-            raycastHit->point = prVector2Add(
-                ray.origin, prVector2ScalarMultiply(ray.direction, lambda));
+    const int index1 = child / childCount, index2 = child % childCount;
 
-            raycastHit->normal = prVector2LeftNormal(
-                prVector2Subtract(ray.origin, raycastHit->point));
-            raycastHit->distance = lambda;
-            raycastHit->inside = (lambda < 0.0f);
-        }
+    const prTransformedShape ts1 = { .shape = s1,
+                                     .tx = prGetBodyTransform(b1),
+                                     .vertices = prGetBodyVertices(b1),
+                                     .normals = prGetBodyNormals(b1) };
 
-        return result;
-    } else if (type == PR_SHAPE_POLYGON) {
-        const prVertices *vertices = prGetPolygonVertices(s);
+    const prTransformedShape ts2 = { .shape = s2,
+                                     .tx = prGetBodyTransform(b2),
+                                     .vertices = prGetBodyVertices(b2),
+                                     .normals = prGetBodyNormals(b2) };
 
-        int intersectionCount = 0;
+    prVertices vertices1, normals1, vertices2, normals2;
 
-        float minLambda = FLT_MAX;
+    prTransformedShape child1, child2;
 
-        for (int j = vertices->count - 1, i = 0; i < vertices->count;
-             j = i, i++) {
-            prVector2 v1 = prVector2Transform(vertices->data[i], tx);
-            prVector2 v2 = prVector2Transform(vertices->data[j], tx);
+    prGetTransformedChild(&ts1, index1, &child1, &vertices1, &normals1);
+    prGetTransformedChild(&ts2, index2, &child2, &vertices2, &normals2);
 
-            prVector2 edgeVector = prVector2Subtract(v1, v2);
+    // NOTE: The child of a 'chain' collision shape is one of its line segments.
+    if (prGetShapeType(s1) == PR_SHAPE_CHAIN)
+        return prComputeCollisionChain(&child1, &child2, index1, collision);
+    else if (prGetShapeType(s2) == PR_SHAPE_CHAIN)
+        return prComputeCollisionChain(&child1, &child2, index2, collision);
 
-            bool intersects = prComputeIntersectionLines(ray.origin,
-                                                         ray.direction,
-                                                         v2,
-                                                         edgeVector,
-                                                         &lambda);
+    return prComputeTransformedCollision(&child1, &child2, collision, NULL);
+}
 
-            if (intersects && lambda <= ray.maxDistance) {
-                if (minLambda > lambda) {
-                    minLambda = lambda;
+bool prComputeRaycast(const prBody *b, prRay ray, prRaycastHit *raycastHit) {
+    if (b == NULL) return false;
+    ray.direction = prVector2Normalize(ray.direction);
 
-                    if (raycastHit != NULL) {
-                        raycastHit->point = prVector2Add(
-                            ray.origin,
-                            prVector2ScalarMultiply(ray.direction, minLambda));
+    const bool result = prComputeTransformedRaycast(
+        &(const prTransformedShape) { .shape = prGetBodyShape(b),
+                                      .tx = prGetBodyTransform(b),
+                                      .vertices = prGetBodyVertices(b),
+                                      .normals = prGetBodyNormals(b) },
+        ray,
+        raycastHit);
 
-                        raycastHit->normal = prVector2LeftNormal(edgeVector);
-                    }
-                }
+    if (raycastHit != NULL) raycastHit->body = (prBody *) b;
 
-                intersectionCount++;
-            }
-        }
-
-        if (raycastHit != NULL) {
-            raycastHit->body = (prBody *) b;
-            raycastHit->inside = (intersectionCount & 1);
-        }
-        return (!(raycastHit->inside) && (intersectionCount > 0));
-    } else {
-        return false;
-    }
+    return result;
 }
+
 /* Private Functions ==================================================================== */
 
 /* 
@@ -247,19 +417,63 @@ static bool prClipEdge(prEdge *e, prVector2 v, float dot) {
     }
 }
 
+/* 
+    Checks whether `s1` and `s2` are colliding, 
+    then stores the collision information to `collision`.
+*/
+static bool prComputeTransformedCollision(const prTransformedShape *s1,
+                                          const prTransformedShape *s2,
+                                          prCollision *collision,
+                                          int *axis) {
+    prShapeType t1 = prGetShapeType(s1->shape);
+    prShapeType t2 = prGetShapeType(s2->shape);
+
+    if (t1 == PR_SHAPE_COMPOUND || t2 == PR_SHAPE_COMPOUND) {
+        return prComputeCollisionCompound(s1, s2, collision);
+    } else if (t1 == PR_SHAPE_CHAIN || t2 == PR_SHAPE_CHAIN) {
+        if (t1 == t2) return false;
+
+        const prTransformedShape *chain = (t1 == PR_SHAPE_CHAIN) ? s1 : s2;
+        const prTransformedShape *other = (t1 == PR_SHAPE_CHAIN) ? s2 : s1;
+
+        prChainQueryCtx queryCtx = { .s1 = s1,
+                                     .s2 = s2,
+                                     .collision = collision,
+                                     .maxDepth = -FLT_MAX };
+
+        // NOTE: Only the deepest collision along a single line segment is kept.
+        prQueryChain(chain->shape,
+                     chain->tx,
+                     prGetShapeAABB(other->shape, other->tx),
+                     prChainQueryCallback,
+                     &queryCtx);
+
+        return queryCtx.colliding;
+    } else if (t1 == PR_SHAPE_CIRCLE && t2 == PR_SHAPE_CIRCLE)
+        return prComputeCollisionCircles(s1, s2, collision);
+    else if ((t1 == PR_SHAPE_CIRCLE && t2 == PR_SHAPE_POLYGON)
+             || (t1 == PR_SHAPE_POLYGON && t2 == PR_SHAPE_CIRCLE))
+        return prComputeCollisionCirclePoly(s1, s2, collision);
+    else if (t1 == PR_SHAPE_POLYGON && t2 == PR_SHAPE_POLYGON)
+        return prComputeCollisionPolys(s1, s2, collision, axis);
+    else
+        return false;
+}
+
 /* 
     Checks whether `s1` and `s2` are colliding,
     assuming `s1` and `s2` are 'circle' collision shapes,
     then stores the collision information to `collision`.
 */
-static bool prComputeCollisionCircles(const prShape *s1,
-                                      prTransform tx1,
-                                      const prShape *s2,
-                                      prTransform tx2,
+static bool prComputeCollisionCircles(const prTransformedShape *s1,
+                                      const prTransformedShape *s2,
                                       prCollision *collision) {
+    const prTransform tx1 = s1->tx, tx2 = s2->tx;
+
     prVector2 direction = prVector2Subtract(tx2.position, tx1.position);
 
-    float radiusSum = prGetCircleRadius(s1) + prGetCircleRadius(s2);
+    float radiusSum = prGetCircleRadius(s1->shape)
+                      + prGetCircleRadius(s2->shape);
     float magnitudeSqr = prVector2MagnitudeSqr(direction);
 
     if (radiusSum * radiusSum < magnitudeSqr) return false;
@@ -276,12 +490,13 @@ static bool prComputeCollisionCircles(const prShape *s1,
 
         collision->contacts[0].point =
             prVector2Transform(prVector2ScalarMultiply(collision->direction,
-                                                       prGetCircleRadius(s1)),
+                                                       prGetCircleRadius(
+                                                           s1->shape)),
                                tx1);
 
         collision->contacts[0].depth = (magnitude > 0.0f)
                                            ? radiusSum - magnitude
-                                           : prGetCircleRadius(s1);
+                                           : prGetCircleRadius(s1->shape);
 
         collision->contacts[1] = collision->contacts[0];
 
@@ -296,34 +511,25 @@ static bool prComputeCollisionCircles(const prShape *s1,
     assuming `s1` is a 'circle' collision shape and `s2` is a 'polygon' collision shape,
     then stores the collision information to `collision`.
 */
-static bool prComputeCollisionCirclePoly(const prShape *s1,
-                                         prTransform tx1,
-                                         const prShape *s2,
-                                         prTransform tx2,
+static bool prComputeCollisionCirclePoly(const prTransformedShape *s1,
+                                         const prTransformedShape *s2,
                                          prCollision *collision) {
-    prShape *circle, *poly;
-    prTransform circleTx, polyTx;
+    const prTransformedShape *circle = s1, *poly = s2;
 
-    if (prGetShapeType(s1) == PR_SHAPE_CIRCLE) {
-        circle = (prShape *) s1, poly = (prShape *) s2;
-        circleTx = tx1, polyTx = tx2;
-    } else {
-        circle = (prShape *) s2, poly = (prShape *) s1;
-        circleTx = tx2, polyTx = tx1;
-    }
+    if (prGetShapeType(s1->shape) != PR_SHAPE_CIRCLE) circle = s2, poly = s1;
 
-    const prVertices *vertices = prGetPolygonVertices(poly);
-    const prVertices *normals = prGetPolygonNormals(poly);
+    const prTransform circleTx = circle->tx;
 
-    /*
-        NOTE: `txCenter` refers to the center of the 'circle' collision shape
-        transformed to the local space of the 'polygon' collision shape.
-    */
-    prVector2 txCenter = prVector2Rotate(prVector2Subtract(circleTx.position,
-                                                           polyTx.position),
-                                         -polyTx.angle);
+    // NOTE: The vertices and normals of `poly` are already in world space.
+    const prVertices *vertices = poly->vertices;
+    const prVertices *normals = poly->normals;
+
+    const prVector2 center = circleTx.position;
 
-    float radius = prGetCircleRadius(circle), maxDot = -FLT_MAX;
+    const prVector2 deltaPosition = prVector2Subtract(s2->tx.position,
+                                                      s1->tx.position);
+
+    float radius = prGetCircleRadius(circle->shape), maxDot = -FLT_MAX;
 
     int maxIndex = -1;
 
@@ -333,8 +539,7 @@ static bool prComputeCollisionCirclePoly(const prShape *s1,
     */
     for (int i = 0; i < vertices->count; i++) {
         float dot = prVector2Dot(normals->data[i],
-                                 prVector2Subtract(txCenter,
-                                                   vertices->data[i]));
+                                 prVector2Subtract(center, vertices->data[i]));
 
         if (dot > radius) return false;
 
@@ -349,11 +554,7 @@ static bool prComputeCollisionCirclePoly(const prShape *s1,
     */
     if (maxDot < 0.0f) {
         if (collision != NULL) {
-            collision->direction = prVector2Negate(
-                prVector2RotateTx(normals->data[maxIndex], polyTx));
-
-            prVector2 deltaPosition = prVector2Subtract(tx2.position,
-                                                        tx1.position);
+            collision->direction = prVector2Negate(normals->data[maxIndex]);
 
             if (prVector2Dot(deltaPosition, collision->direction) < 0.0f)
                 collision->direction = prVector2Negate(collision->direction);
@@ -361,8 +562,7 @@ static bool prComputeCollisionCirclePoly(const prShape *s1,
             collision->contacts[0].id = 0;
 
             collision->contacts[0].point = prVector2Add(
-                circleTx.position,
-                prVector2ScalarMultiply(collision->direction, radius));
+                center, prVector2ScalarMultiply(collision->direction, radius));
 
             collision->contacts[0].depth = radius - maxDot;
 
@@ -378,8 +578,8 @@ static bool prComputeCollisionCirclePoly(const prShape *s1,
 
         prVector2 edgeVector = prVector2Subtract(v2, v1);
 
-        prVector2 v1ToCenter = prVector2Subtract(txCenter, v1);
-        prVector2 v2ToCenter = prVector2Subtract(txCenter, v2);
+        prVector2 v1ToCenter = prVector2Subtract(center, v1);
+        prVector2 v2ToCenter = prVector2Subtract(center, v2);
 
         float v1Dot = prVector2Dot(v1ToCenter, edgeVector);
         float v2Dot = prVector2Dot(v2ToCenter, prVector2Negate(edgeVector));
@@ -399,13 +599,10 @@ static bool prComputeCollisionCirclePoly(const prShape *s1,
                 float magnitude = sqrtf(magnitudeSqr);
 
                 collision->direction =
-                    (magnitude > 0.0f) ? prVector2ScalarMultiply(
-                        prVector2RotateTx(prVector2Negate(direction), polyTx),
-                        1.0f / magnitude)
-                                       : PR_API_STRUCT_ZERO(prVector2);
-
-                prVector2 deltaPosition = prVector2Subtract(tx2.position,
-                                                            tx1.position);
+                    (magnitude > 0.0f)
+                        ? prVector2ScalarMultiply(prVector2Negate(direction),
+                                                  1.0f / magnitude)
+                        : PR_API_STRUCT_ZERO(prVector2);
 
                 if (prVector2Dot(deltaPosition, collision->direction) < 0.0f)
                     collision->direction = prVector2Negate(
@@ -427,11 +624,7 @@ static bool prComputeCollisionCirclePoly(const prShape *s1,
             }
         } else {
             if (collision != NULL) {
-                collision->direction = prVector2Negate(
-                    prVector2RotateTx(normals->data[maxIndex], polyTx));
-
-                prVector2 deltaPosition = prVector2Subtract(tx2.position,
-                                                            tx1.position);
+                collision->direction = prVector2Negate(normals->data[maxIndex]);
 
                 if (prVector2Dot(deltaPosition, collision->direction) < 0.0f)
                     collision->direction = prVector2Negate(
@@ -440,7 +633,7 @@ static bool prComputeCollisionCirclePoly(const prShape *s1,
                 collision->contacts[0].id = 0;
 
                 collision->contacts[0].point = prVector2Add(
-                    circleTx.position,
+                    center,
                     prVector2ScalarMultiply(collision->direction, radius));
 
                 collision->contacts[0].depth = radius - maxDot;
@@ -460,112 +653,590 @@ static bool prComputeCollisionCirclePoly(const prShape *s1,
     assuming `s1` and `s2` are 'polygon' collision shapes,
     then stores the collision information to `collision`.
 */
-static bool prComputeCollisionPolys(const prShape *s1,
-                                    prTransform tx1,
-                                    const prShape *s2,
-                                    prTransform tx2,
-                                    prCollision *collision) {
+static bool prComputeCollisionPolys(const prTransformedShape *s1,
+                                    const prTransformedShape *s2,
+                                    prCollision *collision,
+                                    int *axis) {
+    /*
+        NOTE: Two polygons that were separated along an axis are likely to be
+        still separated along that axis, which is the only one tested then.
+        (The axes of `s2` are offset by `PR_GEOMETRY_MAX_VERTEX_COUNT`.)
+    */
+    if (axis != NULL && *axis >= 0) {
+        const bool flipped = (*axis >= PR_GEOMETRY_MAX_VERTEX_COUNT);
+
+        const prTransformedShape *r1 = flipped ? s2 : s1, *r2 = flipped ? s1 : s2;
+
+        const int index = *axis % PR_GEOMETRY_MAX_VERTEX_COUNT;
+
+        // NOTE: The shape of a body might have been replaced since then.
+        if (index < r1->normals->count
+            && prGetSeparatingAxisDepth(r1, r2, index) >= 0.0f)
+            return false;
+    }
+
     float maxDepth1 = FLT_MAX, maxDepth2 = FLT_MAX;
 
-    int index1 = prGetSeparatingAxisIndex(s1, tx1, s2, tx2, &maxDepth1);
+    int index1 = prGetSeparatingAxisIndex(s1, s2, &maxDepth1);
+
+    if (axis != NULL) *axis = index1;
 
     if (maxDepth1 >= 0.0f) return false;
 
-    int index2 = prGetSeparatingAxisIndex(s2, tx2, s1, tx1, &maxDepth2);
+    int index2 = prGetSeparatingAxisIndex(s2, s1, &maxDepth2);
+
+    if (axis != NULL && maxDepth1 <= maxDepth2)
+        *axis = PR_GEOMETRY_MAX_VERTEX_COUNT + index2;
 
     if (maxDepth2 >= 0.0f) return false;
 
     if (collision != NULL) {
-        prVector2 direction =
-            (maxDepth1 > maxDepth2)
-                ? prVector2RotateTx(prGetPolygonNormal(s1, index1), tx1)
-                : prVector2RotateTx(prGetPolygonNormal(s2, index2), tx2);
+        prVector2 direction = (maxDepth1 > maxDepth2)
+                                  ? s1->normals->data[index1]
+                                  : s2->normals->data[index2];
 
-        prVector2 deltaPosition = prVector2Subtract(tx2.position, tx1.position);
+        prVector2 deltaPosition = prVector2Subtract(s2->tx.position,
+                                                    s1->tx.position);
 
         if (prVector2Dot(deltaPosition, direction) < 0.0f)
             direction = prVector2Negate(direction);
 
-        prEdge edge1 = prGetContactEdge(s1, tx1, direction);
-        prEdge edge2 = prGetContactEdge(s2, tx2, prVector2Negate(direction));
+        const prEdge edge1 = prGetContactEdge(s1, direction);
+        const prEdge edge2 = prGetContactEdge(s2, prVector2Negate(direction));
 
-        prEdge refEdge = edge1, incEdge = edge2;
+        return prComputePolyContacts(edge1, edge2, direction, collision);
+    }
 
-        prTransform refTx = tx1, incTx = tx2;
+    return true;
+}
+
+/* 
+    Computes the contact points of the edges `edge1` and `edge2` of two polygons
+    colliding along `direction`, then stores them to `collision`.
+*/
+static bool prComputePolyContacts(prEdge edge1,
+                                  prEdge edge2,
+                                  prVector2 direction,
+                                  prCollision *collision) {
+    prEdge refEdge = edge1, incEdge = edge2;
 
-        prVector2 edgeVector1 = prVector2Subtract(edge1.data[1], edge1.data[0]);
-        prVector2 edgeVector2 = prVector2Subtract(edge2.data[1], edge2.data[0]);
+    prVector2 edgeVector1 = prVector2Subtract(edge1.data[1], edge1.data[0]);
+    prVector2 edgeVector2 = prVector2Subtract(edge2.data[1], edge2.data[0]);
 
-        const float edgeDot1 = prVector2Dot(edgeVector1, direction);
-        const float edgeDot2 = prVector2Dot(edgeVector2, direction);
+    const float edgeDot1 = prVector2Dot(edgeVector1, direction);
+    const float edgeDot2 = prVector2Dot(edgeVector2, direction);
 
-        bool incEdgeFlipped = false;
+    bool incEdgeFlipped = false;
 
-        if (fabsf(edgeDot1) > fabsf(edgeDot2)) {
-            refEdge = edge2, incEdge = edge1;
-            refTx = tx2, incTx = tx1;
+    if (fabsf(edgeDot1) > fabsf(edgeDot2)) {
+        refEdge = edge2, incEdge = edge1;
 
-            incEdgeFlipped = true;
-        }
+        incEdgeFlipped = true;
+    }
+
+    prVector2 refEdgeVector = prVector2Normalize(
+        prVector2Subtract(refEdge.data[1], refEdge.data[0]));
+
+    const float refDot1 = prVector2Dot(refEdge.data[0], refEdgeVector);
+    const float refDot2 = prVector2Dot(refEdge.data[1], refEdgeVector);
+
+    if (!prClipEdge(&incEdge, refEdgeVector, refDot1)) return false;
+    if (!prClipEdge(&incEdge, prVector2Negate(refEdgeVector), -refDot2))
+        return false;
+
+    prVector2 refEdgeNormal = prVector2RightNormal(refEdgeVector);
 
-        prVector2 refEdgeVector = prVector2Normalize(
-            prVector2Subtract(refEdge.data[1], refEdge.data[0]));
+    const float maxDepth = prVector2Dot(refEdge.data[0], refEdgeNormal);
 
-        const float refDot1 = prVector2Dot(refEdge.data[0], refEdgeVector);
-        const float refDot2 = prVector2Dot(refEdge.data[1], refEdgeVector);
+    const float depth1 = prVector2Dot(incEdge.data[0], refEdgeNormal)
+                         - maxDepth;
+    const float depth2 = prVector2Dot(incEdge.data[1], refEdgeNormal)
+                         - maxDepth;
 
-        if (!prClipEdge(&incEdge, refEdgeVector, refDot1)) return false;
-        if (!prClipEdge(&incEdge, prVector2Negate(refEdgeVector), -refDot2))
+    collision->direction = direction;
+
+    collision->contacts[0].id = (!incEdgeFlipped)
+                                    ? PR_GEOMETRY_MAX_VERTEX_COUNT
+                                          + incEdge.indexes[0]
+                                    : incEdge.indexes[0];
+
+    collision->contacts[1].id = (!incEdgeFlipped)
+                                    ? PR_GEOMETRY_MAX_VERTEX_COUNT
+                                          + incEdge.indexes[1]
+                                    : incEdge.indexes[1];
+
+    if (depth1 < 0.0f) {
+        collision->contacts[0].point = incEdge.data[1];
+        collision->contacts[0].depth = depth2;
+
+        collision->contacts[1].point = collision->contacts[0].point;
+        collision->contacts[1].depth = collision->contacts[0].depth;
+
+        collision->count = 1;
+    } else if (depth2 < 0.0f) {
+        collision->contacts[0].point = incEdge.data[0];
+        collision->contacts[0].depth = depth1;
+
+        collision->contacts[1].point = collision->contacts[0].point;
+        collision->contacts[1].depth = collision->contacts[0].depth;
+
+        collision->count = 1;
+    } else {
+        collision->contacts[0].point = incEdge.data[0];
+        collision->contacts[1].point = incEdge.data[1];
+
+        collision->contacts[0].depth = depth1;
+        collision->contacts[1].depth = depth2;
+
+        collision->count = 2;
+    }
+
+    return true;
+}
+
+/* 
+    Checks whether `s1` and `s2` are colliding, assuming either of them is
+    a 'chain' collision shape, along the line segment of the chain at `index`,
+    then stores the collision information to `collision`.
+*/
+static bool prComputeCollisionChain(const prTransformedShape *s1,
+                                    const prTransformedShape *s2,
+                                    int index,
+                                    prCollision *collision) {
+    const bool flipped = (prGetShapeType(s1->shape) != PR_SHAPE_CHAIN);
+
+    const prTransformedShape *chain = flipped ? s2 : s1;
+    const prTransformedShape *other = flipped ? s1 : s2;
+
+    if (index < 0 || index >= prGetChainSegmentCount(chain->shape))
+        return false;
+
+    const prChainSegment segment = prGetChainSegment(chain, index);
+
+    switch (prGetShapeType(other->shape)) {
+        case PR_SHAPE_CIRCLE:
+            return prComputeCollisionCircleSegment(other,
+                                                   &segment,
+                                                   !flipped,
+                                                   collision);
+
+        case PR_SHAPE_POLYGON:
+            return prComputeCollisionPolySegment(other,
+                                                 &segment,
+                                                 !flipped,
+                                                 collision);
+
+        default:
             return false;
+    }
+}
 
-        prVector2 refEdgeNormal = prVector2RightNormal(refEdgeVector);
+/* 
+    Checks whether `circle` and `segment` are colliding, then stores
+    the collision information from `circle` to `segment` (or the other way around
+    if `flipped` is `true`) to `collision`.
+*/
+static bool prComputeCollisionCircleSegment(const prTransformedShape *circle,
+                                            const prChainSegment *segment,
+                                            bool flipped,
+                                            prCollision *collision) {
+    const prVector2 center = circle->tx.position;
 
-        const float maxDepth = prVector2Dot(refEdge.data[0], refEdgeNormal);
+    const prVector2 v1 = segment->data[0], v2 = segment->data[1];
 
-        const float depth1 = prVector2Dot(incEdge.data[0], refEdgeNormal)
-                             - maxDepth;
-        const float depth2 = prVector2Dot(incEdge.data[1], refEdgeNormal)
-                             - maxDepth;
+    const prVector2 edgeVector = prVector2Subtract(v2, v1);
 
-        collision->direction = direction;
+    const float v1Dot = prVector2Dot(prVector2Subtract(center, v1), edgeVector);
+    const float v2Dot = prVector2Dot(prVector2Subtract(v2, center), edgeVector);
 
-        collision->contacts[0].id = (!incEdgeFlipped)
-                                        ? PR_GEOMETRY_MAX_VERTEX_COUNT
-                                              + incEdge.indexes[0]
-                                        : incEdge.indexes[0];
+    prVector2 closestPoint = v1;
 
-        collision->contacts[1].id = (!incEdgeFlipped)
-                                        ? PR_GEOMETRY_MAX_VERTEX_COUNT
-                                              + incEdge.indexes[1]
-                                        : incEdge.indexes[1];
+    /*
+        NOTE: Each vertex shared by two line segments belongs to the segment 
+        before it, unless the center of `circle` faces the segment after it,
+        so that a circle rolling over a vertex does not bump into it.
+    */
+    if (v1Dot <= 0.0f) {
+        if (segment->hasPrevious) return false;
+    } else if (v2Dot <= 0.0f) {
+        if (segment->hasNext
+            && prVector2Dot(prVector2Subtract(center, v2),
+                            prVector2Subtract(segment->next, v2))
+                   > 0.0f)
+            return false;
 
-        if (depth1 < 0.0f) {
-            collision->contacts[0].point = incEdge.data[1];
-            collision->contacts[0].depth = depth2;
+        closestPoint = v2;
+    } else {
+        closestPoint = prVector2Add(
+            v1,
+            prVector2ScalarMultiply(edgeVector,
+                                    v1Dot / prVector2MagnitudeSqr(edgeVector)));
+    }
 
-            collision->contacts[1].point = collision->contacts[0].point;
-            collision->contacts[1].depth = collision->contacts[0].depth;
+    const prVector2 deltaPosition = prVector2Subtract(center, closestPoint);
 
-            collision->count = 1;
-        } else if (depth2 < 0.0f) {
-            collision->contacts[0].point = incEdge.data[0];
-            collision->contacts[0].depth = depth1;
+    const float radius = prGetCircleRadius(circle->shape);
 
-            collision->contacts[1].point = collision->contacts[0].point;
-            collision->contacts[1].depth = collision->contacts[0].depth;
+    const float magnitudeSqr = prVector2MagnitudeSqr(deltaPosition);
 
-            collision->count = 1;
-        } else {
-            collision->contacts[0].point = incEdge.data[0];
-            collision->contacts[1].point = incEdge.data[1];
+    if (magnitudeSqr > radius * radius) return false;
+
+    if (collision != NULL) {
+        const float magnitude = sqrtf(magnitudeSqr);
+
+        // NOTE: This is the normal from `segment` to `circle`.
+        const prVector2 normal = (magnitude > 0.0f)
+                                     ? prVector2ScalarMultiply(deltaPosition,
+                                                               1.0f / magnitude)
+                                     : prVector2LeftNormal(edgeVector);
+
+        collision->direction = flipped ? normal : prVector2Negate(normal);
+
+        collision->contacts[0].id = 0;
+
+        collision->contacts[0].point = prVector2Subtract(
+            center, prVector2ScalarMultiply(normal, radius));
+
+        collision->contacts[0].depth = radius - magnitude;
+
+        collision->contacts[1] = collision->contacts[0];
+
+        collision->count = 1;
+    }
+
+    return true;
+}
+
+/* 
+    Checks whether `poly` and `segment` are colliding, then stores
+    the collision information from `poly` to `segment` (or the other way around
+    if `flipped` is `true`) to `collision`.
+*/
+static bool prComputeCollisionPolySegment(const prTransformedShape *poly,
+                                          const prChainSegment *segment,
+                                          bool flipped,
+                                          prCollision *collision) {
+    prVector2 v1 = segment->data[0], v2 = segment->data[1];
+
+    // NOTE: The edge of `segment` is wound so that its normal faces `poly`.
+    if (prVector2Dot(prVector2LeftNormal(prVector2Subtract(v2, v1)),
+                     prVector2Subtract(poly->tx.position, v1))
+        < 0.0f) {
+        const prVector2 temp = v1;
+
+        v1 = v2, v2 = temp;
+    }
+
+    const prVector2 normal = prVector2LeftNormal(prVector2Subtract(v2, v1));
+
+    const prVertices vertices = { .data = { v1, v2 }, .count = 2 };
+    const prVertices normals = { .data = { prVector2Negate(normal), normal },
+                                 .count = 2 };
+
+    const prTransformedShape edge = { .shape = NULL,
+                                      .vertices = &vertices,
+                                      .normals = &normals };
+
+    if (prGetSeparatingAxisDepth(&edge, poly, 1) >= 0.0f) return false;
+
+    float maxDepth = FLT_MAX;
+
+    prGetSeparatingAxisIndex(poly, &edge, &maxDepth);
+
+    if (maxDepth >= 0.0f) return false;
+
+    if (collision == NULL) return true;
+
+    /*
+        NOTE: The normal of `segment` is always the direction of the collision, 
+        so that a polygon sliding over a vertex shared by two line segments 
+        does not catch on the other segment.
+    */
+    const prEdge segmentEdge = { .data = { v1, v2 },
+                                 .indexes = { 0, 1 },
+                                 .count = 2 };
+
+    const prEdge polyEdge = prGetContactEdge(poly, prVector2Negate(normal));
+
+    if (flipped)
+        return prComputePolyContacts(segmentEdge, polyEdge, normal, collision);
+    else
+        return prComputePolyContacts(polyEdge,
+                                     segmentEdge,
+                                     prVector2Negate(normal),
+                                     collision);
+}
+
+/* 
+    Checks whether `s1` and `s2` are colliding, assuming either of them is 
+    a 'compound' collision shape, then stores the deepest collision information 
+    between their children to `collision`.
+*/
+static bool prComputeCollisionCompound(const prTransformedShape *s1,
+                                       const prTransformedShape *s2,
+                                       prCollision *collision) {
+    const bool compound1 = (prGetShapeType(s1->shape) == PR_SHAPE_COMPOUND);
+    const bool compound2 = (prGetShapeType(s2->shape) == PR_SHAPE_COMPOUND);
+
+    const int count1 = compound1 ? prGetShapeChildCount(s1->shape) : 1;
+    const int count2 = compound2 ? prGetShapeChildCount(s2->shape) : 1;
+
+    float maxDepth = -FLT_MAX;
+
+    bool result = false;
+
+    for (int i = 0; i < count1; i++) {
+        prVertices vertices1, normals1;
+
+        prTransformedShape child1 = *s1;
+
+        if (compound1)
+            prGetTransformedChild(s1, i, &child1, &vertices1, &normals1);
+
+        for (int j = 0; j < count2; j++) {
+            prVertices vertices2, normals2;
+
+            prTransformedShape child2 = *s2;
+
+            if (compound2)
+                prGetTransformedChild(s2, j, &child2, &vertices2, &normals2);
+
+            prCollision childCollision = { .count = 0 };
+
+            if (!prComputeTransformedCollision(&child1,
+                                               &child2,
+                                               &childCollision,
+                                               NULL))
+                continue;
 
-            collision->contacts[0].depth = depth1;
-            collision->contacts[1].depth = depth2;
+            // NOTE: Any overlap is enough if the collision is not needed.
+            if (collision == NULL) return true;
 
-            collision->count = 2;
+            const float depth = prGetCollisionDepth(&childCollision);
+
+            if (maxDepth < depth)
+                maxDepth = depth, *collision = childCollision, result = true;
         }
     }
 
+    return result;
+}
+
+/* Casts a `ray` against `ts`. */
+static bool prComputeTransformedRaycast(const prTransformedShape *ts,
+                                        prRay ray,
+                                        prRaycastHit *raycastHit) {
+    const prShape *s = ts->shape;
+    prTransform tx = ts->tx;
+
+    prShapeType type = prGetShapeType(s);
+
+    float lambda = FLT_MAX;
+
+    if (type == PR_SHAPE_CIRCLE) {
+        bool intersects = prComputeIntersectionCircleLine(tx.position,
+                                                          prGetCircleRadius(s),
+                                                          ray.origin,
+                                                          ray.direction,
+                                                          &lambda);
+
+        bool result = (lambda >= 0.0f) && (lambda <= ray.maxDistance);
+
+        if (raycastHit != NULL) {
+            raycastHit->point = prVector2Add(
+                ray.origin, prVector2ScalarMultiply(ray.direction, lambda));
+
+            raycastHit->normal = prVector2LeftNormal(
+                prVector2Subtract(ray.origin, raycastHit->point));
+            raycastHit->distance = lambda;
+            raycastHit->inside = (lambda < 0.0f);
+        }
+
+        return result;
+    } else if (type == PR_SHAPE_POLYGON) {
+        // NOTE: The vertices of `ts` are already in world space.
+        const prVertices *vertices = ts->vertices;
+
+        int intersectionCount = 0;
+
+        float minLambda = FLT_MAX;
+
+        for (int j = vertices->count - 1, i = 0; i < vertices->count;
+             j = i, i++) {
+            prVector2 v1 = vertices->data[i], v2 = vertices->data[j];
+
+            prVector2 edgeVector = prVector2Subtract(v1, v2);
+
+            bool intersects = prComputeIntersectionRaySegment(ray.origin,
+                                                              ray.direction,
+                                                              v2,
+                                                              edgeVector,
+                                                              &lambda);
+
+            if (!intersects) continue;
+
+            /*
+                NOTE: All intersections along the ray must be counted 
+                in order to check whether the origin of the ray is inside `b`,
+                but only the ones within `ray.maxDistance` can be hit.
+            */
+            intersectionCount++;
+
+            if (lambda <= ray.maxDistance) {
+                if (minLambda > lambda) {
+                    minLambda = lambda;
+
+                    if (raycastHit != NULL) {
+                        raycastHit->point = prVector2Add(
+                            ray.origin,
+                            prVector2ScalarMultiply(ray.direction, minLambda));
+
+                        raycastHit->normal = prVector2LeftNormal(edgeVector);
+                        raycastHit->distance = minLambda;
+                    }
+                }
+            }
+        }
+
+        const bool inside = (intersectionCount & 1);
+
+        if (raycastHit != NULL) raycastHit->inside = inside;
+
+        return (!inside && intersectionCount > 0
+                && minLambda <= ray.maxDistance);
+    } else if (type == PR_SHAPE_CHAIN) {
+        const prVector2 rayVector = prVector2ScalarMultiply(ray.direction,
+                                                            ray.maxDistance);
+        const prVector2 endPoint = prVector2Add(ray.origin, rayVector);
+
+        prChainRaycastQueryCtx queryCtx = { .chain = *ts,
+                                            .ray = ray,
+                                            .hit = raycastHit,
+                                            .minLambda = FLT_MAX };
+
+        // NOTE: A 'chain' collision shape has no inside.
+        prQueryChain(s,
+                     tx,
+                     (prAABB) { .x = fminf(ray.origin.x, endPoint.x),
+                                .y = fminf(ray.origin.y, endPoint.y),
+                                .width = fabsf(endPoint.x - ray.origin.x),
+                                .height = fabsf(endPoint.y - ray.origin.y) },
+                     prChainRaycastQueryCallback,
+                     &queryCtx);
+
+        if (raycastHit != NULL) raycastHit->inside = false;
+
+        return (queryCtx.minLambda <= ray.maxDistance);
+    } else if (type == PR_SHAPE_COMPOUND) {
+        prRaycastHit closestHit = { .distance = FLT_MAX };
+
+        bool hit = false, inside = false;
+
+        for (int i = 0; i < prGetShapeChildCount(s); i++) {
+            prVertices vertices, normals;
+
+            prTransformedShape child;
+
+            prGetTransformedChild(ts, i, &child, &vertices, &normals);
+
+            prRaycastHit childHit = { .distance = 0.0f };
+
+            if (prComputeTransformedRaycast(&child, ray, &childHit)
+                && (!hit || closestHit.distance > childHit.distance))
+                closestHit = childHit, hit = true;
+
+            /*
+                NOTE: The origin of the ray may be inside any shape of `s`
+                (and a 'circle' collision shape does not check it exactly).
+            */
+            if (prGetShapeType(child.shape) == PR_SHAPE_CIRCLE) {
+                const float radius = prGetCircleRadius(child.shape);
+
+                if (prVector2DistanceSqr(ray.origin, child.tx.position)
+                    <= radius * radius)
+                    inside = true;
+            } else if (childHit.inside) {
+                inside = true;
+            }
+        }
+
+        if (raycastHit != NULL) {
+            if (hit) *raycastHit = closestHit;
+
+            raycastHit->inside = inside;
+        }
+
+        return (!inside && hit);
+    } else {
+        return false;
+    }
+}
+
+/* 
+    A callback function for `prQueryChain()` that keeps the deepest collision
+    between the shapes of `ctx` along each line segment of the chain.
+*/
+static bool prChainQueryCallback(int index, void *ctx) {
+    prChainQueryCtx *queryCtx = ctx;
+
+    prCollision collision = { .count = 0 };
+
+    if (!prComputeCollisionChain(queryCtx->s1,
+                                 queryCtx->s2,
+                                 index,
+                                 &collision))
+        return false;
+
+    const float depth = prGetCollisionDepth(&collision);
+
+    if (queryCtx->maxDepth < depth) {
+        queryCtx->maxDepth = depth, queryCtx->colliding = true;
+
+        if (queryCtx->collision != NULL) *queryCtx->collision = collision;
+    }
+
+    return true;
+}
+
+/* 
+    A callback function for `prQueryChain()` that will be called
+    during `prComputeRaycast()`.
+*/
+static bool prChainRaycastQueryCallback(int index, void *ctx) {
+    prChainRaycastQueryCtx *queryCtx = ctx;
+
+    const prChainSegment segment = prGetChainSegment(&queryCtx->chain, index);
+
+    const prVector2 edgeVector = prVector2Subtract(segment.data[1],
+                                                   segment.data[0]);
+
+    float lambda = FLT_MAX;
+
+    if (!prComputeIntersectionRaySegment(queryCtx->ray.origin,
+                                         queryCtx->ray.direction,
+                                         segment.data[0],
+                                         edgeVector,
+                                         &lambda)
+        || lambda > queryCtx->ray.maxDistance || lambda >= queryCtx->minLambda)
+        return false;
+
+    queryCtx->minLambda = lambda;
+
+    if (queryCtx->hit != NULL) {
+        prVector2 normal = prVector2LeftNormal(edgeVector);
+
+        // NOTE: The normal of a line segment faces the origin of the ray.
+        if (prVector2Dot(normal, queryCtx->ray.direction) > 0.0f)
+            normal = prVector2Negate(normal);
+
+        queryCtx->hit->point = prVector2Add(
+            queryCtx->ray.origin,
+            prVector2ScalarMultiply(queryCtx->ray.direction, lambda));
+
+        queryCtx->hit->normal = normal;
+        queryCtx->hit->distance = lambda;
+    }
+
     return true;
 }
 
@@ -587,112 +1258,142 @@ static bool prComputeIntersectionCircleLine(prVector2 center,
     return (dot >= 0.0f && baseSqr >= 0.0f);
 }
 
-/* Computes the intersection of two lines. */
-static bool prComputeIntersectionLines(prVector2 origin1,
-                                       prVector2 direction1,
-                                       prVector2 origin2,
-                                       prVector2 direction2,
-                                       float *lambda) {
+/* 
+    Computes the intersection of a ray from `origin1` along `direction1`
+    and a line segment from `origin2` to `origin2 + direction2`.
+*/
+static bool prComputeIntersectionRaySegment(prVector2 origin1,
+                                            prVector2 direction1,
+                                            prVector2 origin2,
+                                            prVector2 direction2,
+                                            float *lambda) {
     float rXs = prVector2Cross(direction1, direction2);
 
+    // NOTE: A ray parallel to the line segment can only graze it.
+    if (rXs == 0.0f) return false;
+
     prVector2 qp = prVector2Subtract(origin2, origin1);
 
     float qpXs = prVector2Cross(qp, direction2);
     float qpXr = prVector2Cross(qp, direction1);
 
-    if (rXs != 0.0f) {
-        float inverseRxS = 1.0f / rXs;
-
-        float t = qpXs * inverseRxS, u = qpXr * inverseRxS;
+    float inverseRxS = 1.0f / rXs;
 
-        if ((t >= 0.0f && t <= 1.0f) && (u >= 0.0f && u <= 1.0f)) {
-            if (lambda != NULL) *lambda = t;
+    float t = qpXs * inverseRxS, u = qpXr * inverseRxS;
 
-            return true;
-        }
-
-        return false;
-    } else {
-        if (qpXr != 0.0f) return 0;
-
-        float rDr = prVector2Dot(direction1, direction1);
-        float sDr = prVector2Dot(direction2, direction1);
-
-        float inverseRdR = 1.0f / rDr;
+    if (t < 0.0f || u < 0.0f || u > 1.0f) return false;
 
-        float qpDr = prVector2Dot(qp, direction1);
+    if (lambda != NULL) *lambda = t;
 
-        float k, t0 = qpDr * inverseRdR, t1 = t0 + sDr * inverseRdR;
-
-        if (sDr < 0.0f) k = t0, t0 = t1, t1 = k;
-
-        if ((t0 < 0.0f && t1 == 0.0f) || (t0 == 1.0f && t1 > 1.0f)) {
-            if (lambda != NULL) *lambda = (t0 == 1.0f);
-
-            return 1;
-        }
-
-        return (t1 >= 0.0f && t0 <= 1.0f);
-    }
+    return true;
 }
 
 /* Returns the edge of `s` that is most perpendicular to `v`. */
-static prEdge prGetContactEdge(const prShape *s, prTransform tx, prVector2 v) {
-    const prVertices *vertices = prGetPolygonVertices(s);
-    int supportIndex = prGetSupportPointIndex(vertices, tx, v);
+static prEdge prGetContactEdge(const prTransformedShape *s, prVector2 v) {
+    const prVertices *vertices = s->vertices;
+
+    int supportIndex = prGetSupportPointIndex(vertices, v);
+
     int prevIndex = (supportIndex == 0) ? vertices->count - 1
                                         : supportIndex - 1;
     int nextIndex = (supportIndex == vertices->count - 1) ? 0
                                                           : supportIndex + 1;
+
     prVector2 prevEdgeVector = prVector2Normalize(
         prVector2Subtract(vertices->data[supportIndex],
                           vertices->data[prevIndex]));
     prVector2 nextEdgeVector = prVector2Normalize(
         prVector2Subtract(vertices->data[supportIndex],
                           vertices->data[nextIndex]));
-    v = prVector2Rotate(v, -tx.angle);
+
     if (prVector2Dot(prevEdgeVector, v) < prVector2Dot(nextEdgeVector, v)) {
         return (prEdge) {
-            .data = { prVector2Transform(vertices->data[prevIndex], tx),
-                      prVector2Transform(vertices->data[supportIndex], tx) },
+            .data = { vertices->data[prevIndex], vertices->data[supportIndex] },
             .indexes = { prevIndex, supportIndex },
             .count = 2
         };
     } else {
         return (prEdge) {
-            .data = { prVector2Transform(vertices->data[supportIndex], tx),
-                      prVector2Transform(vertices->data[nextIndex], tx) },
+            .data = { vertices->data[supportIndex], vertices->data[nextIndex] },
             .indexes = { supportIndex, nextIndex },
             .count = 2
         };
     }
 }
 
-/* Finds the axis of minimum penetration, then returns its index. */
-static int prGetSeparatingAxisIndex(const prShape *s1,
-                                    prTransform tx1,
-                                    const prShape *s2,
-                                    prTransform tx2,
+/* 
+    Returns the line segment of `s` (a 'chain' collision shape) at `index`,
+    transformed through the transform of `s`.
+*/
+static prChainSegment prGetChainSegment(const prTransformedShape *s,
+                                        int index){
+    const int vertexCount = prGetChainVertexCount(s->shape);
+    const int segmentCount = prGetChainSegmentCount(s->shape);
+
+    const bool loop = prIsChainLoop(s->shape);
+
+    const prVector2 v1 = prGetChainVertex(s->shape, index);
+    const prVector2 v2 = prGetChainVertex(s->shape, (index + 1) % vertexCount);
+
+    prChainSegment result = {
+        .data = { prVector2Transform(v1, s->tx), prVector2Transform(v2, s->tx) },
+        .hasPrevious = loop || index > 0,
+        .hasNext = loop || index < segmentCount - 1
+    };
+
+    if (result.hasNext)
+        result.next = prVector2Transform(
+            prGetChainVertex(s->shape, (index + 2) % vertexCount), s->tx);
+
+    return result;
+}
+
+/* 
+    Stores the child of `s` at `index` to `child`, with its vertices and normals
+    transformed to `vertices` and `normals` if `s` is a 'compound' collision shape.
+    (Any other collision shape is its own child, including a 'chain' collision shape.)
+*/
+static void prGetTransformedChild(const prTransformedShape *s,
+                                  int index,
+                                  prTransformedShape *child,
+                                  prVertices *vertices,
+                                  prVertices *normals) {
+    if (prGetShapeType(s->shape) != PR_SHAPE_COMPOUND) {
+        *child = *s;
+
+        return;
+    }
+
+    child->shape = prGetCompoundChild(s->shape, index);
+    child->tx = prGetCompoundChildTransform(s->shape, index, s->tx);
+
+    prTransformPolygon(child->shape, child->tx, vertices, normals);
+
+    child->vertices = vertices, child->normals = normals;
+}
+
+/* Returns the depth of the deepest contact point in `collision`. */
+static PR_API_INLINE float prGetCollisionDepth(const prCollision *collision) {
+    float result = collision->contacts[0].depth;
+
+    if (collision->count > 1 && result < collision->contacts[1].depth)
+        result = collision->contacts[1].depth;
+
+    return result;
+}
+
+/* Finds the axis of minimum penetration from `s1` to `s2`, then returns its index. */
+static int prGetSeparatingAxisIndex(const prTransformedShape *s1,
+                                    const prTransformedShape *s2,
                                     float *depth) {
-    const prVertices *vertices1 = prGetPolygonVertices(s1);
-    const prVertices *vertices2 = prGetPolygonVertices(s2);
-    const prVertices *normals1 = prGetPolygonNormals(s1);
     float maxDepth = -FLT_MAX;
-    int maxIndex = -1;
-    for (int i = 0; i < normals1->count; i++) {
-        prVector2 vertex = prVector2Transform(vertices1->data[i], tx1);
-        prVector2 normal = prVector2RotateTx(normals1->data[i], tx1);
-        int supportIndex = prGetSupportPointIndex(vertices2,
-                                                  tx2,
-                                                  prVector2Negate(normal));
 
-        if (supportIndex < 0) return supportIndex;
+    int maxIndex = -1;
 
-        prVector2 supportPoint =
-            prVector2Transform(vertices2->data[supportIndex], tx2);
+    if (s2->vertices->count <= 0) return maxIndex;
 
-        float depth = prVector2Dot(normal,
-                                   prVector2Subtract(supportPoint, vertex));
+    for (int i = 0; i < s1->normals->count; i++) {
+        const float depth = prGetSeparatingAxisDepth(s1, s2, i);
 
         if (maxDepth < depth) maxDepth = depth, maxIndex = i;
     }
@@ -702,16 +1403,31 @@ static int prGetSeparatingAxisIndex(const prShape *s1,
     return maxIndex;
 }
 
-/* Returns the index of the vertex farthest along `v`. */
-static int prGetSupportPointIndex(const prVertices *vertices,
-                                  prTransform tx,
-                                  prVector2 v) {
+/* 
+    Returns the distance from `s1` to `s2` along the normal of `s1` at `index`,
+    which is negative if `s1` and `s2` overlap along that normal.
+*/
+static float prGetSeparatingAxisDepth(const prTransformedShape *s1,
+                                      const prTransformedShape *s2,
+                                      int index) {
+    // NOTE: All vertices and normals are already in world space.
+    const prVector2 vertex = s1->vertices->data[index];
+    const prVector2 normal = s1->normals->data[index];
+
+    const int supportIndex = prGetSupportPointIndex(s2->vertices,
+                                                    prVector2Negate(normal));
+
+    const prVector2 supportPoint = s2->vertices->data[supportIndex];
+
+    return prVector2Dot(normal, prVector2Subtract(supportPoint, vertex));
+}
+
+/* Finds the vertex farthest along `v`, then returns its index. */
+static int prGetSupportPointIndex(const prVertices *vertices, prVector2 v) {
     float maxDot = -FLT_MAX;
 
     int maxIndex = -1;
 
-    v = prVector2Rotate(v, -tx.angle);
-
     for (int i = 0; i < vertices->count; i++) {
         float dot = prVector2Dot(vertices->data[i], v);
 
@@ -848,7 +848,17 @@ typedef struct
     #define STBDS_HASH_EMPTY   0
     #define STBDS_HASH_DELETED 1
 
-static size_t stbds_hash_seed = 0x31415926;
+    // NOTE (proxima): The seed is updated whenever a hash table is created, so it
+    // is made thread-local for hash tables to be created on many threads at once.
+    #ifndef STBDS_THREAD_LOCAL
+        #if defined(_MSC_VER)
+            #define STBDS_THREAD_LOCAL __declspec(thread)
+        #else
+            #define STBDS_THREAD_LOCAL __thread
+        #endif
+    #endif
+
+static STBDS_THREAD_LOCAL size_t stbds_hash_seed = 0x31415926;
 
 void stbds_rand_seed(size_t seed) {
     stbds_hash_seed = seed;
@@ -26,8 +26,36 @@
 
 #include "proxima.h"
 
+/* Macros =============================================================================== */
+
+// clang-format off
+
+/* 
+    Defines the maximum depth of the bounding volume hierarchy of a 'chain' 
+    collision shape, which is split at the median segment of each node.
+*/
+#define PR_CHAIN_TREE_MAX_DEPTH  64
+
+// clang-format on
+
 /* Typedefs ============================================================================= */
 
+/* 
+    A structure that represents a node of the bounding volume hierarchy 
+    of a 'chain' collision shape, whose left child comes right after it.
+*/
+typedef struct _prChainNode {
+    prAABB aabb;
+    int segment, right;
+} prChainNode;
+
+/* A structure that represents a segment of a 'chain' collision shape being sorted. */
+typedef struct _prChainItem {
+    prAABB aabb;
+    prVector2 center;
+    int segment;
+} prChainItem;
+
 /* A union that represents the internal data of a collision shape. */
 typedef union _prShapeData {
     struct {
@@ -36,6 +64,17 @@ typedef union _prShapeData {
     struct {
         prVertices vertices, normals;
     } polygon;
+    struct {
+        prVector2 *vertices;
+        prChainNode *nodes;
+        int vertexCount, segmentCount;
+        bool loop;
+    } chain;
+    struct {
+        prShape **shapes;
+        prTransform *offsets;
+        int count;
+    } compound;
 } prShapeData;
 
 /* 
@@ -47,6 +86,7 @@ struct _prShape {
     prShapeData data;
     prMaterial material;
     float area;
+    PR_API_ATOMIC_INT referenceCount;
 };
 
 /* Private Function Prototypes ========================================================== */
@@ -57,16 +97,49 @@ struct _prShape {
 */
 static void prJarvisMarch(const prVertices *input, prVertices *output);
 
+/* 
+    Returns the moment of inertia of a convex polygon with the given `vertices`
+    and `density`, about the origin of its coordinate plane.
+*/
+static float prComputePolygonInertia(const prVertices *vertices, float density);
+
+/* 
+    Builds the subtree of the bounding volume hierarchy of `s` for `count` `items`
+    at `index`, then returns the index of the node right after the subtree.
+*/
+static int prBuildChainTree(prShape *s,
+                            prChainItem *items,
+                            int count,
+                            int index);
+
+/* 
+    Partially sorts `count` `items` along the `axis` (`0` for x, `1` for y),
+    so that the item at `k` has no item with a greater center before it
+    and no item with a smaller center after it.
+*/
+static void prSelectChainItem(prChainItem *items, int count, int k, int axis);
+
+/* Returns the AABB that covers `aabb` transformed through `tx`. */
+static prAABB prTransformAABB(prAABB aabb, prTransform tx);
+
+/* Private Variables ==================================================================== */
+
+// NOTE: Each thread has its own pool, so that shapes can be created without locking.
+static PR_API_THREAD_LOCAL prPool shapePool = { .blockSize = sizeof(prShape) };
+
 /* Public Functions ===================================================================== */
 
 /* Creates a 'circle' collision shape. */
 prShape *prCreateCircle(prMaterial material, float radius) {
     if (radius <= 0.0f) return NULL;
 
-    prShape *result = calloc(1, sizeof *result);
+    prShape *result = prAllocateFromPool(&shapePool);
+
+    if (result == NULL) return NULL;
 
     result->type = PR_SHAPE_CIRCLE;
     result->material = material;
+    result->referenceCount = 1;
 
     prSetCircleRadius(result, radius);
 
@@ -77,10 +150,13 @@ prShape *prCreateCircle(prMaterial material, float radius) {
 prShape *prCreateRectangle(prMaterial material, float width, float height) {
     if (width <= 0.0f || height <= 0.0f) return NULL;
 
-    prShape *result = calloc(1, sizeof *result);
+    prShape *result = prAllocateFromPool(&shapePool);
+
+    if (result == NULL) return NULL;
 
     result->type = PR_SHAPE_POLYGON;
     result->material = material;
+    result->referenceCount = 1;
 
     const float halfWidth = 0.5f * width, halfHeight = 0.5f * height;
 
@@ -100,19 +176,179 @@ prShape *prCreateRectangle(prMaterial material, float width, float height) {
 prShape *prCreatePolygon(prMaterial material, const prVertices *vertices) {
     if (vertices == NULL || vertices->count <= 0) return NULL;
 
-    prShape *result = calloc(1, sizeof *result);
+    prShape *result = prAllocateFromPool(&shapePool);
+
+    if (result == NULL) return NULL;
 
     result->type = PR_SHAPE_POLYGON;
     result->material = material;
+    result->referenceCount = 1;
 
     prSetPolygonVertices(result, vertices);
 
     return result;
 }
 
-/* Releases the memory allocated by `s`. */
+/* 
+    Creates a 'chain' collision shape, which is a series of line segments
+    connecting `count` `vertices` (and the last vertex to the first one
+    if `loop` is `true`) without any area. (It is meant for static bodies.)
+*/
+prShape *prCreateChain(prMaterial material,
+                       const prVector2 *vertices,
+                       int count,
+                       bool loop) {
+    if (vertices == NULL || count < (loop ? 3 : 2)) return NULL;
+
+    prShape *result = prAllocateFromPool(&shapePool);
+
+    if (result == NULL) return NULL;
+
+    result->type = PR_SHAPE_CHAIN;
+    result->material = material;
+    result->area = 0.0f;
+    result->referenceCount = 1;
+
+    const int segmentCount = loop ? count : count - 1;
+
+    result->data.chain.vertices = prAllocateMemory(count * sizeof *vertices);
+    result->data.chain.nodes = prAllocateMemory(
+        (2 * segmentCount - 1) * sizeof *result->data.chain.nodes);
+
+    prChainItem *items = prAllocateMemory(segmentCount * sizeof *items);
+
+    if (result->data.chain.vertices == NULL || result->data.chain.nodes == NULL
+        || items == NULL) {
+        prReleaseMemory(result->data.chain.vertices);
+        prReleaseMemory(result->data.chain.nodes), prReleaseMemory(items);
+
+        prReleaseToPool(&shapePool, result);
+
+        return NULL;
+    }
+
+    for (int i = 0; i < count; i++)
+        result->data.chain.vertices[i] = vertices[i];
+
+    result->data.chain.vertexCount = count;
+    result->data.chain.segmentCount = segmentCount;
+    result->data.chain.loop = loop;
+
+    for (int i = 0; i < segmentCount; i++) {
+        const prVector2 v1 = vertices[i], v2 = vertices[(i + 1) % count];
+
+        items[i].aabb = (prAABB) { .x = fminf(v1.x, v2.x),
+                                   .y = fminf(v1.y, v2.y),
+                                   .width = fabsf(v2.x - v1.x),
+                                   .height = fabsf(v2.y - v1.y) };
+
+        items[i].center = prVector2ScalarMultiply(prVector2Add(v1, v2), 0.5f);
+
+        items[i].segment = i;
+    }
+
+    // NOTE: The segments never move, so the hierarchy is built only once.
+    prBuildChainTree(result, items, segmentCount, 0);
+
+    prReleaseMemory(items);
+
+    return result;
+}
+
+/* 
+    Creates a 'compound' collision shape, which is made of `count` 'circle'
+    or 'polygon' collision `shapes`, each placed at its own local `offsets`, 
+    adding a reference to each shape. (Only the position and the angle 
+    of each offset are used, and `material` is used for the whole shape.)
+*/
+prShape *prCreateCompound(prMaterial material,
+                          prShape **shapes,
+                          const prTransform *offsets,
+                          int count) {
+    if (shapes == NULL || offsets == NULL || count <= 0) return NULL;
+
+    // NOTE: Each shape of a 'compound' collision shape must be convex.
+    for (int i = 0; i < count; i++)
+        if (prGetShapeType(shapes[i]) != PR_SHAPE_CIRCLE
+            && prGetShapeType(shapes[i]) != PR_SHAPE_POLYGON)
+            return NULL;
+
+    prShape *result = prAllocateFromPool(&shapePool);
+
+    if (result == NULL) return NULL;
+
+    result->type = PR_SHAPE_COMPOUND;
+    result->material = material;
+    result->area = 0.0f;
+    result->referenceCount = 1;
+
+    result->data.compound.shapes = prAllocateMemory(count * sizeof *shapes);
+    result->data.compound.offsets = prAllocateMemory(count * sizeof *offsets);
+
+    if (result->data.compound.shapes == NULL
+        || result->data.compound.offsets == NULL) {
+        prReleaseMemory(result->data.compound.shapes);
+        prReleaseMemory(result->data.compound.offsets);
+
+        prReleaseToPool(&shapePool, result);
+
+        return NULL;
+    }
+
+    for (int i = 0; i < count; i++) {
+        result->data.compound.shapes[i] = prRetainShape(shapes[i]);
+
+        const float angle = offsets[i].angle;
+
+        result->data.compound.offsets[i] = (prTransform) {
+            .position = offsets[i].position,
+            .rotation = { ._sin = prSin(angle), ._cos = prCos(angle) },
+            .angle = angle
+        };
+
+        // NOTE: The shapes are assumed not to overlap each other.
+        result->area += prGetShapeArea(shapes[i]);
+    }
+
+    result->data.compound.count = count;
+
+    return result;
+}
+
+/* 
+    Adds a reference to `s`, so that `s` stays alive until 
+    a matching call to `prReleaseShape()`, then returns `s`.
+*/
+prShape *prRetainShape(prShape *s) {
+    if (s == NULL) return NULL;
+
+    // NOTE: A shape may be shared by bodies that are created on different threads.
+    PR_API_ATOMIC_INCREMENT(&s->referenceCount);
+
+    return s;
+}
+
+/* 
+    Removes a reference from `s`, then releases the memory allocated for `s`
+    if there are no references left.
+*/
 void prReleaseShape(prShape *s) {
-    free(s);
+    if (s == NULL) return;
+
+    if (PR_API_ATOMIC_DECREMENT(&s->referenceCount) > 0) return;
+
+    if (s->type == PR_SHAPE_CHAIN) {
+        prReleaseMemory(s->data.chain.vertices);
+        prReleaseMemory(s->data.chain.nodes);
+    } else if (s->type == PR_SHAPE_COMPOUND) {
+        for (int i = 0; i < s->data.compound.count; i++)
+            prReleaseShape(s->data.compound.shapes[i]);
+
+        prReleaseMemory(s->data.compound.shapes);
+        prReleaseMemory(s->data.compound.offsets);
+    }
+
+    prReleaseToPool(&shapePool, s);
 }
 
 /* Returns the type of `s`. */
@@ -147,34 +383,55 @@ float prGetShapeArea(const prShape *s) {
 
 /* Returns the mass of `s`. */
 float prGetShapeMass(const prShape *s) {
-    return (s != NULL) ? s->material.density * s->area : 0.0f;
+    return (s != NULL) ? prComputeShapeMass(s, s->material.density) : 0.0f;
 }
 
 /* Returns the moment of inertia of `s`. */
 float prGetShapeInertia(const prShape *s) {
-    if (s == NULL || s->material.density <= 0.0f) return 0.0f;
+    return (s != NULL) ? prComputeShapeInertia(s, s->material.density) : 0.0f;
+}
+
+/* Returns the mass of `s` with the given `density`, ignoring the material of `s`. */
+float prComputeShapeMass(const prShape *s, float density) {
+    return (s != NULL) ? density * s->area : 0.0f;
+}
+
+/* 
+    Returns the moment of inertia of `s` with the given `density`,
+    ignoring the material of `s`.
+*/
+float prComputeShapeInertia(const prShape *s, float density) {
+    if (s == NULL || density <= 0.0f) return 0.0f;
 
     if (s->type == PR_SHAPE_CIRCLE) {
-        return 0.5f * prGetShapeMass(s)
+        return 0.5f * prComputeShapeMass(s, density)
                * (s->data.circle.radius * s->data.circle.radius);
     } else if (s->type == PR_SHAPE_POLYGON) {
-        float numerator = 0.0f, denominator = 0.0f;
+        return prComputePolygonInertia(&s->data.polygon.vertices, density);
+    } else if (s->type == PR_SHAPE_COMPOUND) {
+        float result = 0.0f;
+
+        // NOTE: The moment of inertia of each shape is taken about the origin of `s`.
+        for (int i = 0; i < s->data.compound.count; i++) {
+            const prShape *child = s->data.compound.shapes[i];
 
-        const int vertexCount = s->data.polygon.vertices.count;
+            const prTransform offset = s->data.compound.offsets[i];
 
-        // NOTE: https://en.wikipedia.org/wiki/List_of_moments_of_inertia
-        for (int j = vertexCount - 1, i = 0; i < vertexCount; j = i, i++) {
-            prVector2 v1 = s->data.polygon.vertices.data[j];
-            prVector2 v2 = s->data.polygon.vertices.data[i];
+            if (child->type == PR_SHAPE_CIRCLE) {
+                // NOTE: https://en.wikipedia.org/wiki/Parallel_axis_theorem
+                result += prComputeShapeInertia(child, density)
+                          + prComputeShapeMass(child, density)
+                                * prVector2MagnitudeSqr(offset.position);
+            } else {
+                prVertices vertices, normals;
 
-            const float cross = prVector2Cross(v1, v2),
-                        dotSum = (prVector2Dot(v1, v1) + prVector2Dot(v1, v2)
-                                  + prVector2Dot(v2, v2));
+                prTransformPolygon(child, offset, &vertices, &normals);
 
-            numerator += (cross * dotSum), denominator += cross;
+                result += prComputePolygonInertia(&vertices, density);
+            }
         }
 
-        return s->material.density * (numerator / (6.0f * denominator));
+        return result;
     } else {
         return 0.0f;
     }
@@ -213,12 +470,52 @@ prAABB prGetShapeAABB(const prShape *s, prTransform tx) {
 
             result.width = deltaX;
             result.height = deltaY;
+        } else if (s->type == PR_SHAPE_CHAIN) {
+            // NOTE: The root of the hierarchy covers all segments of `s`.
+            result = prTransformAABB(s->data.chain.nodes[0].aabb, tx);
+        } else if (s->type == PR_SHAPE_COMPOUND) {
+            prVector2 minVertex = { .x = FLT_MAX, .y = FLT_MAX };
+            prVector2 maxVertex = { .x = -FLT_MAX, .y = -FLT_MAX };
+
+            for (int i = 0; i < s->data.compound.count; i++) {
+                const prAABB aabb = prGetShapeAABB(
+                    s->data.compound.shapes[i],
+                    prGetCompoundChildTransform(s, i, tx));
+
+                minVertex.x = fminf(minVertex.x, aabb.x);
+                minVertex.y = fminf(minVertex.y, aabb.y);
+
+                maxVertex.x = fmaxf(maxVertex.x, aabb.x + aabb.width);
+                maxVertex.y = fmaxf(maxVertex.y, aabb.y + aabb.height);
+            }
+
+            result.x = minVertex.x;
+            result.y = minVertex.y;
+
+            result.width = maxVertex.x - minVertex.x;
+            result.height = maxVertex.y - minVertex.y;
         }
     }
 
     return result;
 }
 
+/* 
+    Returns the number of children of `s`, which is the number of line segments 
+    of a 'chain' collision shape, the number of shapes of a 'compound' 
+    collision shape, or `1` for any other collision shape.
+*/
+int prGetShapeChildCount(const prShape *s) {
+    if (s == NULL) return 0;
+
+    if (s->type == PR_SHAPE_CHAIN)
+        return s->data.chain.segmentCount;
+    else if (s->type == PR_SHAPE_COMPOUND)
+        return s->data.compound.count;
+    else
+        return 1;
+}
+
 /* Returns the radius of `s`, assuming `s` is a 'circle' collision shape. */
 float prGetCircleRadius(const prShape *s) {
     return (prGetShapeType(s) == PR_SHAPE_CIRCLE) ? s->data.circle.radius
@@ -261,6 +558,155 @@ const prVertices *prGetPolygonNormals(const prShape *s) {
                                                    : NULL;
 }
 
+/* 
+    Transforms the vertices and normals of `s` through `tx`, then stores them
+    to `vertices` and `normals`, assuming `s` is a 'polygon' collision shape.
+*/
+void prTransformPolygon(const prShape *s,
+                        prTransform tx,
+                        prVertices *vertices,
+                        prVertices *normals) {
+    if (prGetShapeType(s) != PR_SHAPE_POLYGON || vertices == NULL
+        || normals == NULL)
+        return;
+
+    vertices->count = s->data.polygon.vertices.count;
+    normals->count = s->data.polygon.normals.count;
+
+    for (int i = 0; i < vertices->count; i++)
+        vertices->data[i] = prVector2Transform(s->data.polygon.vertices.data[i],
+                                               tx);
+
+    for (int i = 0; i < normals->count; i++)
+        normals->data[i] = prVector2RotateTx(s->data.polygon.normals.data[i],
+                                             tx);
+}
+
+/* Returns the number of vertices of `s`, assuming `s` is a 'chain' collision shape. */
+int prGetChainVertexCount(const prShape *s) {
+    return (prGetShapeType(s) == PR_SHAPE_CHAIN) ? s->data.chain.vertexCount
+                                                 : 0;
+}
+
+/* 
+    Returns a vertex with the given `index` of `s`, 
+    assuming `s` is a 'chain' collision shape. 
+*/
+prVector2 prGetChainVertex(const prShape *s, int index) {
+    if (prGetShapeType(s) != PR_SHAPE_CHAIN || index < 0
+        || index >= s->data.chain.vertexCount)
+        return PR_API_STRUCT_ZERO(prVector2);
+
+    return s->data.chain.vertices[index];
+}
+
+/* 
+    Returns the number of line segments of `s`, 
+    assuming `s` is a 'chain' collision shape.
+*/
+int prGetChainSegmentCount(const prShape *s) {
+    return (prGetShapeType(s) == PR_SHAPE_CHAIN) ? s->data.chain.segmentCount
+                                                 : 0;
+}
+
+/* 
+    Returns `true` if the last vertex of `s` is connected to the first one,
+    assuming `s` is a 'chain' collision shape.
+*/
+bool prIsChainLoop(const prShape *s) {
+    return (prGetShapeType(s) == PR_SHAPE_CHAIN) && s->data.chain.loop;
+}
+
+/* 
+    Calls `func` with the index of each line segment of `s` with the transform `tx`
+    whose AABB overlaps `aabb`, assuming `s` is a 'chain' collision shape.
+    (This function does not modify `s`, so it can be called on multiple threads.)
+*/
+void prQueryChain(const prShape *s,
+                  prTransform tx,
+                  prAABB aabb,
+                  prHashQueryFunc func,
+                  void *ctx) {
+    if (prGetShapeType(s) != PR_SHAPE_CHAIN || func == NULL) return;
+
+    const prVector2 inversePosition = prVector2Negate(
+        prVector2RotateTx(tx.position,
+                          (prTransform) { .rotation._sin = -tx.rotation._sin,
+                                          .rotation._cos = tx.rotation._cos }));
+
+    // NOTE: The hierarchy of `s` is in local space, unlike `aabb`.
+    const prAABB key = prTransformAABB(
+        aabb,
+        (prTransform) { .position = inversePosition,
+                        .rotation._sin = -tx.rotation._sin,
+                        .rotation._cos = tx.rotation._cos,
+                        .angle = -tx.angle });
+
+    int stack[PR_CHAIN_TREE_MAX_DEPTH], stackSize = 0;
+
+    for (int index = 0;;) {
+        const prChainNode *node = &s->data.chain.nodes[index];
+
+        if (prAABBsOverlap(node->aabb, key)) {
+            if (node->segment < 0) {
+                stack[stackSize++] = node->right, index++;
+
+                continue;
+            }
+
+            func(node->segment, ctx);
+        }
+
+        if (stackSize <= 0) break;
+
+        index = stack[--stackSize];
+    }
+}
+
+/* 
+    Returns the shape with the given `index` of `s`, 
+    assuming `s` is a 'compound' collision shape.
+*/
+const prShape *prGetCompoundChild(const prShape *s, int index) {
+    if (prGetShapeType(s) != PR_SHAPE_COMPOUND || index < 0
+        || index >= s->data.compound.count)
+        return NULL;
+
+    return s->data.compound.shapes[index];
+}
+
+/* 
+    Returns the local offset of the shape with the given `index` of `s`, 
+    assuming `s` is a 'compound' collision shape.
+*/
+prTransform prGetCompoundChildOffset(const prShape *s, int index) {
+    if (prGetShapeType(s) != PR_SHAPE_COMPOUND || index < 0
+        || index >= s->data.compound.count)
+        return (prTransform) { .rotation._cos = 1.0f };
+
+    return s->data.compound.offsets[index];
+}
+
+/* 
+    Returns the transform of the shape with the given `index` of `s`
+    when `s` has the transform `tx`, assuming `s` is a 'compound' collision shape.
+*/
+prTransform prGetCompoundChildTransform(const prShape *s,
+                                        int index,
+                                        prTransform tx) {
+    const prTransform offset = prGetCompoundChildOffset(s, index);
+
+    // NOTE: The rotations are combined without any trigonometric functions.
+    return (prTransform) {
+        .position = prVector2Transform(offset.position, tx),
+        .rotation = { ._sin = tx.rotation._sin * offset.rotation._cos
+                              + tx.rotation._cos * offset.rotation._sin,
+                      ._cos = tx.rotation._cos * offset.rotation._cos
+                              - tx.rotation._sin * offset.rotation._sin },
+        .angle = tx.angle + offset.angle
+    };
+}
+
 /* Sets the type of `s` to `type`. */
 void prSetShapeType(prShape *s, prShapeType type) {
     if (s != NULL) s->type = type;
@@ -412,3 +858,148 @@ static void prJarvisMarch(const prVertices *input, prVertices *output) {
         output->data[output->count++] = input->data[nextIndex];
     }
 }
+
+/* 
+    Returns the moment of inertia of a convex polygon with the given `vertices`
+    and `density`, about the origin of its coordinate plane.
+*/
+static float prComputePolygonInertia(const prVertices *vertices, float density) {
+    float numerator = 0.0f, denominator = 0.0f;
+
+    const int vertexCount = vertices->count;
+
+    // NOTE: https://en.wikipedia.org/wiki/List_of_moments_of_inertia
+    for (int j = vertexCount - 1, i = 0; i < vertexCount; j = i, i++) {
+        prVector2 v1 = vertices->data[j];
+        prVector2 v2 = vertices->data[i];
+
+        const float cross = prVector2Cross(v1, v2),
+                    dotSum = (prVector2Dot(v1, v1) + prVector2Dot(v1, v2)
+                              + prVector2Dot(v2, v2));
+
+        numerator += (cross * dotSum), denominator += cross;
+    }
+
+    return density * (numerator / (6.0f * denominator));
+}
+
+/* 
+    Builds the subtree of the bounding volume hierarchy of `s` for `count` `items`
+    at `index`, then returns the index of the node right after the subtree.
+*/
+static int prBuildChainTree(prShape *s,
+                            prChainItem *items,
+                            int count,
+                            int index) {
+    prChainNode *node = &s->data.chain.nodes[index];
+
+    prVector2 minVertex = { .x = FLT_MAX, .y = FLT_MAX };
+    prVector2 maxVertex = { .x = -FLT_MAX, .y = -FLT_MAX };
+
+    prVector2 minCenter = minVertex, maxCenter = maxVertex;
+
+    for (int i = 0; i < count; i++) {
+        const prAABB aabb = items[i].aabb;
+
+        minVertex.x = fminf(minVertex.x, aabb.x);
+        minVertex.y = fminf(minVertex.y, aabb.y);
+
+        maxVertex.x = fmaxf(maxVertex.x, aabb.x + aabb.width);
+        maxVertex.y = fmaxf(maxVertex.y, aabb.y + aabb.height);
+
+        minCenter.x = fminf(minCenter.x, items[i].center.x);
+        minCenter.y = fminf(minCenter.y, items[i].center.y);
+
+        maxCenter.x = fmaxf(maxCenter.x, items[i].center.x);
+        maxCenter.y = fmaxf(maxCenter.y, items[i].center.y);
+    }
+
+    node->aabb = (prAABB) { .x = minVertex.x,
+                            .y = minVertex.y,
+                            .width = maxVertex.x - minVertex.x,
+                            .height = maxVertex.y - minVertex.y };
+
+    if (count == 1) {
+        node->segment = items[0].segment, node->right = -1;
+
+        return index + 1;
+    }
+
+    // NOTE: Each node is split at the median segment along its longest axis.
+    const int axis = (maxCenter.x - minCenter.x < maxCenter.y - minCenter.y);
+
+    const int leftCount = count / 2;
+
+    prSelectChainItem(items, count, leftCount, axis);
+
+    node->segment = -1;
+
+    node->right = prBuildChainTree(s, items, leftCount, index + 1);
+
+    return prBuildChainTree(s,
+                            items + leftCount,
+                            count - leftCount,
+                            node->right);
+}
+
+/* 
+    Partially sorts `count` `items` along the `axis` (`0` for x, `1` for y),
+    so that the item at `k` has no item with a greater center before it
+    and no item with a smaller center after it.
+*/
+static void prSelectChainItem(prChainItem *items, int count, int k, int axis) {
+    int left = 0, right = count - 1;
+
+    // NOTE: https://en.wikipedia.org/wiki/Quickselect
+    while (left < right) {
+        const prVector2 pivotCenter = items[(left + right) / 2].center;
+
+        const float pivot = axis ? pivotCenter.y : pivotCenter.x;
+
+        int i = left, j = right;
+
+        while (i <= j) {
+            while ((axis ? items[i].center.y : items[i].center.x) < pivot)
+                i++;
+
+            while ((axis ? items[j].center.y : items[j].center.x) > pivot)
+                j--;
+
+            if (i <= j) {
+                const prChainItem temp = items[i];
+
+                items[i] = items[j], items[j] = temp;
+
+                i++, j--;
+            }
+        }
+
+        if (k <= j)
+            right = j;
+        else if (k >= i)
+            left = i;
+        else
+            break;
+    }
+}
+
+/* Returns the AABB that covers `aabb` transformed through `tx`. */
+static prAABB prTransformAABB(prAABB aabb, prTransform tx) {
+    const prVector2 center = prVector2Transform(
+        (prVector2) { .x = aabb.x + 0.5f * aabb.width,
+                      .y = aabb.y + 0.5f * aabb.height },
+        tx);
+
+    // NOTE: The half extents of the rotated box along each axis.
+    const float halfWidth = 0.5f
+                            * (fabsf(tx.rotation._cos) * aabb.width
+                               + fabsf(tx.rotation._sin) * aabb.height);
+    const float halfHeight = 0.5f
+                             * (fabsf(tx.rotation._sin) * aabb.width
+                                + fabsf(tx.rotation._cos) * aabb.height);
+
+    return (prAABB) { .x = center.x - halfWidth,
+                      .y = center.y - halfHeight,
+                      .width = 2.0f * halfWidth,
+                      .height = 2.0f * halfHeight };
+}
@@ -26,6 +26,47 @@
 
 #include "proxima.h"
 
+// NOTE: All arrays and hash maps are allocated with the current allocator.
+#define STBDS_REALLOC(context, ptr, size) prReallocateMemory(ptr, size)
+#define STBDS_FREE(context, ptr)          prReleaseMemory(ptr)
+
+/* NOTE: `STB_DS_IMPLEMENTATION` is already defined in 'broad-phase.c' */
+#include "external/stb_ds.h"
+
+#ifndef PR_DISABLE_SIMD
+    #if defined(__AVX__)
+        #include <immintrin.h>
+
+        #define PR_SIMD_AVX
+    #elif defined(__SSE2__) || defined(_M_X64) \
+        || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+        #include <emmintrin.h>
+
+        #define PR_SIMD_SSE2
+    #elif (defined(__aarch64__) && defined(__ARM_NEON)) || defined(_M_ARM64)
+        #include <arm_neon.h>
+
+        #define PR_SIMD_NEON
+    #elif defined(__wasm_simd128__)
+        #include <wasm_simd128.h>
+
+        #define PR_SIMD_WASM
+    #endif
+#endif
+
+/* Macros =============================================================================== */
+
+// clang-format off
+
+/* Defines the number of floats in a SIMD vector. */
+#if defined(PR_SIMD_AVX)
+    #define PR_SIMD_LANE_COUNT  8
+#elif defined(PR_SIMD_SSE2) || defined(PR_SIMD_NEON) || defined(PR_SIMD_WASM)
+    #define PR_SIMD_LANE_COUNT  4
+#endif
+
+// clang-format on
+
 /* Typedefs ============================================================================= */
 
 /* A structure that represents the motion data of a rigid body. */
@@ -44,32 +85,174 @@ struct _prBody {
     prBodyType type;
     prBodyFlags flags;
     prShape *shape;
-    prTransform tx;
+    prMaterial material;
+    bool customMaterial;
+    prCollisionFilter filter;
+    prTransform tx, prevTx;
     prMotionData mtn;
     prAABB aabb;
+    prVertices txVertices, txNormals;
+    float sleepTime;
+    bool sleeping, moved;
+    prWorld *world;
+    int storageIndex;
     void *ctx;
 };
 
+/* A structure that represents the body storage arrays for a pair of rigid bodies. */
+typedef struct _prBodyPairStorage {
+    prBodyType types[2];
+    bool sleeping[2];
+    float positionX[2], positionY[2], angles[2];
+    float velocityX[2], velocityY[2], angularVelocities[2];
+    float forceX[2], forceY[2], torques[2];
+    float masses[2], inverseMasses[2], inverseInertias[2], gravityScales[2];
+} prBodyPairStorage;
+
+#if defined(PR_SIMD_AVX)
+typedef __m256 prLane;
+typedef __m256 prLaneMask;
+#elif defined(PR_SIMD_SSE2)
+typedef __m128 prLane;
+typedef __m128 prLaneMask;
+#elif defined(PR_SIMD_NEON)
+typedef float32x4_t prLane;
+typedef uint32x4_t prLaneMask;
+#elif defined(PR_SIMD_WASM)
+typedef v128_t prLane;
+typedef v128_t prLaneMask;
+#endif
+
 /* Constants ============================================================================ */
 
 /* Constants for `prNormalizeAngle()`. */
 static const float TWO_PI = 2.0f * M_PI, INVERSE_TWO_PI = 1.0f / (2.0f * M_PI);
 
+/* The default collision filter of a rigid body, which collides with everything. */
+static const prCollisionFilter DEFAULT_COLLISION_FILTER = { .category = 1u,
+                                                            .mask = ~0u };
+
 /* Private Function Prototypes ========================================================== */
 
 /* Computes the mass and the moment of inertia for `b`. */
 static void prComputeBodyMass(prBody *b);
 
+/* 
+    Transforms the vertices and normals of the collision shape of `b` 
+    to world space, then updates the AABB of `b`.
+*/
+static void prTransformBodyShape(prBody *b);
+
+/* 
+    Marks `b` as moved, then marks the broad-phase data structure 
+    of the world of `b` (if any) as out of date.
+*/
+static PR_API_INLINE void prMarkBodyMoved(prBody *b);
+
 /* Normalizes the `angle` to a range `[0, 2π]`. */
 static PR_API_INLINE float prNormalizeAngle(float angle);
 
+/* Applies an `impulse` at a `point` to the given velocities of a body. */
+static PR_API_INLINE void prApplyImpulseToVelocity(prVector2 *velocity,
+                                                   float *angularVelocity,
+                                                   float inverseMass,
+                                                   float inverseInertia,
+                                                   prVector2 point,
+                                                   prVector2 impulse);
+
+/* 
+    Returns `true` if `tolerance` is positive and no impulse of the last iteration
+    on the `count` contact `constraints` is larger than `tolerance`.
+*/
+static bool prHasSolverConverged(const prContactConstraint *constraints,
+                                 int count,
+                                 float tolerance);
+
+/* Makes `bs` point to the arrays of `bps`, then copies `b1` and `b2` to `bs`. */
+static void prLoadBodyPairToStorage(prBodyStorage *bs,
+                                    prBodyPairStorage *bps,
+                                    const prBody *b1,
+                                    const prBody *b2);
+
+/* Copies the velocities of two bodies in `bs` back to `b1` and `b2`. */
+static void prStoreBodyPairVelocities(const prBodyStorage *bs,
+                                      prBody *b1,
+                                      prBody *b2);
+
+#ifdef PR_SIMD_LANE_COUNT
+
+/* 
+    Assigns the contact `constraints` of the bodies in `bs` to batches of constraints 
+    that do not share any body with finite mass, then returns the number of batches.
+*/
+static int prBuildContactBatches(const prBodyStorage *bs,
+                                 const prContactConstraint *constraints,
+                                 int count,
+                                 prSolverBuffer *sb);
+
+/* Resolves a batch of `laneCount` contact `constraints` at `lanes` at once. */
+static void prResolveContactBatch(prBodyStorage *bs,
+                                  const prContactConstraint *constraints,
+                                  const int *lanes,
+                                  int laneCount,
+                                  float inverseDt);
+
+/* 
+    Applies an `impulse` at a `point` to the given velocities of a body 
+    in each lane, only if the lane is set in `m`.
+*/
+static PR_API_INLINE void prApplyImpulseToLanes(prLane *velocityX,
+                                                prLane *velocityY,
+                                                prLane *angularVelocity,
+                                                prLane inverseMass,
+                                                prLane inverseInertia,
+                                                prLane pointX,
+                                                prLane pointY,
+                                                prLane impulseX,
+                                                prLane impulseY,
+                                                prLaneMask m);
+
+/* Returns the lane-wise minimum of `v1` and `v2`, in the same way as `fminf()`. */
+static PR_API_INLINE prLane prLaneMin(prLane v1, prLane v2);
+
+/* Returns the lane-wise maximum of `v1` and `v2`, in the same way as `fmaxf()`. */
+static PR_API_INLINE prLane prLaneMax(prLane v1, prLane v2);
+
+/* Platform-specific wrappers for SIMD vectors of `PR_SIMD_LANE_COUNT` floats. */
+static PR_API_INLINE prLane prLaneSet(float value);
+static PR_API_INLINE prLane prLaneLoad(const float *values);
+static PR_API_INLINE void prLaneStore(float *values, prLane v);
+
+static PR_API_INLINE prLane prLaneAdd(prLane v1, prLane v2);
+static PR_API_INLINE prLane prLaneSubtract(prLane v1, prLane v2);
+static PR_API_INLINE prLane prLaneMultiply(prLane v1, prLane v2);
+static PR_API_INLINE prLane prLaneDivide(prLane v1, prLane v2);
+
+static PR_API_INLINE prLane prLaneNegate(prLane v);
+static PR_API_INLINE prLane prLaneAbs(prLane v);
+static PR_API_INLINE prLane prLaneSqrt(prLane v);
+
+static PR_API_INLINE prLaneMask prLaneLess(prLane v1, prLane v2);
+static PR_API_INLINE prLaneMask prLaneGreater(prLane v1, prLane v2);
+static PR_API_INLINE prLaneMask prLaneAnd(prLaneMask m1, prLaneMask m2);
+static PR_API_INLINE prLane prLaneSelect(prLaneMask m, prLane v1, prLane v2);
+
+#endif
+
+/* Private Variables ==================================================================== */
+
+// NOTE: Each thread has its own pool, so that bodies can be created without locking.
+static PR_API_THREAD_LOCAL prPool bodyPool = { .blockSize = sizeof(prBody) };
+
 /* Public Functions ===================================================================== */
 
 /* Creates a rigid body at `position`. */
 prBody *prCreateBody(prBodyType type, prVector2 position) {
     if (type < PR_BODY_STATIC || type > PR_BODY_DYNAMIC) return NULL;
 
-    prBody *result = calloc(1, sizeof *result);
+    prBody *result = prAllocateFromPool(&bodyPool);
+
+    if (result == NULL) return NULL;
 
     result->type = type;
 
@@ -78,8 +261,14 @@ prBody *prCreateBody(prBodyType type, prVector2 position) {
     result->tx.rotation._sin = 0.0f;
     result->tx.rotation._cos = 1.0f;
 
+    result->prevTx = result->tx;
+
     result->mtn.gravityScale = 1.0f;
 
+    result->filter = DEFAULT_COLLISION_FILTER;
+
+    result->world = NULL, result->storageIndex = -1;
+
     return result;
 }
 
@@ -92,9 +281,13 @@ prBody *prCreateBodyFromShape(prBodyType type, prVector2 position, prShape *s) {
     return result;
 }
 
-/* Releases the memory allocated for `b`. */
+/* Releases the memory allocated for `b`, including its reference to its collision shape. */
 void prReleaseBody(prBody *b) {
-    free(b);
+    if (b == NULL) return;
+
+    prReleaseShape(b->shape);
+
+    prReleaseToPool(&bodyPool, b);
 }
 
 /* Returns the type of `b`. */
@@ -112,11 +305,73 @@ prShape *prGetBodyShape(const prBody *b) {
     return (b != NULL) ? b->shape : NULL;
 }
 
+/* 
+    Returns the material of `b`, which is the material of its collision shape
+    unless it was overridden by `prSetBodyMaterial()`.
+*/
+prMaterial prGetBodyMaterial(const prBody *b) {
+    if (b == NULL) return PR_API_STRUCT_ZERO(prMaterial);
+
+    return b->customMaterial ? b->material : prGetShapeMaterial(b->shape);
+}
+
+/* Returns the collision filter of `b`. */
+prCollisionFilter prGetBodyFilter(const prBody *b) {
+    return (b != NULL) ? b->filter : DEFAULT_COLLISION_FILTER;
+}
+
+/* Returns the simulation state of `b`. */
+prBodyState prGetBodyState(const prBody *b) {
+    if (b == NULL) return PR_API_STRUCT_ZERO(prBodyState);
+
+    return (prBodyState) { .position = b->tx.position,
+                           .angle = b->tx.angle,
+                           .previousPosition = b->prevTx.position,
+                           .previousAngle = b->prevTx.angle,
+                           .velocity = b->mtn.velocity,
+                           .angularVelocity = b->mtn.angularVelocity,
+                           .force = b->mtn.force,
+                           .torque = b->mtn.torque,
+                           .gravityScale = b->mtn.gravityScale,
+                           .sleepTime = b->sleepTime,
+                           .sleeping = b->sleeping };
+}
+
 /* Returns the transform of `b`. */
 prTransform prGetBodyTransform(const prBody *b) {
     return (b != NULL) ? b->tx : PR_API_STRUCT_ZERO(prTransform);
 }
 
+/* 
+    Returns the transform of `b` interpolated by `alpha` between its previous
+    transform (which is `alpha = 0`) and its current transform (`alpha = 1`).
+*/
+prTransform prGetBodyInterpolatedTransform(const prBody *b, float alpha) {
+    if (b == NULL) return PR_API_STRUCT_ZERO(prTransform);
+
+    const prTransform tx1 = b->prevTx, tx2 = b->tx;
+
+    // NOTE: The angles are normalized, so this takes the shorter way around.
+    float deltaAngle = tx2.angle - tx1.angle;
+
+    if (deltaAngle > M_PI) deltaAngle -= TWO_PI;
+    else if (deltaAngle < -M_PI) deltaAngle += TWO_PI;
+
+    prTransform result = {
+        .position = prVector2Add(
+            tx1.position,
+            prVector2ScalarMultiply(prVector2Subtract(tx2.position,
+                                                      tx1.position),
+                                    alpha)),
+        .angle = prNormalizeAngle(tx1.angle + deltaAngle * alpha)
+    };
+
+    result.rotation._sin = prSin(result.angle);
+    result.rotation._cos = prCos(result.angle);
+
+    return result;
+}
+
 /* Returns the position of `b`. */
 prVector2 prGetBodyPosition(const prBody *b) {
     return (b != NULL) ? b->tx.position : PR_API_STRUCT_ZERO(prVector2);
@@ -168,15 +423,67 @@ prAABB prGetBodyAABB(const prBody *b) {
                                            : PR_API_STRUCT_ZERO(prAABB);
 }
 
+/* 
+    Returns the vertices of the collision shape of `b` in world space,
+    assuming the collision shape of `b` is a 'polygon' collision shape.
+*/
+const prVertices *prGetBodyVertices(const prBody *b) {
+    return (prGetShapeType(prGetBodyShape(b)) == PR_SHAPE_POLYGON)
+               ? &b->txVertices
+               : NULL;
+}
+
+/* 
+    Returns the normals of the collision shape of `b` in world space,
+    assuming the collision shape of `b` is a 'polygon' collision shape.
+*/
+const prVertices *prGetBodyNormals(const prBody *b) {
+    return (prGetShapeType(prGetBodyShape(b)) == PR_SHAPE_POLYGON)
+               ? &b->txNormals
+               : NULL;
+}
+
 /* Returns the user data of `b`. */
 void *prGetBodyUserData(const prBody *b) {
     return (b != NULL) ? b->ctx : NULL;
 }
 
+/* Returns `true` if `b` is sleeping. */
+bool prIsBodySleeping(const prBody *b) {
+    return (b != NULL) ? b->sleeping : false;
+}
+
+/* Returns the time that `b` has been resting for, in seconds. */
+float prGetBodySleepTime(const prBody *b) {
+    return (b != NULL) ? b->sleepTime : 0.0f;
+}
+
+/* 
+    Returns `true` if `b` was moved, or its type or collision shape was changed, 
+    since it was last marked as not moved.
+*/
+bool prHasBodyMoved(const prBody *b) {
+    return (b != NULL) ? b->moved : false;
+}
+
+/* Returns the world that `b` was added to, or `NULL` if there is none. */
+prWorld *prGetBodyWorld(const prBody *b) {
+    return (b != NULL) ? b->world : NULL;
+}
+
+/* Returns the index of `b` in the body storage of its world, or `-1` if there is none. */
+int prGetBodyStorageIndex(const prBody *b) {
+    return (b != NULL) ? b->storageIndex : -1;
+}
+
 /* Sets the `type` of `b`. */
 void prSetBodyType(prBody *b, prBodyType type) {
     if (b == NULL) return;
 
+    prSetBodySleeping(b, false);
+
+    prMarkBodyMoved(b);
+
     b->type = type;
 
     prComputeBodyMass(b);
@@ -186,49 +493,154 @@ void prSetBodyType(prBody *b, prBodyType type) {
 void prSetBodyFlags(prBody *b, prBodyFlags flags) {
     if (b == NULL) return;
 
+    prSetBodySleeping(b, false);
+
     b->flags = flags;
 
     prComputeBodyMass(b);
 }
 
 /* 
-    Attaches the collision `s`hape to `b`. If `s` is `NULL`, 
-    it will detach the current collision shape from `b`.
+    Attaches the collision `s`hape to `b`, adding a reference to `s`. 
+    If `s` is `NULL`, it will detach the current collision shape from `b`.
 */
 void prSetBodyShape(prBody *b, prShape *s) {
     if (b == NULL) return;
 
+    prSetBodySleeping(b, false);
+
+    prMarkBodyMoved(b);
+
+    // NOTE: `s` might be the current collision shape of `b`.
+    prRetainShape(s), prReleaseShape(b->shape);
+
     b->shape = s;
 
-    b->aabb = (s != NULL) ? prGetShapeAABB(s, b->tx)
-                          : PR_API_STRUCT_ZERO(prAABB);
+    prTransformBodyShape(b);
+
+    prComputeBodyMass(b);
+}
+
+/* 
+    Overrides the material of the collision shape of `b` with `material`,
+    without modifying the collision shape (which might be shared by other bodies).
+*/
+void prSetBodyMaterial(prBody *b, prMaterial material) {
+    if (b == NULL) return;
+
+    prSetBodySleeping(b, false);
+
+    b->material = material, b->customMaterial = true;
+
+    prComputeBodyMass(b);
+}
+
+/* Makes `b` use the material of its collision shape again. */
+void prResetBodyMaterial(prBody *b) {
+    if (b == NULL || !b->customMaterial) return;
+
+    prSetBodySleeping(b, false);
+
+    b->customMaterial = false;
 
     prComputeBodyMass(b);
 }
 
+/* Sets the collision `filter` of `b`. */
+void prSetBodyFilter(prBody *b, prCollisionFilter filter) {
+    if (b == NULL) return;
+
+    // NOTE: Contacts between sleeping bodies are not filtered again until they wake up.
+    prSetBodySleeping(b, false);
+
+    b->filter = filter;
+}
+
+/* 
+    Restores the simulation `state` of `b` exactly as it was returned 
+    by `prGetBodyState()`, without waking up `b`.
+*/
+void prSetBodyState(prBody *b, prBodyState state) {
+    if (b == NULL) return;
+
+    prMarkBodyMoved(b);
+
+    b->tx.position = state.position;
+
+    // NOTE: The angle is already normalized, and gives the same rotation data as before.
+    b->tx.angle = state.angle;
+
+    b->tx.rotation._sin = prSin(b->tx.angle);
+    b->tx.rotation._cos = prCos(b->tx.angle);
+
+    b->prevTx.position = state.previousPosition;
+    b->prevTx.angle = state.previousAngle;
+
+    b->prevTx.rotation._sin = prSin(b->prevTx.angle);
+    b->prevTx.rotation._cos = prCos(b->prevTx.angle);
+
+    b->mtn.velocity = state.velocity;
+    b->mtn.angularVelocity = state.angularVelocity;
+
+    b->mtn.force = state.force, b->mtn.torque = state.torque;
+
+    b->mtn.gravityScale = state.gravityScale;
+
+    b->sleepTime = state.sleepTime, b->sleeping = (state.sleeping != 0u);
+
+    prTransformBodyShape(b);
+}
+
+/* Sets the transform of `b` to `tx`. */
+void prSetBodyTransform(prBody *b, prTransform tx) {
+    if (b == NULL) return;
+
+    prSetBodySleeping(b, false);
+
+    prMarkBodyMoved(b);
+
+    b->tx.position = tx.position;
+
+    b->tx.angle = prNormalizeAngle(tx.angle);
+
+    // NOTE: The rotation data of `tx` might not match the angle of `tx`.
+    b->tx.rotation._sin = prSin(b->tx.angle);
+    b->tx.rotation._cos = prCos(b->tx.angle);
+
+    prTransformBodyShape(b);
+}
+
 /* Sets the position of `b` to `position`. */
 void prSetBodyPosition(prBody *b, prVector2 position) {
     if (b == NULL) return;
 
+    prSetBodySleeping(b, false);
+
+    prMarkBodyMoved(b);
+
     b->tx.position = position;
 
-    b->aabb = prGetShapeAABB(b->shape, b->tx);
+    prTransformBodyShape(b);
 }
 
 /* Sets the `angle` of `b`, in radians. */
 void prSetBodyAngle(prBody *b, float angle) {
     if (b == NULL) return;
 
+    prSetBodySleeping(b, false);
+
+    prMarkBodyMoved(b);
+
     b->tx.angle = prNormalizeAngle(angle);
 
     /*
         NOTE: These values must be cached in order to 
         avoid expensive computations as much as possible.
     */
-    b->tx.rotation._sin = sinf(b->tx.angle);
-    b->tx.rotation._cos = cosf(b->tx.angle);
+    b->tx.rotation._sin = prSin(b->tx.angle);
+    b->tx.rotation._cos = prCos(b->tx.angle);
 
-    b->aabb = prGetShapeAABB(b->shape, b->tx);
+    prTransformBodyShape(b);
 }
 
 /* Sets the gravity `scale` of `b`. */
@@ -238,12 +650,58 @@ void prSetBodyGravityScale(prBody *b, float scale) {
 
 /* Sets the `velocity` of `b`. */
 void prSetBodyVelocity(prBody *b, prVector2 velocity) {
-    if (b != NULL) b->mtn.velocity = velocity;
+    if (b == NULL) return;
+
+    prSetBodySleeping(b, false);
+
+    b->mtn.velocity = velocity;
 }
 
 /* Sets the `angularVelocity` of `b`. */
 void prSetBodyAngularVelocity(prBody *b, float angularVelocity) {
-    if (b != NULL) b->mtn.angularVelocity = angularVelocity;
+    if (b == NULL) return;
+
+    prSetBodySleeping(b, false);
+
+    b->mtn.angularVelocity = angularVelocity;
+}
+
+/* Sets the world that `b` was added to (or `NULL` if it was removed from its world). */
+void prSetBodyWorld(prBody *b, prWorld *w) {
+    if (b != NULL) b->world = w;
+}
+
+/* Sets the index of `b` in the body storage of its world. */
+void prSetBodyStorageIndex(prBody *b, int index) {
+    if (b != NULL) b->storageIndex = index;
+}
+
+/* 
+    Puts `b` to sleep if `sleeping` is `true`, 
+    otherwise wakes up `b` and resets its sleep time. 
+    (The rest of the island of `b` wakes up at the next step of its world.)
+*/
+void prSetBodySleeping(prBody *b, bool sleeping) {
+    if (b == NULL) return;
+
+    if (sleeping) {
+        if (b->type == PR_BODY_STATIC) return;
+
+        b->mtn.velocity.x = b->mtn.velocity.y = b->mtn.angularVelocity = 0.0f;
+        b->mtn.force.x = b->mtn.force.y = b->mtn.torque = 0.0f;
+    } else {
+        // NOTE: Awake bodies must not be modified, since they might be read concurrently.
+        if (!b->sleeping) return;
+
+        b->sleepTime = 0.0f;
+    }
+
+    b->sleeping = sleeping;
+}
+
+/* Marks `b` as moved if `moved` is `true`, otherwise marks `b` as not moved. */
+void prSetBodyMoved(prBody *b, bool moved) {
+    if (b != NULL) b->moved = moved;
 }
 
 /* Sets the user data of `b` to `ctx`. */
@@ -267,7 +725,7 @@ bool prBodyContainsPoint(const prBody *b, prVector2 point) {
         float radius = prGetCircleRadius(s);
 
         return (deltaX * deltaX) + (deltaY * deltaY) <= radius * radius;
-    } else if (type == PR_SHAPE_POLYGON) {
+    } else if (type == PR_SHAPE_POLYGON || type == PR_SHAPE_COMPOUND) {
         const prRay ray = { .origin = point,
                             .direction = { .x = 1.0f, .y = 0.0f },
                             .maxDistance = FLT_MAX };
@@ -282,6 +740,17 @@ bool prBodyContainsPoint(const prBody *b, prVector2 point) {
     }
 }
 
+/* Checks if the collision filters of `b1` and `b2` allow them to collide. */
+bool prShouldBodiesCollide(const prBody *b1, const prBody *b2) {
+    if (b1 == NULL || b2 == NULL) return false;
+
+    const prCollisionFilter f1 = b1->filter, f2 = b2->filter;
+
+    if (f1.group != 0 && f1.group == f2.group) return (f1.group > 0);
+
+    return (f1.mask & f2.category) != 0u && (f2.mask & f1.category) != 0u;
+}
+
 /* Clears accumulated forces on `b`. */
 void prClearBodyForces(prBody *b) {
     if (b == NULL) return;
@@ -293,13 +762,15 @@ void prClearBodyForces(prBody *b) {
 void prApplyForceToBody(prBody *b, prVector2 point, prVector2 force) {
     if (b == NULL || b->mtn.inverseMass <= 0.0f) return;
 
+    prSetBodySleeping(b, false);
+
     b->mtn.force = prVector2Add(b->mtn.force, force);
     b->mtn.torque += prVector2Cross(point, force);
 }
 
 /* Applies a gravity force to `b` with the `g`ravity acceleration vector. */
 void prApplyGravityToBody(prBody *b, prVector2 g) {
-    if (b == NULL || b->mtn.mass <= 0.0f) return;
+    if (b == NULL || b->mtn.mass <= 0.0f || b->sleeping) return;
 
     b->mtn.force = prVector2Add(b->mtn.force,
                                 prVector2ScalarMultiply(g,
@@ -311,6 +782,8 @@ void prApplyGravityToBody(prBody *b, prVector2 g) {
 void prApplyImpulseToBody(prBody *b, prVector2 point, prVector2 impulse) {
     if (b == NULL || b->mtn.inverseMass <= 0.0f) return;
 
+    prSetBodySleeping(b, false);
+
     b->mtn.velocity = prVector2Add(b->mtn.velocity,
                                    prVector2ScalarMultiply(impulse,
                                                            b->mtn.inverseMass));
@@ -323,54 +796,14 @@ void prApplyImpulseToBody(prBody *b, prVector2 point, prVector2 impulse) {
 void prApplyAccumulatedImpulses(prBody *b1, prBody *b2, prCollision *ctx) {
     if (b1 == NULL || b2 == NULL || ctx == NULL) return;
 
-    if (b1->mtn.inverseMass + b2->mtn.inverseMass <= 0.0f) {
-        if (prGetBodyType(b1) == PR_BODY_STATIC)
-            b1->mtn.velocity.x = b1->mtn.velocity
-                                     .y = b1->mtn.angularVelocity = 0.0f;
-
-        if (prGetBodyType(b2) == PR_BODY_STATIC)
-            b2->mtn.velocity.x = b2->mtn.velocity
-                                     .y = b2->mtn.angularVelocity = 0.0f;
-
-        return;
-    }
-
-    const prVector2 ctxTangent = { .x = ctx->direction.y,
-                                   .y = -ctx->direction.x };
-
-    for (int i = 0; i < ctx->count; i++) {
-        const prVector2 contactPoint = ctx->contacts[i].point;
-
-        prVector2 relPosition1 = prVector2Subtract(contactPoint,
-                                                   prGetBodyPosition(b1));
-        prVector2 relPosition2 = prVector2Subtract(contactPoint,
-                                                   prGetBodyPosition(b2));
-
-        float relPositionCross1 = prVector2Cross(relPosition1, ctx->direction);
-        float relPositionCross2 = prVector2Cross(relPosition2, ctx->direction);
-
-        const float normalMass = (b1->mtn.inverseMass + b2->mtn.inverseMass)
-                                 + b1->mtn.inverseInertia
-                                       * (relPositionCross1 * relPositionCross1)
-                                 + b2->mtn.inverseInertia
-                                       * (relPositionCross2
-                                          * relPositionCross2);
-
-        ctx->contacts[i].cache.normalMass = 1.0f / normalMass;
-
-        relPositionCross1 = prVector2Cross(relPosition1, ctxTangent);
-        relPositionCross2 = prVector2Cross(relPosition2, ctxTangent);
+    prBodyStorage bs;
+    prBodyPairStorage bps;
 
-        float tangentMass = (b1->mtn.inverseMass + b2->mtn.inverseMass)
-                            + b1->mtn.inverseInertia
-                                  * (relPositionCross1 * relPositionCross1)
-                            + b2->mtn.inverseInertia
-                                  * (relPositionCross2 * relPositionCross2);
+    prLoadBodyPairToStorage(&bs, &bps, b1, b2);
 
-        ctx->contacts[i].cache.tangentMass = 1.0f / tangentMass;
+    prApplyAccumulatedImpulsesToStorage(&bs, 0, 1, ctx);
 
-        // TODO: ...
-    }
+    prStoreBodyPairVelocities(&bs, b1, b2);
 }
 
 /* 
@@ -378,7 +811,8 @@ void prApplyAccumulatedImpulses(prBody *b1, prBody *b2, prCollision *ctx) {
     then integrates the acceleration over `dt` to calculate the velocity of `b`.
 */
 void prIntegrateForBodyVelocity(prBody *b, float dt) {
-    if (b == NULL || b->mtn.inverseMass <= 0.0f || dt <= 0.0f) return;
+    if (b == NULL || b->mtn.inverseMass <= 0.0f || b->sleeping || dt <= 0.0f)
+        return;
 
     b->mtn.velocity = prVector2Add(b->mtn.velocity,
                                    prVector2ScalarMultiply(b->mtn.force,
@@ -390,14 +824,40 @@ void prIntegrateForBodyVelocity(prBody *b, float dt) {
 
 /* Integrates the velocity of `b` over `dt` to calculate the position of `b`. */
 void prIntegrateForBodyPosition(prBody *b, float dt) {
-    if (b == NULL || b->type == PR_BODY_STATIC || dt <= 0.0f) return;
+    if (b == NULL || b->type == PR_BODY_STATIC || b->sleeping || dt <= 0.0f)
+        return;
 
     b->tx.position.x += b->mtn.velocity.x * dt;
     b->tx.position.y += b->mtn.velocity.y * dt;
 
+    // NOTE: This also transforms the collision shape of `b` to world space.
     prSetBodyAngle(b, b->tx.angle + (b->mtn.angularVelocity * dt));
+}
+
+/* 
+    Adds `dt` to the sleep time of `b` if the speed of `b` is under the 
+    given thresholds, otherwise resets the sleep time of `b`.
+*/
+void prUpdateBodySleepTime(prBody *b,
+                           float dt,
+                           float linearThreshold,
+                           float angularThreshold) {
+    if (b == NULL || b->type == PR_BODY_STATIC || b->sleeping || dt <= 0.0f)
+        return;
 
-    b->aabb = prGetShapeAABB(b->shape, b->tx);
+    const float linearSpeedSquared = prVector2Dot(b->mtn.velocity,
+                                                  b->mtn.velocity);
+
+    if (linearSpeedSquared > linearThreshold * linearThreshold
+        || fabsf(b->mtn.angularVelocity) > angularThreshold)
+        b->sleepTime = 0.0f;
+    else
+        b->sleepTime += dt;
+}
+
+/* Saves the current transform of `b` as its previous transform, for interpolation. */
+void prUpdateBodyPreviousTransform(prBody *b) {
+    if (b != NULL) b->prevTx = b->tx;
 }
 
 /* Resolves the collision between `b1` and `b2`. */
@@ -405,93 +865,569 @@ void prResolveCollision(prBody *b1,
                         prBody *b2,
                         prCollision *ctx,
                         float inverseDt) {
-    if (b1 == NULL || b2 == NULL
-        || b1->mtn.inverseMass + b2->mtn.inverseMass <= 0.0f || ctx == NULL
-        || inverseDt <= 0.0f)
-        return;
-
-    const prVector2 ctxTangent = { .x = ctx->direction.y,
-                                   .y = -ctx->direction.x };
+    if (b1 == NULL || b2 == NULL || ctx == NULL) return;
 
-    for (int i = 0; i < ctx->count; i++) {
-        const prVector2 contactPoint = ctx->contacts[i].point;
+    prBodyStorage bs;
+    prBodyPairStorage bps;
 
-        prVector2 relPosition1 = prVector2Subtract(contactPoint,
-                                                   prGetBodyPosition(b1));
-        prVector2 relPosition2 = prVector2Subtract(contactPoint,
-                                                   prGetBodyPosition(b2));
+    prLoadBodyPairToStorage(&bs, &bps, b1, b2);
 
-        prVector2 relNormal1 = prVector2LeftNormal(relPosition1);
-        prVector2 relNormal2 = prVector2LeftNormal(relPosition2);
+    prResolveCollisionForStorage(&bs, 0, 1, ctx, inverseDt);
 
-        prVector2 relVelocity = prVector2Subtract(
-            prVector2Add(b2->mtn.velocity,
-                         prVector2ScalarMultiply(relNormal2,
-                                                 b2->mtn.angularVelocity)),
-            prVector2Add(b1->mtn.velocity,
-                         prVector2ScalarMultiply(relNormal1,
-                                                 b1->mtn.angularVelocity)));
+    prStoreBodyPairVelocities(&bs, b1, b2);
+}
 
-        float relVelocityDot = prVector2Dot(relVelocity, ctx->direction);
+/* Resizes `bs` to hold the motion data of `count` bodies. */
+void prResizeBodyStorage(prBodyStorage *bs, int count) {
+    if (bs == NULL || count < 0) return;
 
-        const float biasScalar = -(PR_WORLD_BAUMGARTE_FACTOR * inverseDt)
-                                 * fminf(0.0f,
-                                         -ctx->contacts[i].depth
-                                             + PR_WORLD_BAUMGARTE_SLOP);
+    arrsetlen(bs->types, count), arrsetlen(bs->sleeping, count);
 
-        float normalScalar = ((-(1.0f + ctx->restitution) * relVelocityDot)
-                              + biasScalar)
-                             * ctx->contacts[i].cache.normalMass;
+    arrsetlen(bs->positionX, count), arrsetlen(bs->positionY, count);
+    arrsetlen(bs->angles, count);
 
-        if (normalScalar < 0.0f) normalScalar = 0.0f;
+    arrsetlen(bs->velocityX, count), arrsetlen(bs->velocityY, count);
+    arrsetlen(bs->angularVelocities, count);
 
-        {
-            // TODO: ...
-            ctx->contacts[i].cache.normalScalar = normalScalar;
-        }
+    arrsetlen(bs->forceX, count), arrsetlen(bs->forceY, count);
+    arrsetlen(bs->torques, count);
 
-        prVector2 normalImpulse = prVector2ScalarMultiply(ctx->direction,
-                                                          normalScalar);
+    arrsetlen(bs->masses, count), arrsetlen(bs->inverseMasses, count);
+    arrsetlen(bs->inverseInertias, count), arrsetlen(bs->gravityScales, count);
 
-        prApplyImpulseToBody(b1, relPosition1, prVector2Negate(normalImpulse));
-        prApplyImpulseToBody(b2, relPosition2, normalImpulse);
+    bs->count = count;
+}
 
-        relVelocity = prVector2Subtract(
-            prVector2Add(b2->mtn.velocity,
-                         prVector2ScalarMultiply(relNormal2,
-                                                 b2->mtn.angularVelocity)),
-            prVector2Add(b1->mtn.velocity,
-                         prVector2ScalarMultiply(relNormal1,
-                                                 b1->mtn.angularVelocity)));
+/* Releases the memory allocated for the arrays of `bs`. */
+void prReleaseBodyStorage(prBodyStorage *bs) {
+    if (bs == NULL) return;
 
-        float tangentScalar = -prVector2Dot(relVelocity, ctxTangent)
-                              * ctx->contacts[i].cache.tangentMass;
+    arrfree(bs->types), arrfree(bs->sleeping);
 
-        {
-            const float maxTangentScalar = fabsf(ctx->friction * normalScalar);
+    arrfree(bs->positionX), arrfree(bs->positionY), arrfree(bs->angles);
 
-            tangentScalar = fminf(fmaxf(tangentScalar, -maxTangentScalar),
-                                  maxTangentScalar);
+    arrfree(bs->velocityX), arrfree(bs->velocityY);
+    arrfree(bs->angularVelocities);
 
-            // TODO: ...
-            ctx->contacts[i].cache.tangentScalar = tangentScalar;
-        }
+    arrfree(bs->forceX), arrfree(bs->forceY), arrfree(bs->torques);
 
-        prVector2 tangentImpulse = prVector2ScalarMultiply(ctxTangent,
-                                                           tangentScalar);
+    arrfree(bs->masses), arrfree(bs->inverseMasses);
+    arrfree(bs->inverseInertias), arrfree(bs->gravityScales);
 
-        prApplyImpulseToBody(b1, relPosition1, prVector2Negate(tangentImpulse));
-        prApplyImpulseToBody(b2, relPosition2, tangentImpulse);
-    }
+    bs->count = 0;
 }
 
-/* Private Functions ==================================================================== */
+/* 
+    Copies the motion data of `b` to `bs` at `index`, or fills `bs` at `index`
+    with the motion data of a static, sleeping body if `b` is `NULL`.
+*/
+void prLoadBodyToStorage(prBodyStorage *bs, int index, const prBody *b) {
+    if (bs == NULL || index < 0 || index >= bs->count) return;
+
+    // NOTE: An empty entry is never moved by the integrator or the solver.
+    if (b == NULL) {
+        bs->types[index] = PR_BODY_STATIC, bs->sleeping[index] = true;
+
+        bs->positionX[index] = bs->positionY[index] = bs->angles[index] = 0.0f;
+
+        bs->velocityX[index] = bs->velocityY[index] = 0.0f;
+        bs->angularVelocities[index] = 0.0f;
+
+        bs->forceX[index] = bs->forceY[index] = bs->torques[index] = 0.0f;
+
+        bs->masses[index] = bs->inverseMasses[index] = 0.0f;
+        bs->inverseInertias[index] = bs->gravityScales[index] = 0.0f;
+
+        return;
+    }
+
+    bs->types[index] = b->type, bs->sleeping[index] = b->sleeping;
+
+    bs->positionX[index] = b->tx.position.x;
+    bs->positionY[index] = b->tx.position.y;
+    bs->angles[index] = b->tx.angle;
+
+    bs->velocityX[index] = b->mtn.velocity.x;
+    bs->velocityY[index] = b->mtn.velocity.y;
+    bs->angularVelocities[index] = b->mtn.angularVelocity;
+
+    bs->forceX[index] = b->mtn.force.x, bs->forceY[index] = b->mtn.force.y;
+    bs->torques[index] = b->mtn.torque;
+
+    bs->masses[index] = b->mtn.mass;
+    bs->inverseMasses[index] = b->mtn.inverseMass;
+    bs->inverseInertias[index] = b->mtn.inverseInertia;
+    bs->gravityScales[index] = b->mtn.gravityScale;
+}
+
+/* 
+    Copies the velocities in `bs` at `index` back to `b`, then updates 
+    the transform and the AABB of `b` if `b` is neither static nor sleeping.
+*/
+void prStoreBodyFromStorage(const prBodyStorage *bs, int index, prBody *b) {
+    if (bs == NULL || index < 0 || index >= bs->count || b == NULL) return;
+
+    b->mtn.velocity.x = bs->velocityX[index];
+    b->mtn.velocity.y = bs->velocityY[index];
+    b->mtn.angularVelocity = bs->angularVelocities[index];
+
+    if (b->type == PR_BODY_STATIC || b->sleeping) return;
+
+    b->tx.position.x = bs->positionX[index];
+    b->tx.position.y = bs->positionY[index];
+
+    const float angle = prNormalizeAngle(bs->angles[index]);
+
+    /*
+        NOTE: The rotation data of `b` always matches the angle of `b`, so bodies
+        that did not rotate (e.g. bodies with infinite inertia) can skip it.
+    */
+    if (b->tx.angle != angle) {
+        b->tx.angle = angle;
+
+        b->tx.rotation._sin = prSin(b->tx.angle);
+        b->tx.rotation._cos = prCos(b->tx.angle);
+    }
+
+    prTransformBodyShape(b);
+}
+
+/* 
+    Applies the `g`ravity acceleration vector and the accumulated forces 
+    to each body in `bs`, then integrates the accelerations over `dt`
+    to calculate the velocities of the bodies.
+*/
+void prIntegrateBodyStorageVelocities(prBodyStorage *bs,
+                                      prVector2 g,
+                                      float dt) {
+    if (bs == NULL || dt <= 0.0f) return;
+
+    int i = 0;
+
+#ifdef PR_SIMD_LANE_COUNT
+    {
+        const prLane zero = prLaneSet(0.0f), vDt = prLaneSet(dt);
+        const prLane gX = prLaneSet(g.x), gY = prLaneSet(g.y);
+
+        for (; i + PR_SIMD_LANE_COUNT <= bs->count; i += PR_SIMD_LANE_COUNT) {
+            float awakeFlags[PR_SIMD_LANE_COUNT];
+
+            for (int j = 0; j < PR_SIMD_LANE_COUNT; j++)
+                awakeFlags[j] = bs->sleeping[i + j] ? 0.0f : 1.0f;
+
+            const prLane inverseMasses = prLaneLoad(&bs->inverseMasses[i]);
+
+            const prLaneMask mask = prLaneAnd(prLaneGreater(inverseMasses, zero),
+                                              prLaneGreater(prLaneLoad(awakeFlags),
+                                                            zero));
+
+            const prLane gravityScalars = prLaneMultiply(
+                prLaneLoad(&bs->gravityScales[i]), prLaneLoad(&bs->masses[i]));
+
+            const prLane forceX = prLaneAdd(prLaneLoad(&bs->forceX[i]),
+                                            prLaneMultiply(gX, gravityScalars));
+            const prLane forceY = prLaneAdd(prLaneLoad(&bs->forceY[i]),
+                                            prLaneMultiply(gY, gravityScalars));
+
+            const prLane inverseMassDts = prLaneMultiply(inverseMasses, vDt);
+
+            const prLane velocityX = prLaneLoad(&bs->velocityX[i]);
+            const prLane velocityY = prLaneLoad(&bs->velocityY[i]);
+
+            const prLane angularVelocities = prLaneLoad(
+                &bs->angularVelocities[i]);
+
+            const prLane angularAccelerations = prLaneMultiply(
+                prLaneLoad(&bs->torques[i]), prLaneLoad(&bs->inverseInertias[i]));
+
+            prLaneStore(&bs->velocityX[i],
+                        prLaneSelect(mask,
+                                     prLaneAdd(velocityX,
+                                               prLaneMultiply(forceX,
+                                                              inverseMassDts)),
+                                     velocityX));
+            prLaneStore(&bs->velocityY[i],
+                        prLaneSelect(mask,
+                                     prLaneAdd(velocityY,
+                                               prLaneMultiply(forceY,
+                                                              inverseMassDts)),
+                                     velocityY));
+
+            prLaneStore(&bs->angularVelocities[i],
+                        prLaneSelect(mask,
+                                     prLaneAdd(angularVelocities,
+                                               prLaneMultiply(angularAccelerations,
+                                                              vDt)),
+                                     angularVelocities));
+        }
+    }
+#endif
+
+    // NOTE: This gives the same results as `prIntegrateForBodyVelocity()`.
+    for (; i < bs->count; i++) {
+        if (bs->inverseMasses[i] <= 0.0f || bs->sleeping[i]) continue;
+
+        const float gravityScalar = bs->gravityScales[i] * bs->masses[i];
+
+        const float forceX = bs->forceX[i] + g.x * gravityScalar;
+        const float forceY = bs->forceY[i] + g.y * gravityScalar;
+
+        const float inverseMassDt = bs->inverseMasses[i] * dt;
+
+        bs->velocityX[i] += forceX * inverseMassDt;
+        bs->velocityY[i] += forceY * inverseMassDt;
+
+        bs->angularVelocities[i] += (bs->torques[i] * bs->inverseInertias[i])
+                                    * dt;
+    }
+}
+
+/* Integrates the velocity of each body in `bs` over `dt` to calculate its position. */
+void prIntegrateBodyStoragePositions(prBodyStorage *bs, float dt) {
+    if (bs == NULL || dt <= 0.0f) return;
+
+    int i = 0;
+
+#ifdef PR_SIMD_LANE_COUNT
+    {
+        const prLane zero = prLaneSet(0.0f), vDt = prLaneSet(dt);
+
+        for (; i + PR_SIMD_LANE_COUNT <= bs->count; i += PR_SIMD_LANE_COUNT) {
+            float movingFlags[PR_SIMD_LANE_COUNT];
+
+            for (int j = 0; j < PR_SIMD_LANE_COUNT; j++)
+                movingFlags[j] = (bs->types[i + j] == PR_BODY_STATIC
+                                  || bs->sleeping[i + j])
+                                     ? 0.0f
+                                     : 1.0f;
+
+            const prLaneMask mask = prLaneGreater(prLaneLoad(movingFlags), zero);
+
+            const prLane positionX = prLaneLoad(&bs->positionX[i]);
+            const prLane positionY = prLaneLoad(&bs->positionY[i]);
+
+            const prLane angles = prLaneLoad(&bs->angles[i]);
+
+            prLaneStore(&bs->positionX[i],
+                        prLaneSelect(mask,
+                                     prLaneAdd(positionX,
+                                               prLaneMultiply(prLaneLoad(
+                                                                  &bs->velocityX[i]),
+                                                              vDt)),
+                                     positionX));
+            prLaneStore(&bs->positionY[i],
+                        prLaneSelect(mask,
+                                     prLaneAdd(positionY,
+                                               prLaneMultiply(prLaneLoad(
+                                                                  &bs->velocityY[i]),
+                                                              vDt)),
+                                     positionY));
+
+            prLaneStore(&bs->angles[i],
+                        prLaneSelect(mask,
+                                     prLaneAdd(angles,
+                                               prLaneMultiply(
+                                                   prLaneLoad(
+                                                       &bs->angularVelocities[i]),
+                                                   vDt)),
+                                     angles));
+        }
+    }
+#endif
+
+    for (; i < bs->count; i++) {
+        if (bs->types[i] == PR_BODY_STATIC || bs->sleeping[i]) continue;
+
+        bs->positionX[i] += bs->velocityX[i] * dt;
+        bs->positionY[i] += bs->velocityY[i] * dt;
+
+        bs->angles[i] += bs->angularVelocities[i] * dt;
+    }
+}
+
+/* Applies accumulated impulses to the bodies in `bs` at `i1` and `i2`. */
+void prApplyAccumulatedImpulsesToStorage(prBodyStorage *bs,
+                                         int i1,
+                                         int i2,
+                                         prCollision *ctx) {
+    if (bs == NULL || ctx == NULL) return;
+
+    const float inverseMass1 = bs->inverseMasses[i1],
+                inverseMass2 = bs->inverseMasses[i2];
+
+    if (inverseMass1 + inverseMass2 <= 0.0f) {
+        if (bs->types[i1] == PR_BODY_STATIC)
+            bs->velocityX[i1] = bs->velocityY[i1] = bs->angularVelocities
+                [i1] = 0.0f;
+
+        if (bs->types[i2] == PR_BODY_STATIC)
+            bs->velocityX[i2] = bs->velocityY[i2] = bs->angularVelocities
+                [i2] = 0.0f;
+
+        return;
+    }
+
+    const float inverseInertia1 = bs->inverseInertias[i1],
+                inverseInertia2 = bs->inverseInertias[i2];
+
+    const prVector2 position1 = { .x = bs->positionX[i1],
+                                  .y = bs->positionY[i1] };
+    const prVector2 position2 = { .x = bs->positionX[i2],
+                                  .y = bs->positionY[i2] };
+
+    const prVector2 ctxTangent = { .x = ctx->direction.y,
+                                   .y = -ctx->direction.x };
+
+    for (int i = 0; i < ctx->count; i++) {
+        const prVector2 contactPoint = ctx->contacts[i].point;
+
+        prVector2 relPosition1 = prVector2Subtract(contactPoint, position1);
+        prVector2 relPosition2 = prVector2Subtract(contactPoint, position2);
+
+        float relPositionCross1 = prVector2Cross(relPosition1, ctx->direction);
+        float relPositionCross2 = prVector2Cross(relPosition2, ctx->direction);
+
+        const float normalMass = (inverseMass1 + inverseMass2)
+                                 + inverseInertia1
+                                       * (relPositionCross1 * relPositionCross1)
+                                 + inverseInertia2
+                                       * (relPositionCross2
+                                          * relPositionCross2);
+
+        ctx->contacts[i].cache.normalMass = 1.0f / normalMass;
+
+        relPositionCross1 = prVector2Cross(relPosition1, ctxTangent);
+        relPositionCross2 = prVector2Cross(relPosition2, ctxTangent);
+
+        float tangentMass = (inverseMass1 + inverseMass2)
+                            + inverseInertia1
+                                  * (relPositionCross1 * relPositionCross1)
+                            + inverseInertia2
+                                  * (relPositionCross2 * relPositionCross2);
+
+        ctx->contacts[i].cache.tangentMass = 1.0f / tangentMass;
+
+        // TODO: ...
+    }
+}
+
+/* Resolves the collision between the bodies in `bs` at `i1` and `i2`. */
+void prResolveCollisionForStorage(prBodyStorage *bs,
+                                  int i1,
+                                  int i2,
+                                  prCollision *ctx,
+                                  float inverseDt) {
+    if (bs == NULL || ctx == NULL || inverseDt <= 0.0f) return;
+
+    const float inverseMass1 = bs->inverseMasses[i1],
+                inverseMass2 = bs->inverseMasses[i2];
+
+    if (inverseMass1 + inverseMass2 <= 0.0f) return;
+
+    const float inverseInertia1 = bs->inverseInertias[i1],
+                inverseInertia2 = bs->inverseInertias[i2];
+
+    const prVector2 position1 = { .x = bs->positionX[i1],
+                                  .y = bs->positionY[i1] };
+    const prVector2 position2 = { .x = bs->positionX[i2],
+                                  .y = bs->positionY[i2] };
+
+    prVector2 velocity1 = { .x = bs->velocityX[i1], .y = bs->velocityY[i1] };
+    prVector2 velocity2 = { .x = bs->velocityX[i2], .y = bs->velocityY[i2] };
+
+    float angularVelocity1 = bs->angularVelocities[i1];
+    float angularVelocity2 = bs->angularVelocities[i2];
+
+    const prVector2 ctxTangent = { .x = ctx->direction.y,
+                                   .y = -ctx->direction.x };
+
+    for (int i = 0; i < ctx->count; i++) {
+        const prVector2 contactPoint = ctx->contacts[i].point;
+
+        prVector2 relPosition1 = prVector2Subtract(contactPoint, position1);
+        prVector2 relPosition2 = prVector2Subtract(contactPoint, position2);
+
+        prVector2 relNormal1 = prVector2LeftNormal(relPosition1);
+        prVector2 relNormal2 = prVector2LeftNormal(relPosition2);
+
+        prVector2 relVelocity = prVector2Subtract(
+            prVector2Add(velocity2,
+                         prVector2ScalarMultiply(relNormal2, angularVelocity2)),
+            prVector2Add(velocity1,
+                         prVector2ScalarMultiply(relNormal1,
+                                                 angularVelocity1)));
+
+        float relVelocityDot = prVector2Dot(relVelocity, ctx->direction);
+
+        const float biasScalar = -(PR_WORLD_BAUMGARTE_FACTOR * inverseDt)
+                                 * fminf(0.0f,
+                                         -ctx->contacts[i].depth
+                                             + PR_WORLD_BAUMGARTE_SLOP);
+
+        float normalScalar = ((-(1.0f + ctx->restitution) * relVelocityDot)
+                              + biasScalar)
+                             * ctx->contacts[i].cache.normalMass;
+
+        if (normalScalar < 0.0f) normalScalar = 0.0f;
+
+        {
+            // TODO: ...
+            ctx->contacts[i].cache.normalScalar = normalScalar;
+        }
+
+        prVector2 normalImpulse = prVector2ScalarMultiply(ctx->direction,
+                                                          normalScalar);
+
+        prApplyImpulseToVelocity(&velocity1,
+                                 &angularVelocity1,
+                                 inverseMass1,
+                                 inverseInertia1,
+                                 relPosition1,
+                                 prVector2Negate(normalImpulse));
+        prApplyImpulseToVelocity(&velocity2,
+                                 &angularVelocity2,
+                                 inverseMass2,
+                                 inverseInertia2,
+                                 relPosition2,
+                                 normalImpulse);
+
+        relVelocity = prVector2Subtract(
+            prVector2Add(velocity2,
+                         prVector2ScalarMultiply(relNormal2, angularVelocity2)),
+            prVector2Add(velocity1,
+                         prVector2ScalarMultiply(relNormal1,
+                                                 angularVelocity1)));
+
+        float tangentScalar = -prVector2Dot(relVelocity, ctxTangent)
+                              * ctx->contacts[i].cache.tangentMass;
+
+        {
+            const float maxTangentScalar = fabsf(ctx->friction * normalScalar);
+
+            tangentScalar = fminf(fmaxf(tangentScalar, -maxTangentScalar),
+                                  maxTangentScalar);
+
+            // TODO: ...
+            ctx->contacts[i].cache.tangentScalar = tangentScalar;
+        }
+
+        prVector2 tangentImpulse = prVector2ScalarMultiply(ctxTangent,
+                                                           tangentScalar);
+
+        prApplyImpulseToVelocity(&velocity1,
+                                 &angularVelocity1,
+                                 inverseMass1,
+                                 inverseInertia1,
+                                 relPosition1,
+                                 prVector2Negate(tangentImpulse));
+        prApplyImpulseToVelocity(&velocity2,
+                                 &angularVelocity2,
+                                 inverseMass2,
+                                 inverseInertia2,
+                                 relPosition2,
+                                 tangentImpulse);
+    }
+
+    /*
+        NOTE: Bodies with infinite mass must not be written to, 
+        since they might be shared by multiple islands.
+    */
+    if (inverseMass1 > 0.0f) {
+        bs->velocityX[i1] = velocity1.x, bs->velocityY[i1] = velocity1.y;
+        bs->angularVelocities[i1] = angularVelocity1;
+    }
+
+    if (inverseMass2 > 0.0f) {
+        bs->velocityX[i2] = velocity2.x, bs->velocityY[i2] = velocity2.y;
+        bs->angularVelocities[i2] = angularVelocity2;
+    }
+}
+
+/* 
+    Resolves the `count` contact `constraints` of the bodies in `bs` for up to 
+    `iterationCount` times, using `sb` as scratch memory, then returns the number 
+    of iterations done. If `tolerance` is positive, this stops early once 
+    no impulse of an iteration is larger than `tolerance`.
+*/
+int prSolveContactConstraints(prBodyStorage *bs,
+                              prContactConstraint *constraints,
+                              int count,
+                              int iterationCount,
+                              float tolerance,
+                              float inverseDt,
+                              prSolverBuffer *sb) {
+    if (bs == NULL || constraints == NULL || count <= 0 || inverseDt <= 0.0f)
+        return 0;
+
+#ifdef PR_SIMD_LANE_COUNT
+    if (sb != NULL) {
+        const int batchCount = prBuildContactBatches(bs,
+                                                     constraints,
+                                                     count,
+                                                     sb);
+
+        /*
+            NOTE: Each body is updated by its constraints in the same order 
+            as in the loop below, which makes both of them give the same results.
+        */
+        for (int i = 0; i < iterationCount; i++) {
+            for (int j = 0; j < batchCount; j++)
+                prResolveContactBatch(bs,
+                                      constraints,
+                                      &sb->batchLanes[j * PR_SIMD_LANE_COUNT],
+                                      sb->batchSizes[j],
+                                      inverseDt);
+
+            if (prHasSolverConverged(constraints, count, tolerance))
+                return i + 1;
+        }
+
+        return iterationCount;
+    }
+#endif
+
+    for (int i = 0; i < iterationCount; i++) {
+        for (int j = 0; j < count; j++)
+            prResolveCollisionForStorage(bs,
+                                         constraints[j].first,
+                                         constraints[j].second,
+                                         constraints[j].collision,
+                                         inverseDt);
+
+        if (prHasSolverConverged(constraints, count, tolerance)) return i + 1;
+    }
+
+    return iterationCount;
+}
+
+/* Releases the memory allocated for the arrays of `sb`. */
+void prReleaseSolverBuffer(prSolverBuffer *sb) {
+    if (sb == NULL) return;
+
+    arrfree(sb->lastBatches);
+    arrfree(sb->batchLanes), arrfree(sb->batchSizes);
+}
+
+/* Private Functions ==================================================================== */
+
+/* 
+    Marks `b` as moved, then marks the broad-phase data structure 
+    of the world of `b` (if any) as out of date.
+*/
+static PR_API_INLINE void prMarkBodyMoved(prBody *b) {
+    b->moved = true;
+
+    prMarkWorldBroadPhaseDirty(b->world);
+}
 
 /* Computes the mass and the moment of inertia for `b`. */
 static void prComputeBodyMass(prBody *b) {
     b->mtn.mass = b->mtn.inverseMass = 0.0f;
     b->mtn.inertia = b->mtn.inverseInertia = 0.0f;
 
+    // NOTE: The material of `b` might override the material of its collision shape.
+    const float density = prGetBodyMaterial(b).density;
+
     switch (b->type) {
         case PR_BODY_STATIC:
             b->mtn.velocity.x = b->mtn.velocity.y = b->mtn
@@ -501,13 +1437,13 @@ static void prComputeBodyMass(prBody *b) {
 
         case PR_BODY_DYNAMIC:
             if (!(b->flags & PR_FLAG_INFINITE_MASS)) {
-                b->mtn.mass = prGetShapeMass(b->shape);
+                b->mtn.mass = prComputeShapeMass(b->shape, density);
 
                 if (b->mtn.mass > 0.0f) b->mtn.inverseMass = 1.0f / b->mtn.mass;
             }
 
             if (!(b->flags & PR_FLAG_INFINITE_INERTIA)) {
-                b->mtn.inertia = prGetShapeInertia(b->shape);
+                b->mtn.inertia = prComputeShapeInertia(b->shape, density);
 
                 if (b->mtn.inertia > 0.0f)
                     b->mtn.inverseInertia = 1.0f / b->mtn.inertia;
@@ -520,8 +1456,784 @@ static void prComputeBodyMass(prBody *b) {
     }
 }
 
+/* 
+    Transforms the vertices and normals of the collision shape of `b` 
+    to world space, then updates the AABB of `b`.
+*/
+static void prTransformBodyShape(prBody *b) {
+    if (prGetShapeType(b->shape) != PR_SHAPE_POLYGON) {
+        b->txVertices.count = b->txNormals.count = 0;
+
+        b->aabb = (b->shape != NULL) ? prGetShapeAABB(b->shape, b->tx)
+                                     : PR_API_STRUCT_ZERO(prAABB);
+
+        return;
+    }
+
+    prTransformPolygon(b->shape, b->tx, &b->txVertices, &b->txNormals);
+
+    prVector2 minVertex = { .x = FLT_MAX, .y = FLT_MAX };
+    prVector2 maxVertex = { .x = -FLT_MAX, .y = -FLT_MAX };
+
+    // NOTE: The vertices are already transformed, so this is cheaper than `prGetShapeAABB()`.
+    for (int i = 0; i < b->txVertices.count; i++) {
+        const prVector2 v = b->txVertices.data[i];
+
+        if (minVertex.x > v.x) minVertex.x = v.x;
+        if (minVertex.y > v.y) minVertex.y = v.y;
+
+        if (maxVertex.x < v.x) maxVertex.x = v.x;
+        if (maxVertex.y < v.y) maxVertex.y = v.y;
+    }
+
+    b->aabb = (prAABB) { .x = minVertex.x,
+                         .y = minVertex.y,
+                         .width = maxVertex.x - minVertex.x,
+                         .height = maxVertex.y - minVertex.y };
+}
+
 /* Normalizes the `angle` to a range `[-2π, 2π]`. */
 static PR_API_INLINE float prNormalizeAngle(float angle) {
     // return angle - (TWO_PI * floorf((angle + (M_PI - ?)) * INVERSE_TWO_PI));
     return angle - (TWO_PI * floorf((angle + -M_PI) * INVERSE_TWO_PI));
-}
\ No newline at end of file
+}
+
+/* Applies an `impulse` at a `point` to the given velocities of a body. */
+static PR_API_INLINE void prApplyImpulseToVelocity(prVector2 *velocity,
+                                                   float *angularVelocity,
+                                                   float inverseMass,
+                                                   float inverseInertia,
+                                                   prVector2 point,
+                                                   prVector2 impulse) {
+    if (inverseMass <= 0.0f) return;
+
+    *velocity = prVector2Add(*velocity,
+                             prVector2ScalarMultiply(impulse, inverseMass));
+
+    *angularVelocity += inverseInertia * prVector2Cross(point, impulse);
+}
+
+/* 
+    Returns `true` if `tolerance` is positive and no impulse of the last iteration
+    on the `count` contact `constraints` is larger than `tolerance`.
+*/
+static bool prHasSolverConverged(const prContactConstraint *constraints,
+                                 int count,
+                                 float tolerance) {
+    if (tolerance <= 0.0f) return false;
+
+    // NOTE: The cache of each contact holds the impulses of the last iteration.
+    for (int i = 0; i < count; i++) {
+        const prCollision *collision = constraints[i].collision;
+
+        for (int j = 0; j < collision->count; j++)
+            if (fabsf(collision->contacts[j].cache.normalScalar) > tolerance
+                || fabsf(collision->contacts[j].cache.tangentScalar)
+                       > tolerance)
+                return false;
+    }
+
+    return true;
+}
+
+/* Makes `bs` point to the arrays of `bps`, then copies `b1` and `b2` to `bs`. */
+static void prLoadBodyPairToStorage(prBodyStorage *bs,
+                                    prBodyPairStorage *bps,
+                                    const prBody *b1,
+                                    const prBody *b2) {
+    *bs = (prBodyStorage) { .types = bps->types,
+                            .sleeping = bps->sleeping,
+                            .positionX = bps->positionX,
+                            .positionY = bps->positionY,
+                            .angles = bps->angles,
+                            .velocityX = bps->velocityX,
+                            .velocityY = bps->velocityY,
+                            .angularVelocities = bps->angularVelocities,
+                            .forceX = bps->forceX,
+                            .forceY = bps->forceY,
+                            .torques = bps->torques,
+                            .masses = bps->masses,
+                            .inverseMasses = bps->inverseMasses,
+                            .inverseInertias = bps->inverseInertias,
+                            .gravityScales = bps->gravityScales,
+                            .count = 2 };
+
+    prLoadBodyToStorage(bs, 0, b1), prLoadBodyToStorage(bs, 1, b2);
+}
+
+/* Copies the velocities of two bodies in `bs` back to `b1` and `b2`. */
+static void prStoreBodyPairVelocities(const prBodyStorage *bs,
+                                      prBody *b1,
+                                      prBody *b2) {
+    prBody *bodies[2] = { b1, b2 };
+
+    for (int i = 0; i < 2; i++) {
+        prBody *b = bodies[i];
+
+        if (b->mtn.velocity.x == bs->velocityX[i]
+            && b->mtn.velocity.y == bs->velocityY[i]
+            && b->mtn.angularVelocity == bs->angularVelocities[i])
+            continue;
+
+        prSetBodySleeping(b, false);
+
+        b->mtn.velocity.x = bs->velocityX[i];
+        b->mtn.velocity.y = bs->velocityY[i];
+        b->mtn.angularVelocity = bs->angularVelocities[i];
+    }
+}
+
+#ifdef PR_SIMD_LANE_COUNT
+
+/* 
+    Assigns the contact `constraints` of the bodies in `bs` to batches of constraints 
+    that do not share any body with finite mass, then returns the number of batches.
+*/
+static int prBuildContactBatches(const prBodyStorage *bs,
+                                 const prContactConstraint *constraints,
+                                 int count,
+                                 prSolverBuffer *sb) {
+    const int lastBatchCount = arrlen(sb->lastBatches);
+
+    if (lastBatchCount < bs->count) {
+        arrsetlen(sb->lastBatches, bs->count);
+
+        for (int i = lastBatchCount; i < bs->count; i++)
+            sb->lastBatches[i] = -1;
+    }
+
+    arrsetlen(sb->batchLanes, 0), arrsetlen(sb->batchSizes, 0);
+
+    int firstOpenBatch = 0;
+
+    for (int i = 0; i < count; i++) {
+        const int i1 = constraints[i].first, i2 = constraints[i].second;
+
+        const float inverseMass1 = bs->inverseMasses[i1],
+                    inverseMass2 = bs->inverseMasses[i2];
+
+        // NOTE: `prResolveCollisionForStorage()` also ignores these constraints.
+        if (inverseMass1 + inverseMass2 <= 0.0f) continue;
+
+        /*
+            NOTE: A constraint must be resolved after the previous constraints
+            of its bodies with finite mass, so it goes to the first batch 
+            with a free lane after the last batches of these bodies.
+        */
+        int batch = firstOpenBatch;
+
+        if (inverseMass1 > 0.0f && batch <= sb->lastBatches[i1])
+            batch = sb->lastBatches[i1] + 1;
+
+        if (inverseMass2 > 0.0f && batch <= sb->lastBatches[i2])
+            batch = sb->lastBatches[i2] + 1;
+
+        while (batch < arrlen(sb->batchSizes)
+               && sb->batchSizes[batch] >= PR_SIMD_LANE_COUNT)
+            batch++;
+
+        if (batch == arrlen(sb->batchSizes)) {
+            arrput(sb->batchSizes, 0);
+
+            arraddnptr(sb->batchLanes, PR_SIMD_LANE_COUNT);
+        }
+
+        sb->batchLanes[batch * PR_SIMD_LANE_COUNT + sb->batchSizes[batch]] = i;
+
+        sb->batchSizes[batch]++;
+
+        while (firstOpenBatch < arrlen(sb->batchSizes)
+               && sb->batchSizes[firstOpenBatch] >= PR_SIMD_LANE_COUNT)
+            firstOpenBatch++;
+
+        if (inverseMass1 > 0.0f) sb->lastBatches[i1] = batch;
+        if (inverseMass2 > 0.0f) sb->lastBatches[i2] = batch;
+    }
+
+    for (int i = 0; i < count; i++)
+        sb->lastBatches[constraints[i].first] = sb->lastBatches
+            [constraints[i].second] = -1;
+
+    return arrlen(sb->batchSizes);
+}
+
+/* Resolves a batch of `laneCount` contact `constraints` at `lanes` at once. */
+static void prResolveContactBatch(prBodyStorage *bs,
+                                  const prContactConstraint *constraints,
+                                  const int *lanes,
+                                  int laneCount,
+                                  float inverseDt) {
+    float positionX[2][PR_SIMD_LANE_COUNT], positionY[2][PR_SIMD_LANE_COUNT];
+
+    float velocityX[2][PR_SIMD_LANE_COUNT], velocityY[2][PR_SIMD_LANE_COUNT];
+    float angularVelocities[2][PR_SIMD_LANE_COUNT];
+
+    float inverseMasses[2][PR_SIMD_LANE_COUNT];
+    float inverseInertias[2][PR_SIMD_LANE_COUNT];
+
+    float directionX[PR_SIMD_LANE_COUNT], directionY[PR_SIMD_LANE_COUNT];
+    float frictions[PR_SIMD_LANE_COUNT], restitutions[PR_SIMD_LANE_COUNT];
+
+    float pointX[2][PR_SIMD_LANE_COUNT], pointY[2][PR_SIMD_LANE_COUNT];
+    float depths[2][PR_SIMD_LANE_COUNT], contactFlags[2][PR_SIMD_LANE_COUNT];
+
+    float normalMasses[2][PR_SIMD_LANE_COUNT];
+    float tangentMasses[2][PR_SIMD_LANE_COUNT];
+
+    float normalScalars[2][PR_SIMD_LANE_COUNT];
+    float tangentScalars[2][PR_SIMD_LANE_COUNT];
+
+    // NOTE: Most contacts of circles only have one contact point.
+    int contactCount = 0;
+
+    // NOTE: Unused lanes and contact points are filled with zeros.
+    for (int l = 0; l < PR_SIMD_LANE_COUNT; l++) {
+        const prContactConstraint *constraint = (l < laneCount)
+                                                    ? &constraints[lanes[l]]
+                                                    : NULL;
+
+        const prCollision *ctx = (constraint != NULL) ? constraint->collision
+                                                      : NULL;
+
+        for (int j = 0; j < 2; j++) {
+            if (constraint == NULL) {
+                positionX[j][l] = positionY[j][l] = 0.0f;
+
+                velocityX[j][l] = velocityY[j][l] = angularVelocities[j][l] = 0.0f;
+
+                inverseMasses[j][l] = inverseInertias[j][l] = 0.0f;
+
+                continue;
+            }
+
+            const int index = (j == 0) ? constraint->first : constraint->second;
+
+            positionX[j][l] = bs->positionX[index];
+            positionY[j][l] = bs->positionY[index];
+
+            velocityX[j][l] = bs->velocityX[index];
+            velocityY[j][l] = bs->velocityY[index];
+
+            angularVelocities[j][l] = bs->angularVelocities[index];
+
+            inverseMasses[j][l] = bs->inverseMasses[index];
+            inverseInertias[j][l] = bs->inverseInertias[index];
+        }
+
+        directionX[l] = (ctx != NULL) ? ctx->direction.x : 0.0f;
+        directionY[l] = (ctx != NULL) ? ctx->direction.y : 0.0f;
+
+        frictions[l] = (ctx != NULL) ? ctx->friction : 0.0f;
+        restitutions[l] = (ctx != NULL) ? ctx->restitution : 0.0f;
+
+        if (ctx != NULL && contactCount < ctx->count) contactCount = ctx->count;
+
+        for (int i = 0; i < 2; i++) {
+            if (ctx == NULL || i >= ctx->count) {
+                pointX[i][l] = pointY[i][l] = depths[i][l] = 0.0f;
+
+                normalMasses[i][l] = tangentMasses[i][l] = 0.0f;
+
+                contactFlags[i][l] = 0.0f;
+
+                continue;
+            }
+
+            pointX[i][l] = ctx->contacts[i].point.x;
+            pointY[i][l] = ctx->contacts[i].point.y;
+
+            depths[i][l] = ctx->contacts[i].depth;
+
+            normalMasses[i][l] = ctx->contacts[i].cache.normalMass;
+            tangentMasses[i][l] = ctx->contacts[i].cache.tangentMass;
+
+            contactFlags[i][l] = 1.0f;
+        }
+    }
+
+    const prLane zero = prLaneSet(0.0f), one = prLaneSet(1.0f);
+
+    const prLane biasFactor = prLaneSet(-(PR_WORLD_BAUMGARTE_FACTOR * inverseDt));
+    const prLane biasSlop = prLaneSet(PR_WORLD_BAUMGARTE_SLOP);
+
+    prLane vPositionX[2], vPositionY[2];
+    prLane vVelocityX[2], vVelocityY[2], vAngularVelocities[2];
+    prLane vInverseMasses[2], vInverseInertias[2];
+
+    prLaneMask movable[2];
+
+    for (int j = 0; j < 2; j++) {
+        vPositionX[j] = prLaneLoad(positionX[j]);
+        vPositionY[j] = prLaneLoad(positionY[j]);
+
+        vVelocityX[j] = prLaneLoad(velocityX[j]);
+        vVelocityY[j] = prLaneLoad(velocityY[j]);
+
+        vAngularVelocities[j] = prLaneLoad(angularVelocities[j]);
+
+        vInverseMasses[j] = prLaneLoad(inverseMasses[j]);
+        vInverseInertias[j] = prLaneLoad(inverseInertias[j]);
+
+        movable[j] = prLaneGreater(vInverseMasses[j], zero);
+    }
+
+    const prLane vDirectionX = prLaneLoad(directionX);
+    const prLane vDirectionY = prLaneLoad(directionY);
+
+    const prLane vTangentX = vDirectionY, vTangentY = prLaneNegate(vDirectionX);
+
+    const prLane vFrictions = prLaneLoad(frictions);
+
+    const prLane vRestitutionScalars = prLaneNegate(
+        prLaneAdd(one, prLaneLoad(restitutions)));
+
+    /*
+        NOTE: A contact point that is inactive in every lane would not change
+        any velocity, so the batch can skip it without changing the results.
+    */
+    for (int i = 0; i < contactCount; i++) {
+        const prLaneMask active = prLaneGreater(prLaneLoad(contactFlags[i]), zero);
+
+        const prLane vPointX = prLaneLoad(pointX[i]);
+        const prLane vPointY = prLaneLoad(pointY[i]);
+
+        prLane relPositionX[2], relPositionY[2];
+        prLane relNormalX[2], relNormalY[2];
+
+        prLaneMask masks[2];
+
+        for (int j = 0; j < 2; j++) {
+            masks[j] = prLaneAnd(active, movable[j]);
+
+            relPositionX[j] = prLaneSubtract(vPointX, vPositionX[j]);
+            relPositionY[j] = prLaneSubtract(vPointY, vPositionY[j]);
+
+            // NOTE: This gives the same results as `prVector2LeftNormal()`.
+            const prLane normalX = prLaneNegate(relPositionY[j]);
+            const prLane normalY = relPositionX[j];
+
+            const prLane magnitude = prLaneSqrt(
+                prLaneAdd(prLaneMultiply(normalX, normalX),
+                          prLaneMultiply(normalY, normalY)));
+
+            const prLaneMask nonZero = prLaneGreater(magnitude, zero);
+
+            const prLane inverseMagnitude = prLaneDivide(one, magnitude);
+
+            relNormalX[j] = prLaneSelect(nonZero,
+                                         prLaneMultiply(normalX,
+                                                        inverseMagnitude),
+                                         normalX);
+            relNormalY[j] = prLaneSelect(nonZero,
+                                         prLaneMultiply(normalY,
+                                                        inverseMagnitude),
+                                         normalY);
+        }
+
+        prLane relVelocityX = prLaneSubtract(
+            prLaneAdd(vVelocityX[1],
+                      prLaneMultiply(relNormalX[1], vAngularVelocities[1])),
+            prLaneAdd(vVelocityX[0],
+                      prLaneMultiply(relNormalX[0], vAngularVelocities[0])));
+        prLane relVelocityY = prLaneSubtract(
+            prLaneAdd(vVelocityY[1],
+                      prLaneMultiply(relNormalY[1], vAngularVelocities[1])),
+            prLaneAdd(vVelocityY[0],
+                      prLaneMultiply(relNormalY[0], vAngularVelocities[0])));
+
+        const prLane relVelocityDot = prLaneAdd(
+            prLaneMultiply(relVelocityX, vDirectionX),
+            prLaneMultiply(relVelocityY, vDirectionY));
+
+        const prLane biasScalar = prLaneMultiply(
+            biasFactor,
+            prLaneMin(zero,
+                      prLaneAdd(prLaneNegate(prLaneLoad(depths[i])), biasSlop)));
+
+        prLane normalScalar = prLaneMultiply(
+            prLaneAdd(prLaneMultiply(vRestitutionScalars, relVelocityDot),
+                      biasScalar),
+            prLaneLoad(normalMasses[i]));
+
+        normalScalar = prLaneSelect(prLaneLess(normalScalar, zero),
+                                    zero,
+                                    normalScalar);
+
+        prLaneStore(normalScalars[i], normalScalar);
+
+        const prLane normalImpulseX = prLaneMultiply(vDirectionX, normalScalar);
+        const prLane normalImpulseY = prLaneMultiply(vDirectionY, normalScalar);
+
+        for (int j = 0; j < 2; j++)
+            prApplyImpulseToLanes(&vVelocityX[j],
+                                  &vVelocityY[j],
+                                  &vAngularVelocities[j],
+                                  vInverseMasses[j],
+                                  vInverseInertias[j],
+                                  relPositionX[j],
+                                  relPositionY[j],
+                                  (j == 0) ? prLaneNegate(normalImpulseX)
+                                           : normalImpulseX,
+                                  (j == 0) ? prLaneNegate(normalImpulseY)
+                                           : normalImpulseY,
+                                  masks[j]);
+
+        relVelocityX = prLaneSubtract(
+            prLaneAdd(vVelocityX[1],
+                      prLaneMultiply(relNormalX[1], vAngularVelocities[1])),
+            prLaneAdd(vVelocityX[0],
+                      prLaneMultiply(relNormalX[0], vAngularVelocities[0])));
+        relVelocityY = prLaneSubtract(
+            prLaneAdd(vVelocityY[1],
+                      prLaneMultiply(relNormalY[1], vAngularVelocities[1])),
+            prLaneAdd(vVelocityY[0],
+                      prLaneMultiply(relNormalY[0], vAngularVelocities[0])));
+
+        prLane tangentScalar = prLaneMultiply(
+            prLaneNegate(prLaneAdd(prLaneMultiply(relVelocityX, vTangentX),
+                                   prLaneMultiply(relVelocityY, vTangentY))),
+            prLaneLoad(tangentMasses[i]));
+
+        {
+            const prLane maxTangentScalar = prLaneAbs(
+                prLaneMultiply(vFrictions, normalScalar));
+
+            tangentScalar = prLaneMin(prLaneMax(tangentScalar,
+                                                prLaneNegate(maxTangentScalar)),
+                                      maxTangentScalar);
+
+            prLaneStore(tangentScalars[i], tangentScalar);
+        }
+
+        const prLane tangentImpulseX = prLaneMultiply(vTangentX, tangentScalar);
+        const prLane tangentImpulseY = prLaneMultiply(vTangentY, tangentScalar);
+
+        for (int j = 0; j < 2; j++)
+            prApplyImpulseToLanes(&vVelocityX[j],
+                                  &vVelocityY[j],
+                                  &vAngularVelocities[j],
+                                  vInverseMasses[j],
+                                  vInverseInertias[j],
+                                  relPositionX[j],
+                                  relPositionY[j],
+                                  (j == 0) ? prLaneNegate(tangentImpulseX)
+                                           : tangentImpulseX,
+                                  (j == 0) ? prLaneNegate(tangentImpulseY)
+                                           : tangentImpulseY,
+                                  masks[j]);
+    }
+
+    for (int j = 0; j < 2; j++) {
+        prLaneStore(velocityX[j], vVelocityX[j]);
+        prLaneStore(velocityY[j], vVelocityY[j]);
+
+        prLaneStore(angularVelocities[j], vAngularVelocities[j]);
+    }
+
+    for (int l = 0; l < laneCount; l++) {
+        const prContactConstraint *constraint = &constraints[lanes[l]];
+
+        prCollision *ctx = constraint->collision;
+
+        /*
+            NOTE: Like `prResolveCollisionForStorage()`, this stores the impulses
+            of this iteration instead of accumulating them, so that the scalar
+            and the SIMD solvers produce the same results.
+        */
+        for (int i = 0; i < ctx->count; i++) {
+            ctx->contacts[i].cache.normalScalar = normalScalars[i][l];
+            ctx->contacts[i].cache.tangentScalar = tangentScalars[i][l];
+        }
+
+        for (int j = 0; j < 2; j++) {
+            // NOTE: Bodies with infinite mass must not be written to.
+            if (inverseMasses[j][l] <= 0.0f) continue;
+
+            const int index = (j == 0) ? constraint->first : constraint->second;
+
+            bs->velocityX[index] = velocityX[j][l];
+            bs->velocityY[index] = velocityY[j][l];
+
+            bs->angularVelocities[index] = angularVelocities[j][l];
+        }
+    }
+}
+
+/* 
+    Applies an `impulse` at a `point` to the given velocities of a body 
+    in each lane, only if the lane is set in `m`.
+*/
+static PR_API_INLINE void prApplyImpulseToLanes(prLane *velocityX,
+                                                prLane *velocityY,
+                                                prLane *angularVelocity,
+                                                prLane inverseMass,
+                                                prLane inverseInertia,
+                                                prLane pointX,
+                                                prLane pointY,
+                                                prLane impulseX,
+                                                prLane impulseY,
+                                                prLaneMask m) {
+    *velocityX = prLaneSelect(m,
+                              prLaneAdd(*velocityX,
+                                        prLaneMultiply(impulseX, inverseMass)),
+                              *velocityX);
+    *velocityY = prLaneSelect(m,
+                              prLaneAdd(*velocityY,
+                                        prLaneMultiply(impulseY, inverseMass)),
+                              *velocityY);
+
+    *angularVelocity = prLaneSelect(
+        m,
+        prLaneAdd(*angularVelocity,
+                  prLaneMultiply(inverseInertia,
+                                 prLaneSubtract(prLaneMultiply(pointX, impulseY),
+                                                prLaneMultiply(pointY,
+                                                               impulseX)))),
+        *angularVelocity);
+}
+
+/* Returns the lane-wise minimum of `v1` and `v2`, in the same way as `fminf()`. */
+static PR_API_INLINE prLane prLaneMin(prLane v1, prLane v2) {
+    return prLaneSelect(prLaneLess(v2, v1), v2, v1);
+}
+
+/* Returns the lane-wise maximum of `v1` and `v2`, in the same way as `fmaxf()`. */
+static PR_API_INLINE prLane prLaneMax(prLane v1, prLane v2) {
+    return prLaneSelect(prLaneGreater(v2, v1), v2, v1);
+}
+
+    #if defined(PR_SIMD_AVX)
+
+static PR_API_INLINE prLane prLaneSet(float value) {
+    return _mm256_set1_ps(value);
+}
+
+static PR_API_INLINE prLane prLaneLoad(const float *values) {
+    return _mm256_loadu_ps(values);
+}
+
+static PR_API_INLINE void prLaneStore(float *values, prLane v) {
+    _mm256_storeu_ps(values, v);
+}
+
+static PR_API_INLINE prLane prLaneAdd(prLane v1, prLane v2) {
+    return _mm256_add_ps(v1, v2);
+}
+
+static PR_API_INLINE prLane prLaneSubtract(prLane v1, prLane v2) {
+    return _mm256_sub_ps(v1, v2);
+}
+
+static PR_API_INLINE prLane prLaneMultiply(prLane v1, prLane v2) {
+    return _mm256_mul_ps(v1, v2);
+}
+
+static PR_API_INLINE prLane prLaneDivide(prLane v1, prLane v2) {
+    return _mm256_div_ps(v1, v2);
+}
+
+static PR_API_INLINE prLane prLaneNegate(prLane v) {
+    return _mm256_xor_ps(v, _mm256_set1_ps(-0.0f));
+}
+
+static PR_API_INLINE prLane prLaneAbs(prLane v) {
+    return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), v);
+}
+
+static PR_API_INLINE prLane prLaneSqrt(prLane v) {
+    return _mm256_sqrt_ps(v);
+}
+
+static PR_API_INLINE prLaneMask prLaneLess(prLane v1, prLane v2) {
+    return _mm256_cmp_ps(v1, v2, _CMP_LT_OQ);
+}
+
+static PR_API_INLINE prLaneMask prLaneGreater(prLane v1, prLane v2) {
+    return _mm256_cmp_ps(v1, v2, _CMP_GT_OQ);
+}
+
+static PR_API_INLINE prLaneMask prLaneAnd(prLaneMask m1, prLaneMask m2) {
+    return _mm256_and_ps(m1, m2);
+}
+
+static PR_API_INLINE prLane prLaneSelect(prLaneMask m, prLane v1, prLane v2) {
+    return _mm256_blendv_ps(v2, v1, m);
+}
+
+    #elif defined(PR_SIMD_SSE2)
+
+static PR_API_INLINE prLane prLaneSet(float value) {
+    return _mm_set1_ps(value);
+}
+
+static PR_API_INLINE prLane prLaneLoad(const float *values) {
+    return _mm_loadu_ps(values);
+}
+
+static PR_API_INLINE void prLaneStore(float *values, prLane v) {
+    _mm_storeu_ps(values, v);
+}
+
+static PR_API_INLINE prLane prLaneAdd(prLane v1, prLane v2) {
+    return _mm_add_ps(v1, v2);
+}
+
+static PR_API_INLINE prLane prLaneSubtract(prLane v1, prLane v2) {
+    return _mm_sub_ps(v1, v2);
+}
+
+static PR_API_INLINE prLane prLaneMultiply(prLane v1, prLane v2) {
+    return _mm_mul_ps(v1, v2);
+}
+
+static PR_API_INLINE prLane prLaneDivide(prLane v1, prLane v2) {
+    return _mm_div_ps(v1, v2);
+}
+
+static PR_API_INLINE prLane prLaneNegate(prLane v) {
+    return _mm_xor_ps(v, _mm_set1_ps(-0.0f));
+}
+
+static PR_API_INLINE prLane prLaneAbs(prLane v) {
+    return _mm_andnot_ps(_mm_set1_ps(-0.0f), v);
+}
+
+static PR_API_INLINE prLane prLaneSqrt(prLane v) {
+    return _mm_sqrt_ps(v);
+}
+
+static PR_API_INLINE prLaneMask prLaneLess(prLane v1, prLane v2) {
+    return _mm_cmplt_ps(v1, v2);
+}
+
+static PR_API_INLINE prLaneMask prLaneGreater(prLane v1, prLane v2) {
+    return _mm_cmpgt_ps(v1, v2);
+}
+
+static PR_API_INLINE prLaneMask prLaneAnd(prLaneMask m1, prLaneMask m2) {
+    return _mm_and_ps(m1, m2);
+}
+
+static PR_API_INLINE prLane prLaneSelect(prLaneMask m, prLane v1, prLane v2) {
+    return _mm_or_ps(_mm_and_ps(m, v1), _mm_andnot_ps(m, v2));
+}
+
+    #elif defined(PR_SIMD_NEON)
+
+static PR_API_INLINE prLane prLaneSet(float value) {
+    return vdupq_n_f32(value);
+}
+
+static PR_API_INLINE prLane prLaneLoad(const float *values) {
+    return vld1q_f32(values);
+}
+
+static PR_API_INLINE void prLaneStore(float *values, prLane v) {
+    vst1q_f32(values, v);
+}
+
+static PR_API_INLINE prLane prLaneAdd(prLane v1, prLane v2) {
+    return vaddq_f32(v1, v2);
+}
+
+static PR_API_INLINE prLane prLaneSubtract(prLane v1, prLane v2) {
+    return vsubq_f32(v1, v2);
+}
+
+static PR_API_INLINE prLane prLaneMultiply(prLane v1, prLane v2) {
+    return vmulq_f32(v1, v2);
+}
+
+static PR_API_INLINE prLane prLaneDivide(prLane v1, prLane v2) {
+    return vdivq_f32(v1, v2);
+}
+
+static PR_API_INLINE prLane prLaneNegate(prLane v) {
+    return vnegq_f32(v);
+}
+
+static PR_API_INLINE prLane prLaneAbs(prLane v) {
+    return vabsq_f32(v);
+}
+
+static PR_API_INLINE prLane prLaneSqrt(prLane v) {
+    return vsqrtq_f32(v);
+}
+
+static PR_API_INLINE prLaneMask prLaneLess(prLane v1, prLane v2) {
+    return vcltq_f32(v1, v2);
+}
+
+static PR_API_INLINE prLaneMask prLaneGreater(prLane v1, prLane v2) {
+    return vcgtq_f32(v1, v2);
+}
+
+static PR_API_INLINE prLaneMask prLaneAnd(prLaneMask m1, prLaneMask m2) {
+    return vandq_u32(m1, m2);
+}
+
+static PR_API_INLINE prLane prLaneSelect(prLaneMask m, prLane v1, prLane v2) {
+    return vbslq_f32(m, v1, v2);
+}
+
+    #elif defined(PR_SIMD_WASM)
+
+static PR_API_INLINE prLane prLaneSet(float value) {
+    return wasm_f32x4_splat(value);
+}
+
+static PR_API_INLINE prLane prLaneLoad(const float *values) {
+    return wasm_v128_load(values);
+}
+
+static PR_API_INLINE void prLaneStore(float *values, prLane v) {
+    wasm_v128_store(values, v);
+}
+
+static PR_API_INLINE prLane prLaneAdd(prLane v1, prLane v2) {
+    return wasm_f32x4_add(v1, v2);
+}
+
+static PR_API_INLINE prLane prLaneSubtract(prLane v1, prLane v2) {
+    return wasm_f32x4_sub(v1, v2);
+}
+
+static PR_API_INLINE prLane prLaneMultiply(prLane v1, prLane v2) {
+    return wasm_f32x4_mul(v1, v2);
+}
+
+static PR_API_INLINE prLane prLaneDivide(prLane v1, prLane v2) {
+    return wasm_f32x4_div(v1, v2);
+}
+
+static PR_API_INLINE prLane prLaneNegate(prLane v) {
+    return wasm_f32x4_neg(v);
+}
+
+static PR_API_INLINE prLane prLaneAbs(prLane v) {
+    return wasm_f32x4_abs(v);
+}
+
+static PR_API_INLINE prLane prLaneSqrt(prLane v) {
+    return wasm_f32x4_sqrt(v);
+}
+
+static PR_API_INLINE prLaneMask prLaneLess(prLane v1, prLane v2) {
+    return wasm_f32x4_lt(v1, v2);
+}
+
+static PR_API_INLINE prLaneMask prLaneGreater(prLane v1, prLane v2) {
+    return wasm_f32x4_gt(v1, v2);
+}
+
+static PR_API_INLINE prLaneMask prLaneAnd(prLaneMask m1, prLaneMask m2) {
+    return wasm_v128_and(m1, m2);
+}
+
+static PR_API_INLINE prLane prLaneSelect(prLaneMask m, prLane v1, prLane v2) {
+    return wasm_v128_bitselect(v1, v2, m);
+}
+
+    #endif
+
+#endif
@@ -0,0 +1,442 @@
+/*
+    Copyright (c) 2023 Warren Galyen <wgalyen@mechanikadesign.com>
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+/* Includes ============================================================================= */
+
+#include "proxima.h"
+
+#ifndef PR_DISABLE_THREADS
+    #if defined(_WIN32)
+        #define NOGDI
+        #define NOUSER
+
+        #define WIN32_LEAN_AND_MEAN
+        #include <windows.h>
+    #else
+        #include <pthread.h>
+    #endif
+#endif
+
+/* Macros =============================================================================== */
+
+// clang-format off
+
+/* Defines the minimum number of elements in a batch. */
+#define PR_THREAD_POOL_MIN_BATCH_SIZE  16
+
+/* Defines the number of batches for each thread in a thread pool. */
+#define PR_THREAD_POOL_BATCH_PER_THREAD  4
+
+// clang-format on
+
+/* Typedefs ============================================================================= */
+
+#ifndef PR_DISABLE_THREADS
+    #if defined(_WIN32)
+typedef HANDLE prThread;
+typedef CRITICAL_SECTION prMutex;
+typedef CONDITION_VARIABLE prCondition;
+    #else
+typedef pthread_t prThread;
+typedef pthread_mutex_t prMutex;
+typedef pthread_cond_t prCondition;
+    #endif
+#endif
+
+/* A structure that represents the context data of a worker thread. */
+typedef struct _prWorkerCtx {
+    prThreadPool *pool;
+    int threadIndex;
+} prWorkerCtx;
+
+/* A structure that represents a pool of worker threads. */
+struct _prThreadPool {
+    int threadCount;
+#ifndef PR_DISABLE_THREADS
+    prThread *threads;
+    prWorkerCtx *workerCtxs;
+    prMutex mutex;
+    prCondition workCondition, doneCondition;
+#endif
+    struct {
+        prThreadPoolFunc func;
+        void *ctx;
+        const prAllocator *allocator;
+        int count, batchSize;
+        int nextIndex;
+    } job;
+    int activeCount;
+    uint32_t generation;
+    size_t allocationCount;
+    bool running;
+};
+
+/* Private Function Prototypes ========================================================== */
+
+#ifndef PR_DISABLE_THREADS
+
+/* Runs the batches of the current job of `tp` on the thread with `threadIndex`. */
+static void prRunThreadPoolBatches(prThreadPool *tp, int threadIndex);
+
+/* Waits for a new job, then runs its batches on a worker thread. */
+static void prRunWorkerThread(prWorkerCtx *ctx);
+
+/* Platform-specific wrappers for threads and synchronization primitives. */
+static bool prCreateThread(prThread *thread, prWorkerCtx *ctx);
+static void prJoinThread(prThread thread);
+
+static void prInitMutex(prMutex *mutex);
+static void prDeinitMutex(prMutex *mutex);
+static void prLockMutex(prMutex *mutex);
+static void prUnlockMutex(prMutex *mutex);
+
+static void prInitCondition(prCondition *condition);
+static void prDeinitCondition(prCondition *condition);
+static void prWaitCondition(prCondition *condition, prMutex *mutex);
+static void prBroadcastCondition(prCondition *condition);
+
+#endif
+
+/* Public Functions ===================================================================== */
+
+/*
+    Creates a new thread pool with `threadCount` threads,
+    including the thread that will call `prRunThreadPool()`.
+*/
+prThreadPool *prCreateThreadPool(int threadCount) {
+    if (threadCount <= 0) return NULL;
+
+    prThreadPool *tp = prAllocateMemory(sizeof *tp);
+
+    tp->threadCount = 1;
+
+#ifndef PR_DISABLE_THREADS
+    if (threadCount <= 1) return tp;
+
+    prInitMutex(&tp->mutex);
+
+    prInitCondition(&tp->workCondition);
+    prInitCondition(&tp->doneCondition);
+
+    tp->threads = prAllocateMemory((threadCount - 1) * sizeof *(tp->threads));
+    tp->workerCtxs = prAllocateMemory((threadCount - 1)
+                                      * sizeof *(tp->workerCtxs));
+
+    tp->running = true;
+
+    for (int i = 0; i < threadCount - 1; i++) {
+        tp->workerCtxs[i] = (prWorkerCtx) { .pool = tp, .threadIndex = i + 1 };
+
+        // NOTE: Falls back to fewer threads if the system refuses to create more.
+        if (!prCreateThread(&tp->threads[i], &tp->workerCtxs[i])) break;
+
+        tp->threadCount++;
+    }
+#endif
+
+    return tp;
+}
+
+/* Releases the memory allocated for `tp`, after stopping all of its threads. */
+void prReleaseThreadPool(prThreadPool *tp) {
+    if (tp == NULL) return;
+
+#ifndef PR_DISABLE_THREADS
+    if (tp->threads != NULL) {
+        prLockMutex(&tp->mutex);
+
+        tp->running = false;
+
+        prBroadcastCondition(&tp->workCondition);
+
+        prUnlockMutex(&tp->mutex);
+
+        for (int i = 0; i < tp->threadCount - 1; i++)
+            prJoinThread(tp->threads[i]);
+
+        prDeinitCondition(&tp->doneCondition);
+        prDeinitCondition(&tp->workCondition);
+
+        prDeinitMutex(&tp->mutex);
+
+        prReleaseMemory(tp->threads), prReleaseMemory(tp->workerCtxs);
+    }
+#endif
+
+    prReleaseMemory(tp);
+}
+
+/* Returns the number of threads in `tp`. */
+int prGetThreadPoolThreadCount(const prThreadPool *tp) {
+    return (tp != NULL) ? tp->threadCount : 1;
+}
+
+/* 
+    Returns the number of blocks allocated (or resized) by the worker threads 
+    of `tp` so far, or `0` if `PR_DISABLE_STATS` is defined.
+*/
+size_t prGetThreadPoolAllocationCount(const prThreadPool *tp) {
+    // NOTE: The worker threads only update this while `tp` is running a job.
+    return (tp != NULL) ? tp->allocationCount : 0;
+}
+
+/*
+    Splits the range `[0, count)` into batches, then calls `func` for each batch
+    on the threads of `tp` (including the calling thread) and waits for all of them.
+*/
+void prRunThreadPool(prThreadPool *tp,
+                     int count,
+                     prThreadPoolFunc func,
+                     void *ctx) {
+    prRunThreadPoolWithBatchSize(tp,
+                                 count,
+                                 PR_THREAD_POOL_MIN_BATCH_SIZE,
+                                 func,
+                                 ctx);
+}
+
+/*
+    Splits the range `[0, count)` into batches of at least `minBatchSize` elements, 
+    then calls `func` for each batch on the threads of `tp` 
+    (including the calling thread) and waits for all of them.
+*/
+void prRunThreadPoolWithBatchSize(prThreadPool *tp,
+                                  int count,
+                                  int minBatchSize,
+                                  prThreadPoolFunc func,
+                                  void *ctx) {
+    if (count <= 0 || func == NULL) return;
+
+    int batchSize = (minBatchSize > 0) ? minBatchSize : 1;
+
+    if (tp != NULL) {
+        const int batchCount = tp->threadCount
+                               * PR_THREAD_POOL_BATCH_PER_THREAD;
+
+        if (batchSize < count / batchCount) batchSize = count / batchCount;
+    }
+
+    // NOTE: Small jobs are not worth waking up the worker threads.
+    if (tp == NULL || tp->threadCount <= 1 || count <= batchSize) {
+        func(0, count, 0, ctx);
+
+        return;
+    }
+
+#ifndef PR_DISABLE_THREADS
+    prLockMutex(&tp->mutex);
+
+    tp->job.func = func, tp->job.ctx = ctx;
+
+    // NOTE: The worker threads allocate new memory just like the calling thread.
+    tp->job.allocator = prGetCurrentAllocator();
+    tp->job.count = count, tp->job.batchSize = batchSize;
+    tp->job.nextIndex = 0;
+
+    tp->activeCount = tp->threadCount - 1;
+    tp->generation++;
+
+    prBroadcastCondition(&tp->workCondition);
+
+    prUnlockMutex(&tp->mutex);
+
+    prRunThreadPoolBatches(tp, 0);
+
+    prLockMutex(&tp->mutex);
+
+    while (tp->activeCount > 0)
+        prWaitCondition(&tp->doneCondition, &tp->mutex);
+
+    prUnlockMutex(&tp->mutex);
+#endif
+}
+
+/* Private Functions ==================================================================== */
+
+#ifndef PR_DISABLE_THREADS
+
+/* Runs the batches of the current job of `tp` on the thread with `threadIndex`. */
+static void prRunThreadPoolBatches(prThreadPool *tp, int threadIndex) {
+    for (;;) {
+        prLockMutex(&tp->mutex);
+
+        const int start = tp->job.nextIndex;
+
+        tp->job.nextIndex += tp->job.batchSize;
+
+        prUnlockMutex(&tp->mutex);
+
+        if (start >= tp->job.count) break;
+
+        const int end = (start + tp->job.batchSize < tp->job.count)
+                            ? start + tp->job.batchSize
+                            : tp->job.count;
+
+        tp->job.func(start, end, threadIndex, tp->job.ctx);
+    }
+}
+
+/* Waits for a new job, then runs its batches on a worker thread. */
+static void prRunWorkerThread(prWorkerCtx *ctx) {
+    prThreadPool *tp = ctx->pool;
+
+    uint32_t generation = 0;
+
+    prLockMutex(&tp->mutex);
+
+    for (;;) {
+        while (tp->running && tp->generation == generation)
+            prWaitCondition(&tp->workCondition, &tp->mutex);
+
+        if (!tp->running) break;
+
+        generation = tp->generation;
+
+        prUnlockMutex(&tp->mutex);
+
+        size_t allocationCount = 0;
+
+        PR_API_STATS(allocationCount = prGetAllocationCount());
+
+        prSetCurrentAllocator(tp->job.allocator);
+
+        prRunThreadPoolBatches(tp, ctx->threadIndex);
+
+        prSetCurrentAllocator(NULL);
+
+        prLockMutex(&tp->mutex);
+
+        PR_API_STATS(tp->allocationCount += prGetAllocationCount()
+                                            - allocationCount);
+
+        if (--tp->activeCount == 0) prBroadcastCondition(&tp->doneCondition);
+    }
+
+    prUnlockMutex(&tp->mutex);
+
+    // NOTE: The bodies and the shapes created by the jobs may outlive this thread.
+    prTrimPools();
+}
+
+    #if defined(_WIN32)
+
+static DWORD WINAPI prWorkerThreadProc(LPVOID ctx) {
+    prRunWorkerThread(ctx);
+
+    return 0;
+}
+
+static bool prCreateThread(prThread *thread, prWorkerCtx *ctx) {
+    *thread = CreateThread(NULL, 0, prWorkerThreadProc, ctx, 0, NULL);
+
+    return (*thread != NULL);
+}
+
+static void prJoinThread(prThread thread) {
+    WaitForSingleObject(thread, INFINITE);
+
+    CloseHandle(thread);
+}
+
+static void prInitMutex(prMutex *mutex) {
+    InitializeCriticalSection(mutex);
+}
+
+static void prDeinitMutex(prMutex *mutex) {
+    DeleteCriticalSection(mutex);
+}
+
+static void prLockMutex(prMutex *mutex) {
+    EnterCriticalSection(mutex);
+}
+
+static void prUnlockMutex(prMutex *mutex) {
+    LeaveCriticalSection(mutex);
+}
+
+static void prInitCondition(prCondition *condition) {
+    InitializeConditionVariable(condition);
+}
+
+static void prDeinitCondition(prCondition *condition) {
+    // NOTE: Condition variables do not need to be deleted on Windows.
+}
+
+static void prWaitCondition(prCondition *condition, prMutex *mutex) {
+    SleepConditionVariableCS(condition, mutex, INFINITE);
+}
+
+static void prBroadcastCondition(prCondition *condition) {
+    WakeAllConditionVariable(condition);
+}
+
+    #else
+
+static void *prWorkerThreadProc(void *ctx) {
+    prRunWorkerThread(ctx);
+
+    return NULL;
+}
+
+static bool prCreateThread(prThread *thread, prWorkerCtx *ctx) {
+    return (pthread_create(thread, NULL, prWorkerThreadProc, ctx) == 0);
+}
+
+static void prJoinThread(prThread thread) {
+    pthread_join(thread, NULL);
+}
+
+static void prInitMutex(prMutex *mutex) {
+    pthread_mutex_init(mutex, NULL);
+}
+
+static void prDeinitMutex(prMutex *mutex) {
+    pthread_mutex_destroy(mutex);
+}
+
+static void prLockMutex(prMutex *mutex) {
+    pthread_mutex_lock(mutex);
+}
+
+static void prUnlockMutex(prMutex *mutex) {
+    pthread_mutex_unlock(mutex);
+}
+
+static void prInitCondition(prCondition *condition) {
+    pthread_cond_init(condition, NULL);
+}
+
+static void prDeinitCondition(prCondition *condition) {
+    pthread_cond_destroy(condition);
+}
+
+static void prWaitCondition(prCondition *condition, prMutex *mutex) {
+    pthread_cond_wait(condition, mutex);
+}
+
+static void prBroadcastCondition(prCondition *condition) {
+    pthread_cond_broadcast(condition);
+}
+
+    #endif
+
+#endif
@@ -32,19 +32,72 @@
 
 #include "proxima.h"
 
+#ifndef PR_DISABLE_THREADS
+    #if !defined(_WIN32)
+        #include <pthread.h>
+    #endif
+#endif
+
 /* Private Variables ==================================================================== */
 
+#ifndef PR_DISABLE_THREADS
+    #if defined(_WIN32)
+static INIT_ONCE setupOnce = INIT_ONCE_STATIC_INIT;
+    #else
+static pthread_once_t setupOnce = PTHREAD_ONCE_INIT;
+    #endif
+#else
 static bool initialized = false;
+#endif
+
+/* Private Function Prototypes ========================================================== */
+
+/* 
+    Initializes the monotonic clock exactly once.
+    (This function is thread-safe unless `PR_DISABLE_THREADS` is defined.)
+*/
+static void prSetupTimer(void);
 
 /* Public Functions ===================================================================== */
 
 /* Returns the current time of the monotonic clock, in seconds. */
 double prGetCurrentTime(void) {
-    if (!initialized) {
-        initialized = true;
-
-        stm_setup();
-    }
+    prSetupTimer();
 
     return stm_sec(stm_now());
-}
\ No newline at end of file
+}
+
+/* Private Functions ==================================================================== */
+
+#ifndef PR_DISABLE_THREADS
+    #if defined(_WIN32)
+
+static BOOL CALLBACK prSetupTimerOnce(PINIT_ONCE once, PVOID param, PVOID *ctx) {
+    stm_setup();
+
+    return TRUE;
+}
+
+static void prSetupTimer(void) {
+    InitOnceExecuteOnce(&setupOnce, prSetupTimerOnce, NULL, NULL);
+}
+
+    #else
+
+static void prSetupTimer(void) {
+    pthread_once(&setupOnce, stm_setup);
+}
+
+    #endif
+#else
+
+static void prSetupTimer(void) {
+    // NOTE: Without any threads, a plain flag is enough to skip the initialization.
+    if (initialized) return;
+
+    initialized = true;
+
+    stm_setup();
+}
+
+#endif
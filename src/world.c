@@ -22,27 +22,136 @@
 
 /* Includes ============================================================================= */
 
-/* NOTE: `STB_DS_IMPLEMENTATION` is already defined in 'broad-phase.c' */
-#include "external/stb_ds.h"
+#include <float.h>
+#include <string.h>
 
 #include "proxima.h"
 
+// NOTE: All arrays and hash maps are allocated with the current allocator.
+#define STBDS_REALLOC(context, ptr, size) prReallocateMemory(ptr, size)
+#define STBDS_FREE(context, ptr)          prReleaseMemory(ptr)
+
+/* NOTE: `STB_DS_IMPLEMENTATION` is already defined in 'broad-phase.c' */
+#include "external/stb_ds.h"
+
 /* Typedefs ============================================================================= */
 
-/* A structure that represents the key-value pair of the contact cache. */
-typedef struct _prContactCacheEntry {
-    prBodyPair key;
-    prCollision value;
-} prContactCacheEntry;
+/* 
+    A structure that represents the contact between two bodies in a contact table,
+    along the line segment at `child` if either body is a 'chain' body.
+*/
+typedef struct _prContactEntry {
+    int first, second, child;
+    uint32_t generation;
+    prCollision collision;
+} prContactEntry;
+
+/* A structure that represents a slot of a contact table. */
+typedef struct _prContactSlot {
+    uint64_t key;
+    int index, child;
+} prContactSlot;
+
+/* 
+    A structure that represents an open-addressed hash table of contacts,
+    keyed by the indexes of the bodies (and the child) in each contact.
+*/
+typedef struct _prContactTable {
+    prContactEntry *entries, *newEntries;
+    prContactSlot *slots;
+    uint32_t generation;
+} prContactTable;
+
+/* 
+    A structure that represents the separating axis of two polygons 
+    found in the last narrow phase, keyed by the indexes of their bodies.
+*/
+typedef struct _prSeparatingAxisEntry {
+    uint64_t key;
+    int axis;
+} prSeparatingAxisEntry;
+
+/* 
+    A structure that represents a pair of bodies whose enlarged AABBs 
+    overlap in a dynamic tree.
+*/
+typedef struct _prTreePair {
+    int first, second;
+} prTreePair;
+
+/* A structure that represents a pair of bodies found in the broad phase. */
+typedef struct _prCandidatePair {
+    int first, second, child;
+    int axis;
+    bool sensor, colliding;
+    prCollision collision;
+} prCandidatePair;
+
+/* A structure that represents the contact islands of a world. */
+typedef struct _prContactIslands {
+    int *parents, *roots;
+    int *indexes, *offsets, *contacts;
+    float *sleepTimes;
+    int count;
+} prContactIslands;
 
 /* A structure that represents a simulation container. */
 struct _prWorld {
+    prAllocator allocator;
     prVector2 gravity;
+    prBroadPhaseType broadPhase;
     prBody **bodies;
+    int *chains;
+    struct {
+        uint32_t *generations;
+        int *dense, *sparse;
+        int *freeIndexes, *removedIndexes;
+    } slots;
     prSpatialHash *hash;
-    prContactCacheEntry *cache;
+    prDynamicTree *tree;
+    bool broadPhaseDirty;
+    struct {
+        prTreePair *pairs;
+        int *moveBuffer;
+        bool *moved;
+    } treePairs;
+    prBodyStorage storage;
+    prContactTable contacts;
+    prSeparatingAxisEntry *separatingAxes;
+    struct {
+        prContactTable overlaps;
+        prBodyPair *beginEvents, *endEvents;
+    } sensors;
+    struct {
+        prContactInfo *contacts;
+        prBodyHandle *handles;
+        prTransform *transforms;
+        bool contactsDirty, transformsDirty;
+    } exports;
+    prContactConstraint *constraints;
+    prCandidatePair *pairs;
+    prThreadPool *pool;
+    prSolverBuffer *solverBuffers;
+    struct {
+        int iterationCount;
+        float tolerance;
+        int *iterationCounts;
+    } solver;
+    prContactIslands islands;
+    int threadCount;
+    bool deterministic;
+    struct {
+        bool enabled;
+        float linearThreshold, angularThreshold;
+        float timeToSleep;
+    } sleeping;
     prCollisionHandler handler;
-    double accumulator, timestamp;
+    prWorldStats stats;
+    struct {
+        double accumulator, timestamp;
+        int maxStepCount, subStepCount;
+        float alpha;
+    } update;
 };
 
 /* A structure that represents the context data for `prPreStepHashQueryCallback()`. */
@@ -51,333 +160,3993 @@ typedef struct _prPreStepHashQueryCtx {
     int bodyIndex;
 } prPreStepHashQueryCtx;
 
+/* A structure that represents the context data for `prPreStepChainQueryCallback()`. */
+typedef struct _prPreStepChainQueryCtx {
+    prWorld *world;
+    int bodyIndex, chainIndex;
+    int childIndex, segmentCount;
+} prPreStepChainQueryCtx;
+
+/* A structure that represents the context data for `prSolveContactIslands()`. */
+typedef struct _prSolveIslandsCtx {
+    prWorld *world;
+    int iterationCount;
+    float inverseDt;
+} prSolveIslandsCtx;
+
+/* A structure that represents the context data for `prStepWorldsCallback()`. */
+typedef struct _prStepWorldsCtx {
+    prWorld **worlds;
+    float dt;
+} prStepWorldsCtx;
+
 /* A structure that represents the context data for `prRaycastHashQueryCallback()`. */
 typedef struct _prRaycastHashQueryCtx {
     prRay ray;
     prWorld *world;
     prRaycastQueryFunc func;
+    prRaycastMode mode;
+    prRaycastHit hit;
 } prRaycastHashQueryCtx;
 
-/* Private Function Prototypes ========================================================== */
+/* 
+    A structure that represents the context data for `prAABBHashQueryCallback()`
+    and `prPointHashQueryCallback()`.
+*/
+typedef struct _prBodyHashQueryCtx {
+    prWorld *world;
+    prAABB aabb;
+    prVector2 point;
+    prBody **bodies;
+    int capacity, count;
+} prBodyHashQueryCtx;
+
+/* A structure that represents the context data for `prShapeCastHashQueryCallback()`. */
+typedef struct _prShapeCastHashQueryCtx {
+    prWorld *world;
+    const prShape *shape;
+    prTransform tx;
+    prAABB aabb;
+    prVector2 translation;
+    const prBody *ignoredBody;
+    bool ignoresOverlaps;
+    prShapeCastHit *hits;
+    int capacity, count;
+} prShapeCastHashQueryCtx;
 
 /* 
-    A callback function for `prQuerySpatialHash()` 
-    that will be called during `prPreStepWorld()`. 
+    A structure that represents a convex piece of a collision shape in a shape cast,
+    which is a circle (a single vertex with a radius), a polygon or a line segment.
 */
-static bool prPreStepHashQueryCallback(int otherIndex, void *ctx);
+typedef struct _prShapeCastPiece {
+    prVertices vertices;
+    float radius;
+} prShapeCastPiece;
+
+/* A structure that represents the context data for `prShapeCastChainQueryCallback()`. */
+typedef struct _prShapeCastAdvanceCtx {
+    const prShape *shape;
+    prTransform tx;
+    const prShapeCastPiece *piece;
+    prVector2 translation;
+    float tolerance, advance;
+} prShapeCastAdvanceCtx;
 
 /* 
-    A callback function for `prQuerySpatialHash()` 
-    that will be called during `prComputeRaycastForWorld()`.
+    A structure that represents the header of a saved world state,
+    whose reserved fields fill the padding so that every byte of it is written.
 */
-static bool prRaycastHashQueryCallback(int bodyIndex, void *ctx);
+typedef struct _prWorldStateHeader {
+    uint32_t magic;
+    uint16_t version, flags;
+    uint32_t bodyCount, contactCount, overlapCount;
+    uint32_t contactGeneration, overlapGeneration;
+    uint32_t reserved1;
+    double accumulator;
+    float alpha;
+    uint32_t reserved2;
+} prWorldStateHeader;
 
-/* Finds all pairs of bodies in `w` that are colliding. */
-static void prPreStepWorld(prWorld *w);
+/* A structure that represents the state of a body in a saved world state. */
+typedef struct _prWorldStateBody {
+    uint32_t index, generation;
+    prBodyState state;
+} prWorldStateBody;
+
+/* Constants ============================================================================ */
+
+/* The minimum number of slots in a contact table. */
+static const int CONTACT_TABLE_MIN_SLOT_COUNT = 64;
+
+/* The multiplier for hashing the keys of a contact table (Fibonacci hashing). */
+static const uint64_t CONTACT_TABLE_HASH_MULTIPLIER = 0x9E3779B97F4A7C15ULL;
+
+/* The number of bisection steps for finding the time of impact of a shape cast. */
+static const int SHAPE_CAST_ITERATION_COUNT = 16;
+
+/* The maximum number of conservative advancement steps of a shape cast. */
+static const int SHAPE_CAST_MAX_ADVANCE_COUNT = 64;
+
+/* The maximum number of fixed-step samples of a shape cast. */
+static const int SHAPE_CAST_MAX_SAMPLE_COUNT = 1024;
+
+/* The maximum number of sub-steps for each bullet at its times of impact. */
+static const int BULLET_MAX_SUBSTEP_COUNT = 4;
+
+/* The magic number ('PRWS') at the start of a saved world state. */
+static const uint32_t WORLD_STATE_MAGIC = 0x53575250u;
+
+/* The version of the format of a saved world state. */
+static const uint16_t WORLD_STATE_VERSION = 3u;
+
+/* The flag of a saved world state that only has the bodies changed from its base. */
+static const uint16_t WORLD_STATE_FLAG_DELTA = 1u;
+
+/* Private Function Prototypes ========================================================== */
+
+/* Returns the key of the contact between the bodies at `first` and `second`. */
+static PR_API_INLINE uint64_t prGetContactKey(int first, int second);
+
+/* Returns the hash of the contact with the given `key` and `child`. */
+static PR_API_INLINE uint64_t prGetContactHash(uint64_t key, int child);
 
 /* 
-    Clears the accumulated forces on each body in `w`, 
-    then clears the spatial hash of `w`. 
+    Returns the index of the contact between the bodies at `first` and `second`
+    (along the line segment at `child`) in the entries of `ct`, 
+    or `-1` if there is no such contact.
 */
-static void prPostStepWorld(prWorld *w);
+static int prFindContact(const prContactTable *ct,
+                         int first,
+                         int second,
+                         int child);
 
-/* Public Functions ===================================================================== */
+/* Inserts a new contact `entry` to `ct`. */
+static void prInsertContact(prContactTable *ct, prContactEntry entry);
 
 /* 
-    Creates a world with the `gravity` vector and `cellSize` 
-    for broad-phase collision detection.
+    Inserts the new contacts of `ct` to `ct` in the order of 
+    the indexes of their bodies (and their children).
 */
-prWorld *prCreateWorld(prVector2 gravity, float cellSize) {
-    prWorld *result = calloc(1, sizeof *result);
+static void prInsertNewContacts(prContactTable *ct);
 
-    result->gravity = gravity;
-    result->hash = prCreateSpatialHash(cellSize);
+/* Compares the indexes of the bodies (and the children) of two contacts. */
+static int prCompareContactEntries(const void *p1, const void *p2);
 
-    arrsetcap(result->bodies, PR_WORLD_MAX_OBJECT_COUNT);
+/* Puts the contact at `index` in the entries of `ct` into an empty slot of `ct`. */
+static void prPutContactSlot(prContactTable *ct, int index);
 
-    return result;
-}
+/* Rebuilds the slots of `ct` from its entries, skipping the removed contacts. */
+static void prRebuildContactTable(prContactTable *ct);
 
-/* Release the memory allocated for `w`. */
-void prReleaseWorld(prWorld *w) {
-    if (w == NULL) return;
+/* 
+    Removes all contacts that were not found (or kept) in the current generation 
+    of `ct`, without changing the order of the remaining contacts.
+*/
+static void prSweepContactTable(prContactTable *ct);
 
-    for (int i = 0; i < arrlen(w->bodies); i++)
-        prReleaseBody(w->bodies[i]);
+/* Erases all contacts from `ct`. */
+static void prClearContactTable(prContactTable *ct);
 
-    prReleaseSpatialHash(w->hash);
+/* Releases the memory allocated for the arrays of `ct`. */
+static void prReleaseContactTable(prContactTable *ct);
 
-    arrfree(w->bodies), hmfree(w->cache);
+/* 
+    Makes room for the separating axes of `pairCount` pairs of bodies in `w`,
+    forgetting all separating axes of `w` if it has to grow.
+*/
+static void prReserveSeparatingAxes(prWorld *w, int pairCount);
 
-    free(w);
-}
+/* 
+    Returns the index of the entry for the separating axis of 
+    the bodies at `first` and `second` in `w`.
+*/
+static PR_API_INLINE int prGetSeparatingAxisIndex(const prWorld *w,
+                                                  int first,
+                                                  int second);
 
-/* Erases all rigid bodies from `w`. */
-void prClearWorld(prWorld *w) {
-    if (w == NULL) return;
+/* Returns `true` if any body of the contact `entry` was removed from `w`. */
+static PR_API_INLINE bool prIsContactRemoved(const prWorld *w,
+                                             const prContactEntry *entry);
 
-    prClearSpatialHash(w->hash);
+/* Calls `func` for each contact in `w` whose bodies are still in `w`. */
+static void prRunWorldCollisionEvents(prWorld *w, prCollisionEventFunc func);
 
-    arrsetlen(w->bodies, 0);
-}
+/* 
+    A callback function for `prQuerySpatialHashPairs()` 
+    that will be called during `prPreStepWorld()`. 
+*/
+static bool prPreStepHashPairQueryCallback(int firstIndex,
+                                           int secondIndex,
+                                           void *ctx);
 
-/* Adds a rigid body to `w`. */
-bool prAddBodyToWorld(prWorld *w, prBody *b) {
-    if (w == NULL || b == NULL
-        || arrlen(w->bodies) >= PR_WORLD_MAX_OBJECT_COUNT)
-        return false;
+/* 
+    Adds the pair of the bodies at `first` and `second` in `w` 
+    (along the line segment at `child`) to the candidate pairs of `w`, 
+    unless they cannot collide.
+*/
+static bool prAddCandidatePair(prWorld *w, int first, int second, int child);
 
-    arrput(w->bodies, b);
+/* 
+    Adds each pair of the children of the bodies at `first` and `second` in `w`
+    whose AABBs overlap to the candidate pairs of `w`, assuming either body
+    is a 'compound' body.
+*/
+static bool prAddCompoundPairs(prWorld *w, int first, int second);
 
-    return true;
-}
+/* 
+    A callback function for `prQueryDynamicTree()` 
+    that will be called during `prPreStepWorld()`. 
+*/
+static bool prPreStepHashQueryCallback(int otherIndex, void *ctx);
 
-/* Removes a rigid body from `w`. */
-bool prRemoveBodyFromWorld(prWorld *w, prBody *b) {
-    if (w == NULL || b == NULL) return false;
+/* 
+    A callback function for `prQueryChain()` 
+    that will be called during `prPreStepWorld()`. 
+*/
+static bool prPreStepChainQueryCallback(int segmentIndex, void *ctx);
 
-    for (int i = 0; i < arrlen(w->bodies); i++) {
-        if (w->bodies[i] == b) {
-            // NOTE: `O(1)` performance!
-            arrdelswap(w->bodies, i);
+/* 
+    Adds each line segment of the 'chain' body at `chainIndex` in `w` 
+    that the AABB of the awake body at `bodyIndex` overlaps
+    to the candidate pairs of `w`.
+*/
+static void prAddChainPairs(prWorld *w, int bodyIndex, int chainIndex);
 
-            return true;
-        }
-    }
+/* Compares the indexes of the bodies (and the children) of two candidate pairs. */
+static int prCompareCandidatePairs(const void *p1, const void *p2);
 
-    return false;
-}
+/* 
+    A callback function for `prRaycastSpatialHash()` and `prRaycastDynamicTree()`
+    that will be called during `prComputeRaycastForWorld()`
+    and `prComputeRaycastsForWorld()`.
+*/
+static float prRaycastHashQueryCallback(int bodyIndex, void *ctx);
 
-/* Returns a rigid body with the given `index` from `w`. */
-prBody *prGetBodyFromWorld(const prWorld *w, int index) {
-    if (w == NULL || index < 0 || index >= arrlen(w->bodies)) return NULL;
+/* Casts `queryCtx->ray` against the broad-phase data structure of `w`. */
+static void prRaycastWorldBroadPhase(prWorld *w,
+                                     prRaycastHashQueryCtx *queryCtx);
 
-    return w->bodies[index];
-}
+/* 
+    A callback function for `prQuerySpatialHash()` and `prQueryDynamicTree()`
+    that will be called during `prQueryWorldAABB()`.
+*/
+static bool prAABBHashQueryCallback(int bodyIndex, void *ctx);
 
-/* Returns the number of rigid bodies in `w`. */
-int prGetBodyCountForWorld(const prWorld *w) {
-    return (w != NULL) ? arrlen(w->bodies) : 0;
-}
+/* 
+    A callback function for `prQuerySpatialHash()` and `prQueryDynamicTree()`
+    that will be called during `prQueryWorldPoint()`.
+*/
+static bool prPointHashQueryCallback(int bodyIndex, void *ctx);
 
-/* Returns the gravity acceleration vector of `w`. */
-prVector2 prGetWorldGravity(const prWorld *w) {
-    return (w != NULL) ? w->gravity : PR_API_STRUCT_ZERO(prVector2);
-}
+/* 
+    A callback function for `prQuerySpatialHash()` and `prQueryDynamicTree()`
+    that will be called during `prComputeShapeCastForWorld()`.
+*/
+static bool prShapeCastHashQueryCallback(int bodyIndex, void *ctx);
 
-/* Sets the collision event `handler` of `w`. */
-void prSetWorldCollisionHandler(prWorld *w, prCollisionHandler handler) {
-    if (w != NULL) w->handler = handler;
-}
+/* 
+    Sweeps the shape of `queryCtx` against `b`, then stores 
+    the earliest hit to `hit` (if any).
+*/
+static bool prComputeShapeCast(const prShapeCastHashQueryCtx *queryCtx,
+                               prBody *b,
+                               prShapeCastHit *hit);
 
-/* Sets the `gravity` acceleration vector of `w`. */
-void prSetWorldGravity(prWorld *w, prVector2 gravity) {
-    if (w != NULL) w->gravity = gravity;
-}
+/* 
+    Moves the shape of `queryCtx` to `fraction` along its translation, 
+    then stores the collision between the shape and `s` with the transform `tx`
+    to `collision` (if any).
+*/
+static bool prComputeShapeCastSample(const prShapeCastHashQueryCtx *queryCtx,
+                                     const prShape *s,
+                                     prTransform tx,
+                                     float fraction,
+                                     prCollision *collision);
 
-/* Proceeds the simulation over the time step `dt`, in seconds. */
-void prStepWorld(prWorld *w, float dt) {
-    if (w == NULL || dt <= 0.0f) return;
+/* 
+    Returns how far (as a fraction of its translation) the shape of `queryCtx` 
+    at `fraction` can move towards `s` with the transform `tx` without penetrating
+    `s` deeper than `tolerance`, or `FLT_MAX` if it does not move towards `s`.
+*/
+static float prComputeShapeCastAdvance(const prShapeCastHashQueryCtx *queryCtx,
+                                       const prShape *s,
+                                       prTransform tx,
+                                       float fraction,
+                                       float maxFraction,
+                                       float tolerance);
 
-    prPreStepWorld(w);
+/* 
+    A callback function for `prQueryChain()`
+    that will be called during `prComputeShapeCastAdvance()`.
+*/
+static bool prShapeCastChainQueryCallback(int segmentIndex, void *ctx);
 
-    for (int i = 0; i < hmlen(w->cache); i++)
-        if (w->handler.preStep != NULL)
-            w->handler.preStep(w->cache[i].key, &w->cache[i].value);
+/* 
+    Updates the advance of `advanceCtx` with the distance between 
+    the piece of `advanceCtx` and `piece`.
+*/
+static void prUpdateShapeCastAdvance(prShapeCastAdvanceCtx *advanceCtx,
+                                     const prShapeCastPiece *piece);
 
-    for (int i = 0; i < arrlen(w->bodies); i++) {
-        prApplyGravityToBody(w->bodies[i], w->gravity);
+/* 
+    Returns `true` if `s` only consists of convex pieces, 
+    which is the case for a 'circle' or a 'polygon' collision shape,
+    or a 'compound' collision shape without any other children.
+*/
+static bool prIsShapeCastConvex(const prShape *s);
 
-        prIntegrateForBodyVelocity(w->bodies[i], dt);
-    }
+/* 
+    Stores the child of `s` with the given `index` and the transform `tx` 
+    to `piece`, assuming `prIsShapeCastConvex(s)` is `true`.
+*/
+static void prGetShapeCastPiece(const prShape *s,
+                                prTransform tx,
+                                int index,
+                                prShapeCastPiece *piece);
 
-    for (int i = 0; i < hmlen(w->cache); i++)
-        prApplyAccumulatedImpulses(w->cache[i].key.first,
-                                   w->cache[i].key.second,
-                                   &w->cache[i].value);
+/* 
+    Returns the distance between `p1` and `p2`, then stores
+    the direction from the closest point of `p1` to that of `p2` to `direction`.
+*/
+static float prComputeShapeCastPieceDistance(const prShapeCastPiece *p1,
+                                             const prShapeCastPiece *p2,
+                                             prVector2 *direction);
 
-    const float inverseDt = 1.0f / dt;
+/* 
+    Returns the distance from `p` to the line segment from `v1` to `v2`, then 
+    stores the direction from `p` to the closest point on the segment to `direction`.
+*/
+static float prComputeSegmentDistance(prVector2 v1,
+                                      prVector2 v2,
+                                      prVector2 p,
+                                      prVector2 *direction);
 
-    for (int i = 0; i < PR_WORLD_ITERATION_COUNT; i++)
-        for (int j = 0; j < hmlen(w->cache); j++)
-            prResolveCollision(w->cache[j].key.first,
-                               w->cache[j].key.second,
-                               &w->cache[j].value,
-                               inverseDt);
+/* Returns the AABB that covers `aabb` moving along `translation`. */
+static PR_API_INLINE prAABB prGetSweptAABB(prAABB aabb, prVector2 translation);
 
-    for (int i = 0; i < arrlen(w->bodies); i++)
-        prIntegrateForBodyPosition(w->bodies[i], dt);
+/* 
+    Returns the smallest width of `s` in any direction, or `0` if `s` is 
+    a 'chain' collision shape (since its line segments have no width).
+*/
+static float prGetShapeMinWidth(const prShape *s);
 
-    for (int i = 0; i < hmlen(w->cache); i++)
-        if (w->handler.postStep != NULL)
-            w->handler.postStep(w->cache[i].key, &w->cache[i].value);
+/* Query the broad-phase data structure of `w` for any bodies overlapping `aabb`. */
+static void prQueryWorldBroadPhase(prWorld *w,
+                                   prAABB aabb,
+                                   prHashQueryFunc func,
+                                   void *ctx);
 
-    prPostStepWorld(w);
-}
+/* 
+    A callback function for `prRunThreadPool()` 
+    that computes the collision for each candidate pair in the range `[start, end)`.
+*/
+static void prComputeCandidatePairs(int start,
+                                    int end,
+                                    int threadIndex,
+                                    void *ctx);
+
+/* Merges the collision of each candidate pair of `w` into the contact table of `w`. */
+static void prMergeCandidatePairs(prWorld *w);
 
 /* 
-    Proceeds the simulation over the time step `dt`, in seconds,
-    which will always run independent of the framerate.
+    Merges the overlap of a candidate `pair` with a sensor body into 
+    the sensor overlaps of `w`, deferring each new overlap to the end of the merge.
 */
-void prUpdateWorld(prWorld *w, float dt) {
-    if (w == NULL || dt <= 0.0f) return;
+static void prMergeSensorPair(prWorld *w, const prCandidatePair *pair);
 
-    double currentTime = prGetCurrentTime();
-    double elapsedTime = currentTime = w->timestamp;
+/* Reports an end event for each sensor overlap of `w` that was not found again. */
+static void prSweepSensorOverlaps(prWorld *w);
 
-    w->timestamp = currentTime, w->accumulator += elapsedTime;
+/* Returns the event for the sensor overlap of the bodies at `first` and `second` in `w`. */
+static prBodyPair prGetSensorEvent(const prWorld *w, int first, int second);
 
-    for (; w->accumulator >= dt; w->accumulator -= dt)
-        prStepWorld(w, dt);
-}
+/* Mixes the materials of `b1` and `b2` into the friction and restitution of `collision`. */
+static void prMixCollisionMaterials(prCollision *collision,
+                                    const prBody *b1,
+                                    const prBody *b2);
+
+/* Returns the root of the island node with the given `index` in `ci`. */
+static int prFindIslandRoot(prContactIslands *ci, int index);
+
+/* Returns the index of an empty slot for a new body in `w`. */
+static int prAllocateWorldSlot(prWorld *w);
 
 /* 
-    Casts a `ray` against all objects in `w`, 
-    then calls `func` for each object that collides with `ray`. 
+    Allows the slots of the bodies removed from `w` to be reused,
+    once no contacts refer to them anymore.
 */
-void prComputeRaycastForWorld(prWorld *w, prRay ray, prRaycastQueryFunc func) {
-    if (w == NULL || func == NULL) return;
+static void prRecycleWorldSlots(prWorld *w);
 
-    prClearSpatialHash(w->hash);
+/* Copies the motion data of each body in `w` to the body storage of `w`. */
+static void prLoadWorldBodies(prWorld *w);
 
-    for (int i = 0; i < arrlen(w->bodies); i++)
-        prInsertToSpatialHash(w->hash, prGetBodyAABB(w->bodies[i]), i);
+/* Copies the motion data in the body storage of `w` back to each body in `w`. */
+static void prStoreWorldBodies(prWorld *w);
 
-    prVector2 minVertex = ray.origin,
-              maxVertex = prVector2Add(
-                  ray.origin,
-                  prVector2ScalarMultiply(prVector2Normalize(ray.direction),
-                                          ray.maxDistance));
+/* Wakes up each sleeping body of `w` that shares an island with an awake body. */
+static void prWakeContactIslands(prWorld *w);
 
-    prQuerySpatialHash(w->hash,
-                       (prAABB) { .x = fminf(minVertex.x, maxVertex.x),
-                                  .y = fminf(minVertex.y, maxVertex.y),
-                                  .width = fabsf(maxVertex.x - minVertex.x),
-                                  .height = fabsf(maxVertex.y - minVertex.y) },
-                       prRaycastHashQueryCallback,
-                       &(prRaycastHashQueryCtx) {
-                           .ray = ray, .world = w, .func = func });
-}
+/* Groups the contacts of `w` into islands that do not share any movable bodies. */
+static void prBuildContactIslands(prWorld *w);
 
-/* Private Functions ==================================================================== */
+/* 
+    A callback function for `prRunThreadPool()` 
+    that solves each contact island in the range `[start, end)`.
+*/
+static void prSolveContactIslands(int start,
+                                  int end,
+                                  int threadIndex,
+                                  void *ctx);
 
 /* 
-    A callback function for `prQuerySpatialHash()` 
-    that will be called during `prPreStepWorld()`. 
+    Collects the contact constraints of `w` that need to be solved,
+    in the order of the contact islands of `w` (if they are solved separately).
 */
-static bool prPreStepHashQueryCallback(int otherBodyIndex, void *ctx) {
-    prPreStepHashQueryCtx *queryCtx = ctx;
+static void prBuildWorldConstraints(prWorld *w);
 
-    if (otherBodyIndex <= queryCtx->bodyIndex) return false;
+/* 
+    A callback function for `prRunThreadPool()` that applies accumulated impulses
+    for each contact constraint in the range `[start, end)`.
+*/
+static void prWarmStartContactConstraints(int start,
+                                          int end,
+                                          int threadIndex,
+                                          void *ctx);
 
-    prBody *b1 = queryCtx->world->bodies[queryCtx->bodyIndex];
-    prBody *b2 = queryCtx->world->bodies[otherBodyIndex];
+/* 
+    Solves the contact constraints of `w` with `iterationCount` iterations,
+    possibly on multiple threads.
+*/
+static void prSolveWorldConstraints(prWorld *w,
+                                    int iterationCount,
+                                    float inverseDt);
 
-    if (prGetBodyInverseMass(b1) + prGetBodyInverseMass(b2) <= 0.0f)
-        return false;
+/* 
+    Returns `true` if the contact islands of `w` are solved separately, 
+    which is the case with a thread pool or an early exit of the solver.
+*/
+static PR_API_INLINE bool prSolvesContactIslands(const prWorld *w);
 
-    const prBodyPair key = { .first = b1, .second = b2 };
+/* Returns `true` if `b` is neither static nor sleeping. */
+static PR_API_INLINE bool prIsBodyAwake(const prBody *b);
 
-    prShape *s1 = prGetBodyShape(b1), *s2 = prGetBodyShape(b2);
-    prTransform tx1 = prGetBodyTransform(b1), tx2 = prGetBodyTransform(b2);
+/* Returns `true` if the collision shape of `b` is a 'chain' collision shape. */
+static PR_API_INLINE bool prIsChainBody(const prBody *b);
 
-    prCollision collision = { .count = 0 };
+/* Returns `true` if the collision shape of `b` is a 'compound' collision shape. */
+static PR_API_INLINE bool prIsCompoundBody(const prBody *b);
 
-    if (!prComputeCollision(s1, tx1, s2, tx2, &collision)) {
-        // NOTE: `hmdel()` returns `0` if `key` is not in `queryCtx->world->cache`!
-        hmdel(queryCtx->world->cache, key);
+/* 
+    Returns the AABB of the child of the collision shape of `b` at `index`,
+    which is the AABB of `b` unless `b` is a 'compound' body.
+*/
+static PR_API_INLINE prAABB prGetBodyChildAABB(const prBody *b, int index);
 
-        return false;
-    }
+/* Puts each island of `w` to sleep if all of its bodies have been resting long enough. */
+static void prUpdateWorldSleepStates(prWorld *w, float dt);
 
-    prContactCacheEntry *entry = hmgetp_null(queryCtx->world->cache, key);
+/* 
+    Sweeps each fast-moving bullet of `w` from where it was at the start of 
+    the time step `dt`, sub-stepping it at each time of impact along the way.
+*/
+static void prUpdateWorldBullets(prWorld *w, float dt);
 
-    if (entry != NULL) {
-        collision.friction = entry->value.friction;
-        collision.restitution = entry->value.restitution;
+/* Updates the broad-phase data structure of `w` with the AABB of each body. */
+static void prUpdateWorldBroadPhase(prWorld *w);
 
-        for (int i = 0; i < collision.count; i++) {
-            int k = -1;
+/* 
+    Updates the broad-phase data structure of `w` only if it is out of date,
+    so that queries between two steps of `w` do not update it again.
+*/
+static void prRefreshWorldBroadPhase(prWorld *w);
 
-            for (int j = 0; j < entry->value.count; j++) {
-                const int id = entry->value.contacts[j].id;
+/* 
+    Updates the broad-phase data structure of `w` with the AABB
+    of the body with the given `index` (if the data structure is persistent),
+    or the list of 'chain' bodies of `w` if the body is a 'chain' body.
+*/
+static void prUpdateWorldBroadPhaseForBody(prWorld *w, int index);
 
-                if (collision.contacts[i].id == id) {
-                    k = j;
+/* 
+    Removes the body with the given `index` from the broad-phase data structure 
+    of `w` (or from the list of 'chain' bodies of `w`).
+*/
+static void prRemoveFromWorldBroadPhase(prWorld *w, int index);
 
-                    break;
-                }
-            }
+/* 
+    Returns the position of the first 'chain' body in `w` 
+    whose index is not less than `index`.
+*/
+static int prFindWorldChain(const prWorld *w, int index);
 
-            if (k >= 0) {
-                const float accNormalScalar = entry->value.contacts[k]
-                                                  .cache.normalScalar;
-                const float accTangentScalar = entry->value.contacts[k]
-                                                   .cache.tangentScalar;
+/* 
+    Adds the body with the given `index` to the move buffer of the dynamic tree of `w`,
+    after its enlarged AABB changed (or it was removed from the tree).
+*/
+static void prMarkWorldTreeMove(prWorld *w, int index);
 
-                collision.contacts[i].cache.normalScalar = accNormalScalar;
-                collision.contacts[i].cache.tangentScalar = accTangentScalar;
-            } else {
-                collision.contacts[i].cache.normalScalar = 0.0f;
-                collision.contacts[i].cache.tangentScalar = 0.0f;
-            }
-        }
-    } else {
-        collision.friction = 0.5f
-                             * (prGetShapeFriction(s1)
-                                + prGetShapeFriction(s2));
-        collision.restitution = fminf(prGetShapeRestitution(s1),
-                                      prGetShapeRestitution(s2));
+/* 
+    Updates the pairs of bodies whose enlarged AABBs overlap in the dynamic tree
+    of `w` by querying the tree only for the bodies in the move buffer, 
+    then finds the candidate pairs of `w` among those pairs.
+*/
+static void prFindTreePairs(prWorld *w);
 
-        if (collision.friction <= 0.0f) collision.friction = 0.0f;
-        if (collision.restitution <= 0.0f) collision.restitution = 0.0f;
-    }
+/* 
+    Finds the candidate pairs of each 'chain' body in `w`, 
+    one for each line segment that the AABB of another body overlaps.
+*/
+static void prFindChainPairs(prWorld *w);
 
-    hmputs(queryCtx->world->cache,
-           ((prContactCacheEntry) { .key = key, .value = collision }));
+/* 
+    Finds all pairs of bodies in `w` that are colliding, 
+    then updates the contact table of `w`.
+*/
+static void prPreStepWorld(prWorld *w);
 
-    return true;
-}
+/* Copies the contacts of `w` to the contiguous array returned by `prGetWorldContacts()`. */
+static void prExportWorldContacts(prWorld *w);
 
 /* 
-    A callback function for `prQuerySpatialHash()` 
-    that will be called during `prComputeRaycastForWorld()`.
+    Copies the handles and the transforms of the bodies in `w` 
+    to the contiguous arrays returned by `prGetWorldTransforms()`.
 */
-static bool prRaycastHashQueryCallback(int bodyIndex, void *ctx) {
-    prRaycastHashQueryCtx *queryCtx = ctx;
+static void prExportWorldTransforms(prWorld *w);
 
-    prRaycastHit raycastHit = { .distance = 0.0f };
+/* 
+    Clears the accumulated forces on each body in `w`, 
+    then marks the broad-phase data structure of `w` as out of date.
+*/
+static void prPostStepWorld(prWorld *w);
 
-    if (!prComputeRaycast(queryCtx->world->bodies[bodyIndex],
-                          queryCtx->ray,
-                          &raycastHit))
-        return false;
+/* 
+    Proceeds the simulation of `w` over the time step `dt`, in seconds,
+    with `iterationCount` iterations of the constraint solver.
+*/
+static void prStepWorldWithIterations(prWorld *w,
+                                      float dt,
+                                      int iterationCount);
 
-    queryCtx->func(raycastHit);
+/* 
+    Adds the time elapsed since `*lastTime` to `*phaseTime`, then updates
+    `*lastTime` to the current time (unless `PR_DISABLE_STATS` is defined).
+*/
+static PR_API_INLINE void prRecordWorldPhaseTime(double *phaseTime,
+                                                 double *lastTime);
 
-    return true;
-}
+/* 
+    Returns the number of blocks allocated (or resized) so far on the calling thread
+    and on the worker threads of `w`.
+*/
+static PR_API_INLINE size_t prGetWorldAllocationCount(const prWorld *w);
 
-/* Finds all pairs of bodies in `w` that are colliding. */
-static void prPreStepWorld(prWorld *w) {
-    for (int i = 0; i < arrlen(w->bodies); i++)
-        prInsertToSpatialHash(w->hash, prGetBodyAABB(w->bodies[i]), i);
+/* 
+    A callback function for `prRunThreadPoolWithBatchSize()` 
+    that steps each world in the range `[start, end)`.
+*/
+static void prStepWorldsCallback(int start,
+                                 int end,
+                                 int threadIndex,
+                                 void *ctx);
 
-    for (int i = 0; i < arrlen(w->bodies); i++)
-        prQuerySpatialHash(w->hash,
-                           prGetBodyAABB(w->bodies[i]),
-                           prPreStepHashQueryCallback,
-                           &(prPreStepHashQueryCtx) { .world = w,
-                                                      .bodyIndex = i });
-}
+/* 
+    Writes the state of `w` to `buffer` if it has at least `size` bytes,
+    skipping the bodies that did not change from the `base` state (if any),
+    then returns the size of the state.
+*/
+static size_t prWriteWorldState(const prWorld *w,
+                                const unsigned char *base,
+                                void *buffer,
+                                size_t size);
 
 /* 
-    Clears the accumulated forces on each body in `w`, 
-    then clears the spatial hash of `w`. 
+    Reads the header of the state in `buffer` to `header`, 
+    then returns `true` if the state is valid and fits in `size` bytes.
 */
-static void prPostStepWorld(prWorld *w) {
-    for (int i = 0; i < arrlen(w->bodies); i++)
-        prClearBodyForces(w->bodies[i]);
+static bool prReadWorldStateHeader(const void *buffer,
+                                   size_t size,
+                                   prWorldStateHeader *header);
 
-    prClearSpatialHash(w->hash);
-}
\ No newline at end of file
+/* Returns `true` if the state in `buffer` can be restored to `w`. */
+static bool prCheckWorldState(const prWorld *w,
+                              const unsigned char *buffer,
+                              const prWorldStateHeader *header);
+
+/* Restores the bodies of `w` from the state in `buffer`. */
+static void prLoadWorldStateBodies(prWorld *w,
+                                   const unsigned char *buffer,
+                                   const prWorldStateHeader *header);
+
+/* Restores the contact cache and the sensor overlaps of `w` from the state in `buffer`. */
+static void prLoadWorldStateContacts(prWorld *w,
+                                     const unsigned char *buffer,
+                                     const prWorldStateHeader *header);
+
+/* Public Functions ===================================================================== */
+
+/* 
+    Creates a world with the `gravity` vector and `cellSize` 
+    for broad-phase collision detection.
+*/
+prWorld *prCreateWorld(prVector2 gravity, float cellSize) {
+    return prCreateWorldFromConfig(
+        (prWorldConfig) { .gravity = gravity,
+                          .cellSize = cellSize,
+                          .broadPhase = PR_BROAD_PHASE_PERSISTENT_SPATIAL_HASH });
+}
+
+/* Creates a world with the given `config`uration. */
+prWorld *prCreateWorldFromConfig(prWorldConfig config) {
+    // NOTE: A world without a complete set of allocation functions uses the default one.
+    if (config.allocator.allocate == NULL || config.allocator.reallocate == NULL
+        || config.allocator.release == NULL)
+        config.allocator = prGetDefaultAllocator();
+
+    const prAllocator *allocator = prSetCurrentAllocator(&config.allocator);
+
+    prWorld *result = prAllocateMemory(sizeof *result);
+
+    result->allocator = config.allocator;
+
+    prSetCurrentAllocator(&result->allocator);
+
+    result->gravity = config.gravity;
+    result->broadPhase = config.broadPhase;
+
+    switch (config.broadPhase) {
+        case PR_BROAD_PHASE_PERSISTENT_SPATIAL_HASH:
+            result->hash = prCreatePersistentSpatialHash(config.cellSize);
+
+            break;
+
+        case PR_BROAD_PHASE_DYNAMIC_TREE:
+            result->tree = prCreateDynamicTree(PR_BROAD_PHASE_AABB_MARGIN);
+
+            break;
+
+        default:
+            result->broadPhase = PR_BROAD_PHASE_SPATIAL_HASH;
+            result->hash = prCreateSpatialHash(config.cellSize);
+
+            break;
+    }
+
+    prSetWorldThreadCount(result, config.threadCount);
+
+    prSetWorldIterationCount(result,
+                             (config.iterationCount > 0)
+                                 ? config.iterationCount
+                                 : PR_WORLD_ITERATION_COUNT);
+    prSetWorldSolverTolerance(result, config.solverTolerance);
+
+    prSetWorldMaxStepCount(result,
+                           (config.maxStepCount > 0) ? config.maxStepCount
+                                                     : PR_WORLD_MAX_STEP_COUNT);
+    prSetWorldSubStepCount(result, config.subStepCount);
+
+#ifdef PR_DETERMINISTIC
+    result->deterministic = true;
+#else
+    result->deterministic = config.deterministic;
+#endif
+
+    // NOTE: The first call to `prUpdateWorld()` starts counting from here.
+    result->update.timestamp = prGetCurrentTime();
+
+    result->sleeping.enabled = true;
+
+    prSetWorldSleepThresholds(result,
+                              PR_WORLD_SLEEP_LINEAR_THRESHOLD,
+                              PR_WORLD_SLEEP_ANGULAR_THRESHOLD,
+                              PR_WORLD_TIME_TO_SLEEP);
+
+    prSetCurrentAllocator(allocator);
+
+    return result;
+}
+
+/* Release the memory allocated for `w`. */
+void prReleaseWorld(prWorld *w) {
+    if (w == NULL) return;
+
+    for (int i = 0; i < arrlen(w->slots.dense); i++)
+        prReleaseBody(w->bodies[w->slots.dense[i]]);
+
+    prReleaseSpatialHash(w->hash);
+    prReleaseDynamicTree(w->tree);
+
+    arrfree(w->treePairs.pairs);
+    arrfree(w->treePairs.moveBuffer), arrfree(w->treePairs.moved);
+
+    prReleaseThreadPool(w->pool);
+
+    for (int i = 0; i < arrlen(w->solverBuffers); i++)
+        prReleaseSolverBuffer(&w->solverBuffers[i]);
+
+    arrfree(w->solverBuffers), arrfree(w->solver.iterationCounts);
+
+    arrfree(w->bodies), arrfree(w->chains), arrfree(w->pairs);
+
+    arrfree(w->slots.generations);
+    arrfree(w->slots.dense), arrfree(w->slots.sparse);
+    arrfree(w->slots.freeIndexes), arrfree(w->slots.removedIndexes);
+
+    prReleaseContactTable(&w->contacts);
+
+    arrfree(w->separatingAxes);
+
+    prReleaseContactTable(&w->sensors.overlaps);
+
+    arrfree(w->sensors.beginEvents), arrfree(w->sensors.endEvents);
+
+    arrfree(w->exports.contacts);
+    arrfree(w->exports.handles), arrfree(w->exports.transforms);
+
+    prReleaseBodyStorage(&w->storage);
+
+    arrfree(w->constraints);
+
+    arrfree(w->islands.parents), arrfree(w->islands.roots);
+    arrfree(w->islands.indexes), arrfree(w->islands.offsets);
+    arrfree(w->islands.contacts), arrfree(w->islands.sleepTimes);
+
+    // NOTE: Each block of memory is released with the allocator that allocated it.
+    prReleaseMemory(w);
+}
+
+/* Erases all rigid bodies from `w`. */
+void prClearWorld(prWorld *w) {
+    if (w == NULL) return;
+
+    const prAllocator *allocator = prSetCurrentAllocator(&w->allocator);
+
+    prClearSpatialHash(w->hash);
+    prClearDynamicTree(w->tree);
+
+    arrsetlen(w->treePairs.pairs, 0);
+    arrsetlen(w->treePairs.moveBuffer, 0), arrsetlen(w->treePairs.moved, 0);
+
+    arrsetlen(w->slots.freeIndexes, 0), arrsetlen(w->slots.removedIndexes, 0);
+
+    // NOTE: The slots are reused in ascending order, starting from the first one.
+    for (int i = arrlen(w->bodies) - 1; i >= 0; i--) {
+        if (w->bodies[i] != NULL) {
+            prSetBodyStorageIndex(w->bodies[i], -1);
+            prSetBodyWorld(w->bodies[i], NULL);
+
+            w->bodies[i] = NULL, w->slots.generations[i]++;
+        }
+
+        arrput(w->slots.freeIndexes, i);
+    }
+
+    arrsetlen(w->slots.dense, 0), arrsetlen(w->chains, 0);
+
+    prClearContactTable(&w->contacts);
+
+    arrfree(w->separatingAxes);
+
+    prClearContactTable(&w->sensors.overlaps);
+
+    arrsetlen(w->sensors.beginEvents, 0), arrsetlen(w->sensors.endEvents, 0);
+
+    arrsetlen(w->exports.contacts, 0);
+    arrsetlen(w->exports.handles, 0), arrsetlen(w->exports.transforms, 0);
+
+    w->exports.contactsDirty = w->exports.transformsDirty = false;
+
+    prSetCurrentAllocator(allocator);
+}
+
+/* Adds a rigid body to `w`. */
+bool prAddBodyToWorld(prWorld *w, prBody *b) {
+    // NOTE: A body cannot be added to more than one world at a time.
+    if (w == NULL || b == NULL || prGetBodyStorageIndex(b) >= 0) return false;
+
+    const prAllocator *allocator = prSetCurrentAllocator(&w->allocator);
+
+    const int index = prAllocateWorldSlot(w);
+
+    w->bodies[index] = b;
+
+    w->slots.sparse[index] = arrlen(w->slots.dense);
+
+    arrput(w->slots.dense, index);
+
+    // NOTE: The body storage index of a body is the index of its slot in `w`.
+    prSetBodyStorageIndex(b, index), prSetBodyWorld(b, w);
+
+    w->broadPhaseDirty = true;
+
+    // NOTE: Static and sleeping bodies are skipped by `prUpdateWorldBroadPhase()`.
+    prUpdateWorldBroadPhaseForBody(w, index);
+
+    prSetCurrentAllocator(allocator);
+
+    return true;
+}
+
+/* Removes a rigid body from `w`. */
+bool prRemoveBodyFromWorld(prWorld *w, prBody *b) {
+    if (w == NULL || b == NULL) return false;
+
+    const int index = prGetBodyStorageIndex(b);
+
+    // NOTE: `O(1)` performance!
+    if (index < 0 || index >= arrlen(w->bodies) || w->bodies[index] != b)
+        return false;
+
+    const prAllocator *allocator = prSetCurrentAllocator(&w->allocator);
+
+    prRemoveFromWorldBroadPhase(w, index);
+
+    // NOTE: The other bodies in `w` keep their slots, so no indexes are moved.
+    w->bodies[index] = NULL, w->slots.generations[index]++;
+
+    const int position = w->slots.sparse[index];
+    const int lastIndex = arrpop(w->slots.dense);
+
+    if (lastIndex != index) {
+        w->slots.dense[position] = lastIndex;
+        w->slots.sparse[lastIndex] = position;
+    }
+
+    prSetBodyStorageIndex(b, -1), prSetBodyWorld(b, NULL);
+
+    w->broadPhaseDirty = true;
+
+    /*
+        NOTE: The contacts of `b` are kept in the contact table until
+        the next step (since this function might be called during 
+        the pre-step callback), so its slot cannot be reused until then.
+    */
+    arrput(w->slots.removedIndexes, index);
+
+    prSetCurrentAllocator(allocator);
+
+    return true;
+}
+
+/* Returns a rigid body with the given `index` from `w`. */
+prBody *prGetBodyFromWorld(const prWorld *w, int index) {
+    if (w == NULL || index < 0 || index >= arrlen(w->slots.dense)) return NULL;
+
+    return w->bodies[w->slots.dense[index]];
+}
+
+/* Returns the number of rigid bodies in `w`. */
+int prGetBodyCountForWorld(const prWorld *w) {
+    return (w != NULL) ? arrlen(w->slots.dense) : 0;
+}
+
+/* Returns the handle of `b` in `w`, or an invalid handle if `b` is not in `w`. */
+prBodyHandle prGetBodyHandle(const prWorld *w, const prBody *b) {
+    const int index = prGetBodyStorageIndex(b);
+
+    if (w == NULL || index < 0 || index >= arrlen(w->bodies)
+        || w->bodies[index] != b)
+        return (prBodyHandle) { .index = -1 };
+
+    return (prBodyHandle) { .index = index,
+                            .generation = w->slots.generations[index] };
+}
+
+/* Returns the rigid body referenced by `handle` in `w`, or `NULL` if there is none. */
+prBody *prGetBodyFromHandle(const prWorld *w, prBodyHandle handle) {
+    if (w == NULL || handle.index < 0 || handle.index >= arrlen(w->bodies)
+        || w->slots.generations[handle.index] != handle.generation)
+        return NULL;
+
+    return w->bodies[handle.index];
+}
+
+/* Returns the gravity acceleration vector of `w`. */
+prVector2 prGetWorldGravity(const prWorld *w) {
+    return (w != NULL) ? w->gravity : PR_API_STRUCT_ZERO(prVector2);
+}
+
+/* Returns the type of the broad-phase algorithm of `w`. */
+prBroadPhaseType prGetWorldBroadPhaseType(const prWorld *w) {
+    return (w != NULL) ? w->broadPhase : PR_BROAD_PHASE_SPATIAL_HASH;
+}
+
+/* Returns the number of threads used for the narrow phase of `w`. */
+int prGetWorldThreadCount(const prWorld *w) {
+    return (w != NULL) ? w->threadCount : 0;
+}
+
+/* Returns the maximum number of iterations for the constraint solver of `w`. */
+int prGetWorldIterationCount(const prWorld *w) {
+    return (w != NULL) ? w->solver.iterationCount : 0;
+}
+
+/* Returns the impulse tolerance for the constraint solver of `w` to stop early. */
+float prGetWorldSolverTolerance(const prWorld *w) {
+    return (w != NULL) ? w->solver.tolerance : 0.0f;
+}
+
+/* Returns the maximum number of steps for each call to `prUpdateWorld()` with `w`. */
+int prGetWorldMaxStepCount(const prWorld *w) {
+    return (w != NULL) ? w->update.maxStepCount : 0;
+}
+
+/* Returns the number of sub-steps for each step of `prUpdateWorld()` with `w`. */
+int prGetWorldSubStepCount(const prWorld *w) {
+    return (w != NULL) ? w->update.subStepCount : 0;
+}
+
+/* 
+    Returns how far the time left over from the last call to `prUpdateWorld()`
+    with `w` is into the next step, from `0` to `1`, for interpolating the transforms
+    of the bodies in `w` with `prGetBodyInterpolatedTransform()`.
+*/
+float prGetWorldInterpolationAlpha(const prWorld *w) {
+    return (w != NULL) ? w->update.alpha : 0.0f;
+}
+
+/* Returns the time spent on each phase of the last step of `w`. */
+prWorldStats prGetWorldStats(const prWorld *w) {
+    return (w != NULL) ? w->stats : PR_API_STRUCT_ZERO(prWorldStats);
+}
+
+/* 
+    Returns the bodies that started (or stopped) touching a sensor body
+    in the last step of `w`, which stay valid until the next step of `w`.
+*/
+prSensorEvents prGetWorldSensorEvents(const prWorld *w) {
+    if (w == NULL) return PR_API_STRUCT_ZERO(prSensorEvents);
+
+    return (prSensorEvents) { .beginEvents = w->sensors.beginEvents,
+                              .endEvents = w->sensors.endEvents,
+                              .beginCount = arrlen(w->sensors.beginEvents),
+                              .endCount = arrlen(w->sensors.endEvents) };
+}
+
+/* 
+    Returns the contacts of the last step of `w` as a contiguous array,
+    which stays valid until the next step of `w`.
+    (The array is only filled on the first call after each step of `w`,
+    so stepping `w` costs nothing extra if this function is never called.)
+*/
+prWorldContacts prGetWorldContacts(prWorld *w) {
+    if (w == NULL) return PR_API_STRUCT_ZERO(prWorldContacts);
+
+    if (w->exports.contactsDirty) prExportWorldContacts(w);
+
+    return (prWorldContacts) { .contacts = w->exports.contacts,
+                               .count = arrlen(w->exports.contacts) };
+}
+
+/* 
+    Returns the handles and the transforms of the bodies in `w` as contiguous arrays, 
+    which stay valid until the next step of `w`.
+    (The arrays are only filled on the first call after each step of `w`,
+    so stepping `w` costs nothing extra if this function is never called.)
+*/
+prWorldTransforms prGetWorldTransforms(prWorld *w) {
+    if (w == NULL) return PR_API_STRUCT_ZERO(prWorldTransforms);
+
+    if (w->exports.transformsDirty) prExportWorldTransforms(w);
+
+    return (prWorldTransforms) { .handles = w->exports.handles,
+                                 .transforms = w->exports.transforms,
+                                 .count = arrlen(w->exports.handles) };
+}
+
+/* 
+    Returns `true` if the results of stepping `w` only depend on the state of `w`,
+    and not on the history of its broad phase.
+*/
+bool prIsWorldDeterministic(const prWorld *w) {
+    return (w != NULL) ? w->deterministic : false;
+}
+
+/* Returns `true` if the bodies in `w` are allowed to fall asleep. */
+bool prIsWorldSleepingEnabled(const prWorld *w) {
+    return (w != NULL) ? w->sleeping.enabled : false;
+}
+
+/* Sets the collision event `handler` of `w`. */
+void prSetWorldCollisionHandler(prWorld *w, prCollisionHandler handler) {
+    if (w != NULL) w->handler = handler;
+}
+
+/* Sets the `gravity` acceleration vector of `w`. */
+void prSetWorldGravity(prWorld *w, prVector2 gravity) {
+    if (w != NULL) w->gravity = gravity;
+}
+
+/* Sets the number of threads used for the narrow phase of `w`. */
+void prSetWorldThreadCount(prWorld *w, int threadCount) {
+    if (w == NULL) return;
+
+    if (threadCount < 1) threadCount = 1;
+
+    if (w->threadCount == threadCount) return;
+
+    const prAllocator *allocator = prSetCurrentAllocator(&w->allocator);
+
+    prReleaseThreadPool(w->pool);
+
+    // NOTE: A single-threaded world does not need any worker threads.
+    w->pool = (threadCount > 1) ? prCreateThreadPool(threadCount) : NULL;
+
+    /*
+        NOTE: The thread pool might have fewer threads than requested, 
+        if the system refused to create more threads.
+    */
+    w->threadCount = prGetThreadPoolThreadCount(w->pool);
+
+    for (int i = 0; i < arrlen(w->solverBuffers); i++)
+        prReleaseSolverBuffer(&w->solverBuffers[i]);
+
+    // NOTE: Each thread solves its contact islands with its own scratch memory.
+    arrsetlen(w->solverBuffers, w->threadCount);
+
+    for (int i = 0; i < w->threadCount; i++)
+        w->solverBuffers[i] = (prSolverBuffer) { .lastBatches = NULL };
+
+    arrsetlen(w->solver.iterationCounts, w->threadCount);
+
+    prSetCurrentAllocator(allocator);
+}
+
+/* Sets the maximum number of iterations for the constraint solver of `w`. */
+void prSetWorldIterationCount(prWorld *w, int iterationCount) {
+    if (w == NULL) return;
+
+    w->solver.iterationCount = (iterationCount > 1) ? iterationCount : 1;
+}
+
+/* 
+    Sets the impulse `tolerance` for the constraint solver of `w`, so that it stops 
+    once no impulse of an iteration is larger than `tolerance` (or `0` to disable).
+*/
+void prSetWorldSolverTolerance(prWorld *w, float tolerance) {
+    if (w == NULL) return;
+
+    w->solver.tolerance = (tolerance > 0.0f) ? tolerance : 0.0f;
+}
+
+/* 
+    Sets the maximum number of steps for each call to `prUpdateWorld()` with `w`,
+    dropping the time that could not be caught up with.
+*/
+void prSetWorldMaxStepCount(prWorld *w, int maxStepCount) {
+    if (w == NULL) return;
+
+    w->update.maxStepCount = (maxStepCount > 1) ? maxStepCount : 1;
+}
+
+/* 
+    Sets the number of sub-steps for each step of `prUpdateWorld()` with `w`,
+    splitting the solver iterations of a step between its sub-steps.
+*/
+void prSetWorldSubStepCount(prWorld *w, int subStepCount) {
+    if (w == NULL) return;
+
+    w->update.subStepCount = (subStepCount > 1) ? subStepCount : 1;
+}
+
+/* 
+    Enables or disables the deterministic mode of `w`, which sorts the pairs 
+    of bodies found in the broad phase of `w` by the indexes of their bodies.
+*/
+void prSetWorldDeterministic(prWorld *w, bool enabled) {
+    if (w != NULL) w->deterministic = enabled;
+}
+
+/* 
+    Allows or disallows the bodies in `w` to fall asleep. 
+    Disabling sleeping will wake up all bodies in `w`.
+*/
+void prSetWorldSleepingEnabled(prWorld *w, bool enabled) {
+    if (w == NULL) return;
+
+    w->sleeping.enabled = enabled;
+
+    if (enabled) return;
+
+    for (int i = 0; i < arrlen(w->slots.dense); i++)
+        prSetBodySleeping(w->bodies[w->slots.dense[i]], false);
+}
+
+/* 
+    Sets the speed thresholds and the time for the bodies in `w`
+    to rest before they fall asleep.
+*/
+void prSetWorldSleepThresholds(prWorld *w,
+                               float linearThreshold,
+                               float angularThreshold,
+                               float timeToSleep) {
+    if (w == NULL) return;
+
+    w->sleeping.linearThreshold = fmaxf(linearThreshold, 0.0f);
+    w->sleeping.angularThreshold = fmaxf(angularThreshold, 0.0f);
+    w->sleeping.timeToSleep = fmaxf(timeToSleep, 0.0f);
+}
+
+/* 
+    Marks the broad-phase data structure of `w` as out of date, 
+    so that the next query of `w` updates it first.
+*/
+void prMarkWorldBroadPhaseDirty(prWorld *w) {
+    if (w != NULL) w->broadPhaseDirty = true;
+}
+
+/* Proceeds the simulation over the time step `dt`, in seconds. */
+void prStepWorld(prWorld *w, float dt) {
+    if (w == NULL || dt <= 0.0f) return;
+
+    prStepWorldWithIterations(w, dt, w->solver.iterationCount);
+}
+
+/* 
+    Proceeds the simulation of each of the `count` worlds in `worlds` over
+    the time step `dt`, in seconds, stepping different worlds in parallel 
+    on the threads of `tp` (or one after another if `tp` is `NULL`).
+*/
+void prStepWorlds(prWorld **worlds, int count, float dt, prThreadPool *tp) {
+    if (worlds == NULL || count <= 0) return;
+
+    prStepWorldsCtx stepCtx = { .worlds = worlds, .dt = dt };
+
+    // NOTE: Even a single world is worth a batch of its own.
+    prRunThreadPoolWithBatchSize(tp, count, 1, prStepWorldsCallback, &stepCtx);
+}
+
+/* 
+    Proceeds the simulation over the time step `dt`, in seconds,
+    which will always run independent of the framerate.
+    This runs at most a few steps (and their sub-steps) for each call,
+    saving the previous transforms of the bodies in `w` before each step.
+*/
+void prUpdateWorld(prWorld *w, float dt) {
+    if (w == NULL || dt <= 0.0f) return;
+
+    const double currentTime = prGetCurrentTime();
+
+    w->update.accumulator += currentTime - w->update.timestamp;
+    w->update.timestamp = currentTime;
+
+    const int subStepCount = w->update.subStepCount;
+
+    // NOTE: Each sub-step is shorter, so it needs fewer iterations to converge.
+    int iterationCount = w->solver.iterationCount / subStepCount;
+
+    if (iterationCount < 1) iterationCount = 1;
+
+    for (int i = 0; i < w->update.maxStepCount && w->update.accumulator >= dt;
+         i++) {
+        for (int j = 0; j < arrlen(w->slots.dense); j++)
+            prUpdateBodyPreviousTransform(w->bodies[w->slots.dense[j]]);
+
+        for (int j = 0; j < subStepCount; j++)
+            prStepWorldWithIterations(w, dt / subStepCount, iterationCount);
+
+        w->update.accumulator -= dt;
+    }
+
+    /*
+        NOTE: A slow frame must not make the next frames even slower,
+        so the time that could not be caught up with is dropped.
+    */
+    if (w->update.accumulator >= dt)
+        w->update.accumulator = fmod(w->update.accumulator, dt);
+
+    w->update.alpha = w->update.accumulator / dt;
+}
+
+/* 
+    Casts a `ray` against all objects in `w`, 
+    then calls `func` for each object that collides with `ray`. 
+*/
+void prComputeRaycastForWorld(prWorld *w, prRay ray, prRaycastQueryFunc func) {
+    if (w == NULL || func == NULL) return;
+
+    const prAllocator *allocator = prSetCurrentAllocator(&w->allocator);
+
+    prRefreshWorldBroadPhase(w);
+
+    prRaycastHashQueryCtx queryCtx = { .ray = ray, .world = w, .func = func };
+
+    prRaycastWorldBroadPhase(w, &queryCtx);
+
+    prSetCurrentAllocator(allocator);
+}
+
+/* 
+    Casts each of the `count` rays in `rays` against all objects in `w`,
+    stores the closest hit (or any hit, if `mode` is `PR_RAYCAST_ANY`) of each ray
+    to `hits` (with `NULL` as the body of a miss), then returns the number of hits.
+*/
+int prComputeRaycastsForWorld(prWorld *w,
+                              const prRay *rays,
+                              int count,
+                              prRaycastMode mode,
+                              prRaycastHit *hits) {
+    if (w == NULL || rays == NULL || count <= 0 || hits == NULL) return 0;
+
+    const prAllocator *allocator = prSetCurrentAllocator(&w->allocator);
+
+    // NOTE: The broad-phase data structure is brought up to date once for all rays.
+    prRefreshWorldBroadPhase(w);
+
+    int result = 0;
+
+    for (int i = 0; i < count; i++) {
+        prRaycastHashQueryCtx queryCtx = { .ray = rays[i],
+                                           .world = w,
+                                           .mode = mode };
+
+        prRaycastWorldBroadPhase(w, &queryCtx);
+
+        hits[i] = queryCtx.hit;
+
+        if (hits[i].body != NULL) result++;
+    }
+
+    prSetCurrentAllocator(allocator);
+
+    return result;
+}
+
+/* 
+    Finds all bodies in `w` whose AABBs overlap `aabb`, stores up to `capacity`
+    of them to `bodies`, then returns the number of bodies found.
+*/
+int prQueryWorldAABB(prWorld *w, prAABB aabb, prBody **bodies, int capacity) {
+    if (w == NULL) return 0;
+
+    const prAllocator *allocator = prSetCurrentAllocator(&w->allocator);
+
+    prRefreshWorldBroadPhase(w);
+
+    prBodyHashQueryCtx queryCtx = { .world = w,
+                                    .aabb = aabb,
+                                    .bodies = bodies,
+                                    .capacity = (bodies != NULL) ? capacity
+                                                                 : 0 };
+
+    prQueryWorldBroadPhase(w, aabb, prAABBHashQueryCallback, &queryCtx);
+
+    prSetCurrentAllocator(allocator);
+
+    return queryCtx.count;
+}
+
+/* 
+    Finds all bodies in `w` that contain `point`, stores up to `capacity`
+    of them to `bodies`, then returns the number of bodies found.
+*/
+int prQueryWorldPoint(prWorld *w,
+                      prVector2 point,
+                      prBody **bodies,
+                      int capacity) {
+    if (w == NULL) return 0;
+
+    const prAllocator *allocator = prSetCurrentAllocator(&w->allocator);
+
+    prRefreshWorldBroadPhase(w);
+
+    prBodyHashQueryCtx queryCtx = { .world = w,
+                                    .aabb = { .x = point.x, .y = point.y },
+                                    .point = point,
+                                    .bodies = bodies,
+                                    .capacity = (bodies != NULL) ? capacity
+                                                                 : 0 };
+
+    prQueryWorldBroadPhase(w,
+                           queryCtx.aabb,
+                           prPointHashQueryCallback,
+                           &queryCtx);
+
+    prSetCurrentAllocator(allocator);
+
+    return queryCtx.count;
+}
+
+/* 
+    Sweeps `s` with the transform `tx` along `translation` against all bodies in `w`,
+    stores up to `capacity` of the closest hits (sorted by their fractions
+    of `translation`) to `hits`, then returns the number of hits found.
+*/
+int prComputeShapeCastForWorld(prWorld *w,
+                               const prShape *s,
+                               prTransform tx,
+                               prVector2 translation,
+                               prShapeCastHit *hits,
+                               int capacity) {
+    if (w == NULL || s == NULL) return 0;
+
+    const prAllocator *allocator = prSetCurrentAllocator(&w->allocator);
+
+    prRefreshWorldBroadPhase(w);
+
+    const prAABB aabb = prGetShapeAABB(s, tx);
+
+    prShapeCastHashQueryCtx queryCtx = { .world = w,
+                                         .shape = s,
+                                         .tx = tx,
+                                         .aabb = aabb,
+                                         .translation = translation,
+                                         .hits = hits,
+                                         .capacity = (hits != NULL) ? capacity
+                                                                    : 0 };
+
+    // NOTE: The broad phase is queried with the AABB of the entire sweep.
+    prQueryWorldBroadPhase(w,
+                           prGetSweptAABB(aabb, translation),
+                           prShapeCastHashQueryCallback,
+                           &queryCtx);
+
+    prSetCurrentAllocator(allocator);
+
+    return queryCtx.count;
+}
+
+/* 
+    Saves the state of `w` (the state of each body, the contact cache and 
+    the time left over by `prUpdateWorld()`) to `buffer` if it has at least 
+    `size` bytes, then returns the size of the state.
+    The state is in native byte order, and can be copied like any other memory.
+*/
+size_t prSaveWorldState(const prWorld *w, void *buffer, size_t size) {
+    return (w != NULL) ? prWriteWorldState(w, NULL, buffer, size) : 0;
+}
+
+/* 
+    Restores the state of `w` exactly from `buffer`, which must be 
+    saved by `prSaveWorldState()` while `w` had the same bodies as now.
+    The steps after the restore repeat the steps after the save with any 
+    broad phase, since new contacts are always inserted in the same order.
+*/
+bool prLoadWorldState(prWorld *w, const void *buffer, size_t size) {
+    prWorldStateHeader header;
+
+    if (w == NULL || !prReadWorldStateHeader(buffer, size, &header)
+        || (header.flags & WORLD_STATE_FLAG_DELTA))
+        return false;
+
+    // NOTE: Nothing in `w` is modified unless the whole state can be restored.
+    if (header.bodyCount != (uint32_t) arrlen(w->slots.dense)
+        || !prCheckWorldState(w, buffer, &header))
+        return false;
+
+    const prAllocator *allocator = prSetCurrentAllocator(&w->allocator);
+
+    prLoadWorldStateBodies(w, buffer, &header);
+    prLoadWorldStateContacts(w, buffer, &header);
+
+    w->update.accumulator = header.accumulator, w->update.alpha = header.alpha;
+
+    w->exports.contactsDirty = w->exports.transformsDirty = true;
+
+    prSetCurrentAllocator(allocator);
+
+    return true;
+}
+
+/* 
+    Saves the state of `w` like `prSaveWorldState()`, but only with 
+    the bodies whose states are different from the ones in the `base` state.
+*/
+size_t prSaveWorldStateDelta(const prWorld *w,
+                             const void *base,
+                             size_t baseSize,
+                             void *buffer,
+                             size_t size) {
+    prWorldStateHeader header;
+
+    if (w == NULL || !prReadWorldStateHeader(base, baseSize, &header)
+        || (header.flags & WORLD_STATE_FLAG_DELTA))
+        return 0;
+
+    return prWriteWorldState(w, base, buffer, size);
+}
+
+/* 
+    Restores the state of `w` exactly from the `base` state and
+    the `delta` state saved by `prSaveWorldStateDelta()` against `base`,
+    like `prLoadWorldState()`.
+*/
+bool prLoadWorldStateDelta(prWorld *w,
+                           const void *base,
+                           size_t baseSize,
+                           const void *delta,
+                           size_t deltaSize) {
+    prWorldStateHeader baseHeader, deltaHeader;
+
+    if (w == NULL || !prReadWorldStateHeader(base, baseSize, &baseHeader)
+        || !prReadWorldStateHeader(delta, deltaSize, &deltaHeader)
+        || (baseHeader.flags & WORLD_STATE_FLAG_DELTA)
+        || !(deltaHeader.flags & WORLD_STATE_FLAG_DELTA))
+        return false;
+
+    if (baseHeader.bodyCount != (uint32_t) arrlen(w->slots.dense)
+        || !prCheckWorldState(w, base, &baseHeader)
+        || !prCheckWorldState(w, delta, &deltaHeader))
+        return false;
+
+    const prAllocator *allocator = prSetCurrentAllocator(&w->allocator);
+
+    // NOTE: The bodies in `delta` override the same bodies in `base`.
+    prLoadWorldStateBodies(w, base, &baseHeader);
+    prLoadWorldStateBodies(w, delta, &deltaHeader);
+
+    prLoadWorldStateContacts(w, delta, &deltaHeader);
+
+    w->update.accumulator = deltaHeader.accumulator;
+    w->update.alpha = deltaHeader.alpha;
+
+    w->exports.contactsDirty = w->exports.transformsDirty = true;
+
+    prSetCurrentAllocator(allocator);
+
+    return true;
+}
+
+/* Private Functions ==================================================================== */
+
+/* Returns the key of the contact between the bodies at `first` and `second`. */
+static PR_API_INLINE uint64_t prGetContactKey(int first, int second) {
+    // NOTE: The key does not depend on the order of the bodies.
+    if (first > second) {
+        const int temp = first;
+
+        first = second, second = temp;
+    }
+
+    return ((uint64_t) (uint32_t) first << 32) | (uint32_t) second;
+}
+
+/* Returns the hash of the contact with the given `key` and `child`. */
+static PR_API_INLINE uint64_t prGetContactHash(uint64_t key, int child) {
+    // NOTE: A contact without a child (`-1`) has the same hash as its key.
+    key ^= (uint64_t) (uint32_t) (child + 1) * CONTACT_TABLE_HASH_MULTIPLIER;
+
+    return key * CONTACT_TABLE_HASH_MULTIPLIER;
+}
+
+/* 
+    Returns the index of the contact between the bodies at `first` and `second`
+    (along the line segment at `child`) in the entries of `ct`, 
+    or `-1` if there is no such contact.
+*/
+static int prFindContact(const prContactTable *ct,
+                         int first,
+                         int second,
+                         int child) {
+    const int slotCount = arrlen(ct->slots);
+
+    if (slotCount <= 0) return -1;
+
+    const uint64_t key = prGetContactKey(first, second);
+
+    int i = (int) (prGetContactHash(key, child) >> 32) & (slotCount - 1);
+
+    // NOTE: Linear probing!
+    for (; ct->slots[i].index >= 0; i = (i + 1) & (slotCount - 1))
+        if (ct->slots[i].key == key && ct->slots[i].child == child)
+            return ct->slots[i].index;
+
+    return -1;
+}
+
+/* Inserts a new contact `entry` to `ct`. */
+static void prInsertContact(prContactTable *ct, prContactEntry entry) {
+    arrput(ct->entries, entry);
+
+    // NOTE: The load factor of a contact table is always kept below 50%.
+    if (2 * arrlen(ct->entries) > arrlen(ct->slots))
+        prRebuildContactTable(ct);
+    else
+        prPutContactSlot(ct, arrlen(ct->entries) - 1);
+}
+
+/* 
+    Inserts the new contacts of `ct` to `ct` in the order of 
+    the indexes of their bodies (and their children).
+*/
+static void prInsertNewContacts(prContactTable *ct) {
+    /*
+        NOTE: The pairs found in a persistent spatial hash or a dynamic tree
+        are in the order of the updates to the data structure, which is not
+        a part of the saved state of a world, so the order of the new contacts
+        must not depend on the order of the pairs.
+    */
+    if (arrlen(ct->newEntries) > 1)
+        qsort(ct->newEntries,
+              arrlen(ct->newEntries),
+              sizeof *ct->newEntries,
+              prCompareContactEntries);
+
+    for (int i = 0; i < arrlen(ct->newEntries); i++)
+        prInsertContact(ct, ct->newEntries[i]);
+}
+
+/* Compares the indexes of the bodies (and the children) of two contacts. */
+static int prCompareContactEntries(const void *p1, const void *p2) {
+    const prContactEntry *entry1 = p1, *entry2 = p2;
+
+    if (entry1->first != entry2->first)
+        return (entry1->first < entry2->first) ? -1 : 1;
+
+    if (entry1->second != entry2->second)
+        return (entry1->second < entry2->second) ? -1 : 1;
+
+    if (entry1->child != entry2->child)
+        return (entry1->child < entry2->child) ? -1 : 1;
+
+    return 0;
+}
+
+/* Puts the contact at `index` in the entries of `ct` into an empty slot of `ct`. */
+static void prPutContactSlot(prContactTable *ct, int index) {
+    const int slotCount = arrlen(ct->slots);
+
+    const uint64_t key = prGetContactKey(ct->entries[index].first,
+                                         ct->entries[index].second);
+
+    const int child = ct->entries[index].child;
+
+    int i = (int) (prGetContactHash(key, child) >> 32) & (slotCount - 1);
+
+    while (ct->slots[i].index >= 0)
+        i = (i + 1) & (slotCount - 1);
+
+    ct->slots[i] = (prContactSlot) { .key = key, .index = index, .child = child };
+}
+
+/* Rebuilds the slots of `ct` from its entries, skipping the removed contacts. */
+static void prRebuildContactTable(prContactTable *ct) {
+    int slotCount = CONTACT_TABLE_MIN_SLOT_COUNT;
+
+    while (slotCount < 2 * arrlen(ct->entries))
+        slotCount <<= 1;
+
+    arrsetlen(ct->slots, slotCount);
+
+    for (int i = 0; i < slotCount; i++)
+        ct->slots[i].index = -1;
+
+    for (int i = 0; i < arrlen(ct->entries); i++)
+        prPutContactSlot(ct, i);
+}
+
+/* 
+    Removes all contacts that were not found (or kept) in the current generation 
+    of `ct`, without changing the order of the remaining contacts.
+*/
+static void prSweepContactTable(prContactTable *ct) {
+    int count = 0;
+
+    for (int i = 0; i < arrlen(ct->entries); i++) {
+        /*
+            NOTE: This also removes the contacts of the bodies that left 
+            the broad phase, or were removed from the world.
+        */
+        if (ct->entries[i].generation != ct->generation) continue;
+
+        ct->entries[count++] = ct->entries[i];
+    }
+
+    if (count == arrlen(ct->entries)) return;
+
+    arrsetlen(ct->entries, count);
+
+    prRebuildContactTable(ct);
+}
+
+/* Erases all contacts from `ct`. */
+static void prClearContactTable(prContactTable *ct) {
+    arrsetlen(ct->entries, 0), arrsetlen(ct->newEntries, 0);
+
+    prRebuildContactTable(ct);
+}
+
+/* Releases the memory allocated for the arrays of `ct`. */
+static void prReleaseContactTable(prContactTable *ct) {
+    arrfree(ct->entries), arrfree(ct->newEntries), arrfree(ct->slots);
+}
+
+/* 
+    Makes room for the separating axes of `pairCount` pairs of bodies in `w`,
+    forgetting all separating axes of `w` if it has to grow.
+*/
+static void prReserveSeparatingAxes(prWorld *w, int pairCount) {
+    int entryCount = CONTACT_TABLE_MIN_SLOT_COUNT;
+
+    while (entryCount < 2 * pairCount)
+        entryCount <<= 1;
+
+    if (entryCount <= arrlen(w->separatingAxes)) return;
+
+    arrsetlen(w->separatingAxes, entryCount);
+
+    // NOTE: No pair of bodies has the key of zero, since it refers to the same body.
+    for (int i = 0; i < entryCount; i++)
+        w->separatingAxes[i] = (prSeparatingAxisEntry) { .key = 0, .axis = -1 };
+}
+
+/* 
+    Returns the index of the entry for the separating axis of 
+    the bodies at `first` and `second` in `w`.
+*/
+static PR_API_INLINE int prGetSeparatingAxisIndex(const prWorld *w,
+                                                  int first,
+                                                  int second) {
+    const uint64_t key = prGetContactKey(first, second);
+
+    return (int) ((key * CONTACT_TABLE_HASH_MULTIPLIER) >> 32)
+           & (arrlen(w->separatingAxes) - 1);
+}
+
+/* Returns `true` if any body of the contact `entry` was removed from `w`. */
+static PR_API_INLINE bool prIsContactRemoved(const prWorld *w,
+                                             const prContactEntry *entry) {
+    return w->bodies[entry->first] == NULL || w->bodies[entry->second] == NULL;
+}
+
+/* Calls `func` for each contact in `w` whose bodies are still in `w`. */
+static void prRunWorldCollisionEvents(prWorld *w, prCollisionEventFunc func) {
+    if (func == NULL) return;
+
+    /*
+        NOTE: `func` might remove bodies from `w`, which does not modify
+        the contact table, so the entries of the contact table are never moved here.
+    */
+    for (int i = 0; i < arrlen(w->contacts.entries); i++) {
+        prContactEntry *entry = &w->contacts.entries[i];
+
+        if (prIsContactRemoved(w, entry)) continue;
+
+        func((prBodyPair) { .first = w->bodies[entry->first],
+                            .second = w->bodies[entry->second] },
+             &entry->collision);
+    }
+}
+
+/* 
+    A callback function for `prQuerySpatialHashPairs()` 
+    that will be called during `prPreStepWorld()`. 
+*/
+static bool prPreStepHashPairQueryCallback(int firstIndex,
+                                           int secondIndex,
+                                           void *ctx) {
+    prWorld *w = ctx;
+
+    const prBody *b1 = w->bodies[firstIndex], *b2 = w->bodies[secondIndex];
+
+    /*
+        NOTE: Each pair of children of 'compound' bodies has its own contact,
+        unless a sensor body only needs to know whether the bodies overlap.
+    */
+    if ((prIsCompoundBody(b1) || prIsCompoundBody(b2))
+        && !((prGetBodyFlags(b1) | prGetBodyFlags(b2)) & PR_FLAG_SENSOR)) {
+        // NOTE: The children of a pair depend on the order of its bodies.
+        if (firstIndex > secondIndex)
+            return prAddCompoundPairs(w, secondIndex, firstIndex);
+
+        return prAddCompoundPairs(w, firstIndex, secondIndex);
+    }
+
+    return prAddCandidatePair(w, firstIndex, secondIndex, -1);
+}
+
+/* 
+    Adds the pair of the bodies at `first` and `second` in `w` 
+    (along the line segment at `child`) to the candidate pairs of `w`, 
+    unless they cannot collide.
+*/
+static bool prAddCandidatePair(prWorld *w, int first, int second, int child) {
+    prBody *b1 = w->bodies[first], *b2 = w->bodies[second];
+
+    if (prGetBodyInverseMass(b1) + prGetBodyInverseMass(b2) <= 0.0f)
+        return false;
+
+    // NOTE: Filtered pairs never reach the narrow phase.
+    if (!prShouldBodiesCollide(b1, b2)) return false;
+
+    const bool sensor1 = prGetBodyFlags(b1) & PR_FLAG_SENSOR;
+    const bool sensor2 = prGetBodyFlags(b2) & PR_FLAG_SENSOR;
+
+    // NOTE: Sensor bodies do not detect each other.
+    if (sensor1 && sensor2) return false;
+
+    const bool sensor = sensor1 || sensor2;
+
+    /*
+        NOTE: A pair of bodies that are both sleeping (or static) cannot start
+        or stop touching, so their contact will be kept as is in the contact table.
+    */
+    if (!prIsBodyAwake(b1) && !prIsBodyAwake(b2)) {
+        prContactTable *ct = sensor ? &w->sensors.overlaps : &w->contacts;
+
+        const int index = prFindContact(ct, first, second, child);
+
+        if (index >= 0) ct->entries[index].generation = ct->generation;
+
+        return false;
+    }
+
+    int axis = -1;
+
+    /*
+        NOTE: The separating axes of `w` are a lossy cache, where each entry
+        only holds the separating axis of the last pair of bodies stored in it
+        (a pair with a 'chain' body never has a separating axis).
+    */
+    if (child < 0) {
+        const prSeparatingAxisEntry *entry =
+            &w->separatingAxes[prGetSeparatingAxisIndex(w, first, second)];
+
+        if (entry->key == prGetContactKey(first, second)) axis = entry->axis;
+    }
+
+    // NOTE: The narrow phase will be computed later, possibly on multiple threads.
+    arrput(w->pairs,
+           ((prCandidatePair) { .first = first,
+                                .second = second,
+                                .child = child,
+                                .axis = axis,
+                                .sensor = sensor }));
+
+    return true;
+}
+
+/* 
+    Adds each pair of the children of the bodies at `first` and `second` in `w`
+    whose AABBs overlap to the candidate pairs of `w`, assuming either body
+    is a 'compound' body.
+*/
+static bool prAddCompoundPairs(prWorld *w, int first, int second) {
+    const prBody *b1 = w->bodies[first], *b2 = w->bodies[second];
+
+    const int count1 = prGetShapeChildCount(prGetBodyShape(b1));
+    const int count2 = prGetShapeChildCount(prGetBodyShape(b2));
+
+    const prAABB aabb2 = prGetBodyAABB(b2);
+
+    bool result = false;
+
+    for (int i = 0; i < count1; i++) {
+        const prAABB childAABB1 = prGetBodyChildAABB(b1, i);
+
+        if (!prAABBsOverlap(childAABB1, aabb2)) continue;
+
+        for (int j = 0; j < count2; j++) {
+            if (!prAABBsOverlap(childAABB1, prGetBodyChildAABB(b2, j)))
+                continue;
+
+            // NOTE: See `prComputeBodyCollisionWithChild()`.
+            if (prAddCandidatePair(w, first, second, i * count2 + j))
+                result = true;
+        }
+    }
+
+    return result;
+}
+
+/* 
+    A callback function for `prQueryDynamicTree()` 
+    that will be called during `prPreStepWorld()`. 
+*/
+static bool prPreStepHashQueryCallback(int otherBodyIndex, void *ctx) {
+    prPreStepHashQueryCtx *queryCtx = ctx;
+
+    prWorld *w = queryCtx->world;
+
+    const int bodyIndex = queryCtx->bodyIndex;
+
+    if (otherBodyIndex == bodyIndex) return false;
+
+    // NOTE: A pair of bodies that both moved is only added by the lower index.
+    if (w->treePairs.moved[otherBodyIndex] && otherBodyIndex < bodyIndex)
+        return false;
+
+    // NOTE: A pair of static bodies can never collide.
+    if (prGetBodyType(w->bodies[bodyIndex]) == PR_BODY_STATIC
+        && prGetBodyType(w->bodies[otherBodyIndex]) == PR_BODY_STATIC)
+        return false;
+
+    const int first = (bodyIndex < otherBodyIndex) ? bodyIndex : otherBodyIndex;
+    const int second = (bodyIndex < otherBodyIndex) ? otherBodyIndex : bodyIndex;
+
+    arrput(w->treePairs.pairs,
+           ((prTreePair) { .first = first, .second = second }));
+
+    return true;
+}
+
+/* 
+    A callback function for `prQueryChain()` 
+    that will be called during `prPreStepWorld()`. 
+*/
+static bool prPreStepChainQueryCallback(int segmentIndex, void *ctx) {
+    prPreStepChainQueryCtx *queryCtx = ctx;
+
+    // NOTE: See `prComputeBodyCollisionWithChild()`.
+    return prAddCandidatePair(queryCtx->world,
+                              queryCtx->bodyIndex,
+                              queryCtx->chainIndex,
+                              queryCtx->childIndex * queryCtx->segmentCount
+                                  + segmentIndex);
+}
+
+/* 
+    Adds each line segment of the 'chain' body at `chainIndex` in `w` 
+    that the AABB of the awake body at `bodyIndex` overlaps
+    to the candidate pairs of `w`.
+*/
+static void prAddChainPairs(prWorld *w, int bodyIndex, int chainIndex) {
+    const prBody *chain = w->bodies[chainIndex], *b = w->bodies[bodyIndex];
+
+    // NOTE: Sensor bodies do not detect 'chain' bodies.
+    if ((prGetBodyFlags(b) | prGetBodyFlags(chain)) & PR_FLAG_SENSOR) return;
+
+    const prAABB chainAABB = prGetBodyAABB(chain);
+
+    if (!prAABBsOverlap(chainAABB, prGetBodyAABB(b))) return;
+
+    prPreStepChainQueryCtx queryCtx = {
+        .world = w,
+        .bodyIndex = bodyIndex,
+        .chainIndex = chainIndex,
+        .segmentCount = prGetShapeChildCount(prGetBodyShape(chain))
+    };
+
+    // NOTE: Each child of a 'compound' body queries the chain on its own.
+    for (int i = 0; i < prGetShapeChildCount(prGetBodyShape(b)); i++) {
+        const prAABB aabb = prGetBodyChildAABB(b, i);
+
+        if (!prAABBsOverlap(chainAABB, aabb)) continue;
+
+        queryCtx.childIndex = i;
+
+        prQueryChain(prGetBodyShape(chain),
+                     prGetBodyTransform(chain),
+                     aabb,
+                     prPreStepChainQueryCallback,
+                     &queryCtx);
+    }
+}
+
+/* Compares the indexes of the bodies (and the children) of two candidate pairs. */
+static int prCompareCandidatePairs(const void *p1, const void *p2) {
+    const prCandidatePair *pair1 = p1, *pair2 = p2;
+
+    if (pair1->first != pair2->first)
+        return (pair1->first < pair2->first) ? -1 : 1;
+
+    if (pair1->second != pair2->second)
+        return (pair1->second < pair2->second) ? -1 : 1;
+
+    if (pair1->child != pair2->child)
+        return (pair1->child < pair2->child) ? -1 : 1;
+
+    return 0;
+}
+
+/* 
+    A callback function for `prRaycastSpatialHash()` and `prRaycastDynamicTree()`
+    that will be called during `prComputeRaycastForWorld()`
+    and `prComputeRaycastsForWorld()`.
+*/
+static float prRaycastHashQueryCallback(int bodyIndex, void *ctx) {
+    prRaycastHashQueryCtx *queryCtx = ctx;
+
+    prRaycastHit raycastHit = { .distance = 0.0f };
+
+    if (!prComputeRaycast(queryCtx->world->bodies[bodyIndex],
+                          queryCtx->ray,
+                          &raycastHit))
+        return queryCtx->ray.maxDistance;
+
+    if (queryCtx->func != NULL) {
+        queryCtx->func(raycastHit);
+
+        return queryCtx->ray.maxDistance;
+    }
+
+    if (queryCtx->hit.body == NULL
+        || queryCtx->hit.distance > raycastHit.distance)
+        queryCtx->hit = raycastHit;
+
+    if (queryCtx->mode == PR_RAYCAST_ANY) return 0.0f;
+
+    // NOTE: Any hit farther than the closest hit so far can be skipped.
+    queryCtx->ray.maxDistance = queryCtx->hit.distance;
+
+    return queryCtx->ray.maxDistance;
+}
+
+/* Casts `queryCtx->ray` against the broad-phase data structure of `w`. */
+static void prRaycastWorldBroadPhase(prWorld *w,
+                                     prRaycastHashQueryCtx *queryCtx) {
+    if (w->tree != NULL)
+        prRaycastDynamicTree(w->tree,
+                             queryCtx->ray,
+                             prRaycastHashQueryCallback,
+                             queryCtx);
+    else
+        prRaycastSpatialHash(w->hash,
+                             queryCtx->ray,
+                             prRaycastHashQueryCallback,
+                             queryCtx);
+
+    // NOTE: 'Chain' bodies are not in the broad-phase data structure.
+    for (int i = 0; i < arrlen(w->chains); i++) {
+        if (w->bodies[w->chains[i]] == NULL) continue;
+
+        if (prRaycastHashQueryCallback(w->chains[i], queryCtx) <= 0.0f) break;
+    }
+}
+
+/* 
+    A callback function for `prQuerySpatialHash()` and `prQueryDynamicTree()`
+    that will be called during `prQueryWorldAABB()`.
+*/
+static bool prAABBHashQueryCallback(int bodyIndex, void *ctx) {
+    prBodyHashQueryCtx *queryCtx = ctx;
+
+    prBody *b = queryCtx->world->bodies[bodyIndex];
+
+    // NOTE: The broad phase may report bodies that are merely nearby.
+    if (!prAABBsOverlap(prGetBodyAABB(b), queryCtx->aabb)) return false;
+
+    if (queryCtx->count < queryCtx->capacity)
+        queryCtx->bodies[queryCtx->count] = b;
+
+    queryCtx->count++;
+
+    return true;
+}
+
+/* 
+    A callback function for `prQuerySpatialHash()` and `prQueryDynamicTree()`
+    that will be called during `prQueryWorldPoint()`.
+*/
+static bool prPointHashQueryCallback(int bodyIndex, void *ctx) {
+    prBodyHashQueryCtx *queryCtx = ctx;
+
+    prBody *b = queryCtx->world->bodies[bodyIndex];
+
+    if (!prBodyContainsPoint(b, queryCtx->point)) return false;
+
+    if (queryCtx->count < queryCtx->capacity)
+        queryCtx->bodies[queryCtx->count] = b;
+
+    queryCtx->count++;
+
+    return true;
+}
+
+/* 
+    A callback function for `prQuerySpatialHash()` and `prQueryDynamicTree()`
+    that will be called during `prComputeShapeCastForWorld()`.
+*/
+static bool prShapeCastHashQueryCallback(int bodyIndex, void *ctx) {
+    prShapeCastHashQueryCtx *queryCtx = ctx;
+
+    prBody *b = queryCtx->world->bodies[bodyIndex];
+
+    // NOTE: A swept bullet only hits the bodies it is allowed to collide with.
+    if (queryCtx->ignoredBody != NULL
+        && (b == queryCtx->ignoredBody || (prGetBodyFlags(b) & PR_FLAG_SENSOR)
+            || !prShouldBodiesCollide(queryCtx->ignoredBody, b)))
+        return false;
+
+    prShapeCastHit hit = { .fraction = 0.0f };
+
+    if (!prComputeShapeCast(queryCtx, b, &hit)) return false;
+
+    int index = (queryCtx->count < queryCtx->capacity) ? queryCtx->count
+                                                       : queryCtx->capacity;
+
+    queryCtx->count++;
+
+    // NOTE: Keeps the closest hits sorted, dropping the farthest one if full.
+    if (index == queryCtx->capacity) {
+        if (index == 0 || queryCtx->hits[index - 1].fraction <= hit.fraction)
+            return true;
+
+        index--;
+    }
+
+    for (; index > 0 && queryCtx->hits[index - 1].fraction > hit.fraction;
+         index--)
+        queryCtx->hits[index] = queryCtx->hits[index - 1];
+
+    queryCtx->hits[index] = hit;
+
+    return true;
+}
+
+/* 
+    Sweeps the shape of `queryCtx` against `b`, then stores 
+    the earliest hit to `hit` (if any).
+*/
+static bool prComputeShapeCast(const prShapeCastHashQueryCtx *queryCtx,
+                               prBody *b,
+                               prShapeCastHit *hit) {
+    const prAABB aabb1 = queryCtx->aabb, aabb2 = prGetBodyAABB(b);
+
+    const float minValues[2] = { aabb2.x - (aabb1.x + aabb1.width),
+                                 aabb2.y - (aabb1.y + aabb1.height) };
+    const float maxValues[2] = { (aabb2.x + aabb2.width) - aabb1.x,
+                                 (aabb2.y + aabb2.height) - aabb1.y };
+
+    const float deltas[2] = { queryCtx->translation.x,
+                              queryCtx->translation.y };
+
+    float minFraction = 0.0f, maxFraction = 1.0f;
+
+    /*
+        NOTE: The shape cannot hit `b` before (or after) the AABB of the shape
+        starts (or stops) overlapping the AABB of `b` during the sweep.
+    */
+    for (int i = 0; i < 2; i++) {
+        if (deltas[i] == 0.0f) {
+            if (minValues[i] > 0.0f || maxValues[i] < 0.0f) return false;
+
+            continue;
+        }
+
+        float fraction1 = minValues[i] / deltas[i];
+        float fraction2 = maxValues[i] / deltas[i];
+
+        if (fraction1 > fraction2) {
+            const float temp = fraction1;
+
+            fraction1 = fraction2, fraction2 = temp;
+        }
+
+        if (minFraction < fraction1) minFraction = fraction1;
+        if (maxFraction > fraction2) maxFraction = fraction2;
+
+        if (minFraction > maxFraction) return false;
+    }
+
+    const prShape *s = prGetBodyShape(b);
+
+    const prTransform tx = prGetBodyTransform(b);
+
+    /*
+        NOTE: A shape crossing `b` overlaps it for at least half of the smallest
+        width of both shapes (not of their AABBs, which are much wider for 
+        rotated, thin shapes), which is how far it may move between two samples.
+    */
+    const float width1 = prGetShapeMinWidth(queryCtx->shape);
+    const float width2 = prGetShapeMinWidth(s);
+
+    float stepSize = 0.5f
+                     * ((width1 > 0.0f && width2 > 0.0f)
+                            ? fminf(width1, width2)
+                            : fmaxf(width1, width2));
+
+    prCollision collision = { .count = 0 };
+
+    float lowerFraction = minFraction, upperFraction = -1.0f;
+
+    /*
+        NOTE: The distance between two convex pieces moving along a line
+        shrinks no faster than they approach each other, so the shape can
+        always advance by that distance without skipping over `b`, however long
+        the sweep is. (A small tolerance keeps it from stopping just short
+        of `b` forever.)
+    */
+    if (prIsShapeCastConvex(queryCtx->shape)
+        && (prGetShapeType(s) == PR_SHAPE_CHAIN || prIsShapeCastConvex(s))) {
+        float fraction = minFraction;
+
+        for (int i = 0; i < SHAPE_CAST_MAX_ADVANCE_COUNT; i++) {
+            if (prComputeShapeCastSample(queryCtx, s, tx, fraction, &collision)) {
+                upperFraction = fraction;
+
+                break;
+            }
+
+            lowerFraction = fraction;
+
+            if (fraction >= maxFraction) return false;
+
+            const float advance = prComputeShapeCastAdvance(queryCtx,
+                                                            s,
+                                                            tx,
+                                                            fraction,
+                                                            maxFraction,
+                                                            0.01f * stepSize);
+
+            if (advance == FLT_MAX) return false;
+
+            fraction = fminf(fraction + advance, maxFraction);
+        }
+    }
+
+    /*
+        NOTE: The shape moves at most `stepSize` between two samples for 
+        'chain' shapes (and for the rest of a sweep that conservative advancement
+        could not finish), up to a fixed number of samples per sweep.
+    */
+    if (upperFraction < 0.0f) {
+        const float distance = (maxFraction - lowerFraction)
+                               * prVector2Magnitude(queryCtx->translation);
+
+        int sampleCount = (stepSize > 0.0f)
+                              ? (int) fminf(ceilf(distance / stepSize),
+                                            SHAPE_CAST_MAX_SAMPLE_COUNT)
+                              : 1;
+
+        if (sampleCount < 1) sampleCount = 1;
+
+        const float startFraction = lowerFraction;
+
+        for (int i = 0; i <= sampleCount; i++) {
+            const float fraction = startFraction
+                                   + (maxFraction - startFraction)
+                                         * ((float) i / sampleCount);
+
+            if (prComputeShapeCastSample(queryCtx, s, tx, fraction, &collision)) {
+                upperFraction = fraction;
+
+                break;
+            }
+
+            lowerFraction = fraction;
+        }
+    }
+
+    if (upperFraction < 0.0f) return false;
+
+    // NOTE: Bullets leave the bodies they already touch to the solver.
+    if (upperFraction <= 0.0f && queryCtx->ignoresOverlaps) return false;
+
+    // NOTE: The first sample may already be overlapping `b`.
+    for (int i = 0; i < SHAPE_CAST_ITERATION_COUNT; i++) {
+        if (upperFraction <= lowerFraction) break;
+
+        const float fraction = 0.5f * (lowerFraction + upperFraction);
+
+        prCollision sampleCollision = { .count = 0 };
+
+        if (prComputeShapeCastSample(queryCtx, s, tx, fraction, &sampleCollision))
+            upperFraction = fraction, collision = sampleCollision;
+        else
+            lowerFraction = fraction;
+    }
+
+    hit->body = b;
+    hit->point = collision.contacts[0].point;
+    hit->normal = collision.direction;
+    hit->fraction = upperFraction;
+
+    return true;
+}
+
+/* 
+    Moves the shape of `queryCtx` to `fraction` along its translation, 
+    then stores the collision between the shape and `s` with the transform `tx`
+    to `collision` (if any).
+*/
+static bool prComputeShapeCastSample(const prShapeCastHashQueryCtx *queryCtx,
+                                     const prShape *s,
+                                     prTransform tx,
+                                     float fraction,
+                                     prCollision *collision) {
+    prTransform sampleTx = queryCtx->tx;
+
+    sampleTx.position = prVector2Add(
+        sampleTx.position,
+        prVector2ScalarMultiply(queryCtx->translation, fraction));
+
+    return prComputeCollision(queryCtx->shape, sampleTx, s, tx, collision);
+}
+
+/* 
+    Returns how far (as a fraction of its translation) the shape of `queryCtx` 
+    at `fraction` can move towards `s` with the transform `tx` without penetrating
+    `s` deeper than `tolerance`, or `FLT_MAX` if it does not move towards `s`.
+*/
+static float prComputeShapeCastAdvance(const prShapeCastHashQueryCtx *queryCtx,
+                                       const prShape *s,
+                                       prTransform tx,
+                                       float fraction,
+                                       float maxFraction,
+                                       float tolerance) {
+    prTransform sampleTx = queryCtx->tx;
+
+    sampleTx.position = prVector2Add(
+        sampleTx.position,
+        prVector2ScalarMultiply(queryCtx->translation, fraction));
+
+    prShapeCastAdvanceCtx advanceCtx = { .shape = s,
+                                         .tx = tx,
+                                         .translation = queryCtx->translation,
+                                         .tolerance = tolerance,
+                                         .advance = FLT_MAX };
+
+    const bool isChain = (prGetShapeType(s) == PR_SHAPE_CHAIN);
+
+    // NOTE: Only the line segments along the rest of the sweep can be hit.
+    const prAABB aabb = isChain
+                            ? prGetSweptAABB(
+                                  prGetShapeAABB(queryCtx->shape, sampleTx),
+                                  prVector2ScalarMultiply(queryCtx->translation,
+                                                          maxFraction
+                                                              - fraction))
+                            : PR_API_STRUCT_ZERO(prAABB);
+
+    for (int i = 0; i < prGetShapeChildCount(queryCtx->shape); i++) {
+        prShapeCastPiece piece1;
+
+        prGetShapeCastPiece(queryCtx->shape, sampleTx, i, &piece1);
+
+        advanceCtx.piece = &piece1;
+
+        if (isChain) {
+            prQueryChain(s, tx, aabb, prShapeCastChainQueryCallback, &advanceCtx);
+
+            continue;
+        }
+
+        for (int j = 0; j < prGetShapeChildCount(s); j++) {
+            prShapeCastPiece piece2;
+
+            prGetShapeCastPiece(s, tx, j, &piece2);
+
+            prUpdateShapeCastAdvance(&advanceCtx, &piece2);
+        }
+    }
+
+    return advanceCtx.advance;
+}
+
+/* 
+    A callback function for `prQueryChain()`
+    that will be called during `prComputeShapeCastAdvance()`.
+*/
+static bool prShapeCastChainQueryCallback(int segmentIndex, void *ctx) {
+    prShapeCastAdvanceCtx *advanceCtx = ctx;
+
+    const prShape *s = advanceCtx->shape;
+
+    const int vertexCount = prGetChainVertexCount(s);
+
+    prShapeCastPiece piece = { .vertices.count = 2, .radius = 0.0f };
+
+    piece.vertices.data[0] = prVector2Transform(prGetChainVertex(s, segmentIndex),
+                                                advanceCtx->tx);
+    piece.vertices.data[1] = prVector2Transform(
+        prGetChainVertex(s, (segmentIndex + 1) % vertexCount), advanceCtx->tx);
+
+    prUpdateShapeCastAdvance(advanceCtx, &piece);
+
+    return true;
+}
+
+/* 
+    Updates the advance of `advanceCtx` with the distance between 
+    the piece of `advanceCtx` and `piece`.
+*/
+static void prUpdateShapeCastAdvance(prShapeCastAdvanceCtx *advanceCtx,
+                                     const prShapeCastPiece *piece) {
+    prVector2 direction = PR_API_STRUCT_ZERO(prVector2);
+
+    const float distance = prComputeShapeCastPieceDistance(advanceCtx->piece,
+                                                           piece,
+                                                           &direction);
+
+    // NOTE: Touching pieces are nudged along the sweep by the tolerance.
+    if (distance <= 0.0f)
+        direction = prVector2Normalize(advanceCtx->translation);
+
+    const float approach = prVector2Dot(advanceCtx->translation, direction);
+
+    if (approach <= 0.0f) return;
+
+    advanceCtx->advance = fminf(advanceCtx->advance,
+                                (distance + advanceCtx->tolerance) / approach);
+}
+
+/* 
+    Returns `true` if `s` only consists of convex pieces, 
+    which is the case for a 'circle' or a 'polygon' collision shape,
+    or a 'compound' collision shape without any other children.
+*/
+static bool prIsShapeCastConvex(const prShape *s) {
+    switch (prGetShapeType(s)) {
+        case PR_SHAPE_CIRCLE:
+        case PR_SHAPE_POLYGON:
+            return true;
+
+        case PR_SHAPE_COMPOUND:
+            for (int i = 0; i < prGetShapeChildCount(s); i++) {
+                const prShapeType type = prGetShapeType(prGetCompoundChild(s, i));
+
+                if (type != PR_SHAPE_CIRCLE && type != PR_SHAPE_POLYGON)
+                    return false;
+            }
+
+            return true;
+
+        default:
+            return false;
+    }
+}
+
+/* 
+    Stores the child of `s` with the given `index` and the transform `tx` 
+    to `piece`, assuming `prIsShapeCastConvex(s)` is `true`.
+*/
+static void prGetShapeCastPiece(const prShape *s,
+                                prTransform tx,
+                                int index,
+                                prShapeCastPiece *piece) {
+    if (prGetShapeType(s) == PR_SHAPE_COMPOUND)
+        tx = prGetCompoundChildTransform(s, index, tx),
+        s = prGetCompoundChild(s, index);
+
+    if (prGetShapeType(s) == PR_SHAPE_CIRCLE) {
+        piece->vertices.data[0] = tx.position, piece->vertices.count = 1;
+        piece->radius = prGetCircleRadius(s);
+    } else {
+        prVertices normals = { .count = 0 };
+
+        prTransformPolygon(s, tx, &piece->vertices, &normals);
+
+        piece->radius = 0.0f;
+    }
+}
+
+/* 
+    Returns the distance between `p1` and `p2`, then stores
+    the direction from the closest point of `p1` to that of `p2` to `direction`.
+*/
+static float prComputeShapeCastPieceDistance(const prShapeCastPiece *p1,
+                                             const prShapeCastPiece *p2,
+                                             prVector2 *direction) {
+    const prVector2 delta = prVector2Subtract(p2->vertices.data[0],
+                                              p1->vertices.data[0]);
+
+    float minDistance = prVector2Magnitude(delta);
+
+    if (minDistance > 0.0f)
+        *direction = prVector2ScalarMultiply(delta, 1.0f / minDistance);
+
+    /*
+        NOTE: The closest points of two separated convex pieces are 
+        a vertex of one of them and a point on an edge of the other
+        (or a vertex of each, for a circle or a line segment).
+    */
+    for (int k = 0; k < 2; k++) {
+        const prShapeCastPiece *from = (k == 0) ? p1 : p2;
+        const prShapeCastPiece *to = (k == 0) ? p2 : p1;
+
+        const int count = to->vertices.count;
+
+        const int edgeCount = (count > 2) ? count : count - 1;
+
+        for (int i = 0; i < from->vertices.count; i++) {
+            for (int j = 0; j < edgeCount; j++) {
+                prVector2 edgeDirection = PR_API_STRUCT_ZERO(prVector2);
+
+                const float distance = prComputeSegmentDistance(
+                    to->vertices.data[j],
+                    to->vertices.data[(j + 1) % count],
+                    from->vertices.data[i],
+                    &edgeDirection);
+
+                if (distance >= minDistance) continue;
+
+                minDistance = distance;
+
+                *direction = (k == 0) ? edgeDirection
+                                      : prVector2Negate(edgeDirection);
+            }
+        }
+    }
+
+    return fmaxf(minDistance - (p1->radius + p2->radius), 0.0f);
+}
+
+/* 
+    Returns the distance from `p` to the line segment from `v1` to `v2`, then 
+    stores the direction from `p` to the closest point on the segment to `direction`.
+*/
+static float prComputeSegmentDistance(prVector2 v1,
+                                      prVector2 v2,
+                                      prVector2 p,
+                                      prVector2 *direction) {
+    const prVector2 edge = prVector2Subtract(v2, v1);
+
+    const prVector2 relativePosition = prVector2Subtract(p, v1);
+
+    const float lengthSqr = prVector2MagnitudeSqr(edge);
+
+    const float t = (lengthSqr > 0.0f)
+                        ? prVector2Dot(relativePosition, edge) / lengthSqr
+                        : 0.0f;
+
+    /*
+        NOTE: The direction to the inside of a long edge comes from its normal,
+        not from the closest point, which is far less precise when the edge is 
+        much longer than the distance to it.
+    */
+    if (t > 0.0f && t < 1.0f) {
+        const prVector2 normal = prVector2LeftNormal(edge);
+
+        const float distance = prVector2Dot(relativePosition, normal);
+
+        *direction = (distance > 0.0f) ? prVector2Negate(normal) : normal;
+
+        return fabsf(distance);
+    }
+
+    const prVector2 delta = prVector2Subtract((t > 0.0f) ? v2 : v1, p);
+
+    const float distance = prVector2Magnitude(delta);
+
+    if (distance > 0.0f)
+        *direction = prVector2ScalarMultiply(delta, 1.0f / distance);
+
+    return distance;
+}
+
+/* Returns the AABB that covers `aabb` moving along `translation`. */
+static PR_API_INLINE prAABB prGetSweptAABB(prAABB aabb, prVector2 translation) {
+    return (prAABB) { .x = aabb.x + fminf(translation.x, 0.0f),
+                      .y = aabb.y + fminf(translation.y, 0.0f),
+                      .width = aabb.width + fabsf(translation.x),
+                      .height = aabb.height + fabsf(translation.y) };
+}
+
+/* 
+    Returns the smallest width of `s` in any direction, or `0` if `s` is 
+    a 'chain' collision shape (since its line segments have no width).
+*/
+static float prGetShapeMinWidth(const prShape *s) {
+    switch (prGetShapeType(s)) {
+        case PR_SHAPE_CIRCLE:
+            return 2.0f * prGetCircleRadius(s);
+
+        case PR_SHAPE_POLYGON: {
+            const prVertices *vertices = prGetPolygonVertices(s);
+            const prVertices *normals = prGetPolygonNormals(s);
+
+            float result = FLT_MAX;
+
+            // NOTE: A convex polygon is the thinnest along one of its normals.
+            for (int i = 0; i < normals->count; i++) {
+                float minValue = FLT_MAX, maxValue = -FLT_MAX;
+
+                for (int j = 0; j < vertices->count; j++) {
+                    const float value = prVector2Dot(vertices->data[j],
+                                                     normals->data[i]);
+
+                    minValue = fminf(minValue, value);
+                    maxValue = fmaxf(maxValue, value);
+                }
+
+                result = fminf(result, maxValue - minValue);
+            }
+
+            return result;
+        }
+
+        case PR_SHAPE_COMPOUND: {
+            float result = FLT_MAX;
+
+            // NOTE: Crossing any child of a compound shape is a hit.
+            for (int i = 0; i < prGetShapeChildCount(s); i++)
+                result = fminf(result,
+                               prGetShapeMinWidth(prGetCompoundChild(s, i)));
+
+            return result;
+        }
+
+        default:
+            return 0.0f;
+    }
+}
+
+/* Query the broad-phase data structure of `w` for any bodies overlapping `aabb`. */
+static void prQueryWorldBroadPhase(prWorld *w,
+                                   prAABB aabb,
+                                   prHashQueryFunc func,
+                                   void *ctx) {
+    if (w->tree != NULL)
+        prQueryDynamicTree(w->tree, aabb, func, ctx);
+    else
+        prQuerySpatialHash(w->hash, aabb, func, ctx);
+
+    // NOTE: 'Chain' bodies are not in the broad-phase data structure.
+    for (int i = 0; i < arrlen(w->chains); i++) {
+        const prBody *b = w->bodies[w->chains[i]];
+
+        if (b != NULL && prAABBsOverlap(prGetBodyAABB(b), aabb))
+            func(w->chains[i], ctx);
+    }
+}
+
+/* 
+    A callback function for `prRunThreadPool()` 
+    that computes the collision for each candidate pair in the range `[start, end)`.
+*/
+static void prComputeCandidatePairs(int start,
+                                    int end,
+                                    int threadIndex,
+                                    void *ctx) {
+    prWorld *w = ctx;
+
+    /*
+        NOTE: Each thread only writes to its own range of `w->pairs`,
+        and nothing else is modified until all threads are done.
+    */
+    for (int i = start; i < end; i++) {
+        prCandidatePair *pair = &w->pairs[i];
+
+        prBody *b1 = w->bodies[pair->first], *b2 = w->bodies[pair->second];
+
+        pair->collision = PR_API_STRUCT_ZERO(prCollision);
+
+        // NOTE: Sensor pairs only need to know whether the bodies overlap.
+        prCollision *collision = pair->sensor ? NULL : &pair->collision;
+
+        // NOTE: The bodies already hold the world-space vertices of their shapes.
+        if (pair->child >= 0)
+            pair->colliding = prComputeBodyCollisionWithChild(b1,
+                                                              b2,
+                                                              pair->child,
+                                                              collision);
+        else
+            pair->colliding = prComputeBodyCollisionWithAxis(b1,
+                                                             b2,
+                                                             collision,
+                                                             &pair->axis);
+    }
+}
+
+/* Merges the collision of each candidate pair of `w` into the contact table of `w`. */
+static void prMergeCandidatePairs(prWorld *w) {
+    prContactTable *ct = &w->contacts, *ot = &w->sensors.overlaps;
+
+    arrsetlen(w->sensors.beginEvents, 0), arrsetlen(w->sensors.endEvents, 0);
+
+    arrsetlen(ct->newEntries, 0), arrsetlen(ot->newEntries, 0);
+
+    for (int i = 0; i < arrlen(w->pairs); i++) {
+        const int first = w->pairs[i].first, second = w->pairs[i].second;
+        const int child = w->pairs[i].child;
+
+        // NOTE: Only a pair of polygons has a separating axis.
+        if (w->pairs[i].axis >= 0) {
+            const int index = prGetSeparatingAxisIndex(w, first, second);
+
+            w->separatingAxes[index] = (prSeparatingAxisEntry) {
+                .key = prGetContactKey(first, second), .axis = w->pairs[i].axis
+            };
+        }
+
+        // NOTE: Contacts that are not found again will be removed in bulk.
+        if (!w->pairs[i].colliding) continue;
+
+        if (w->pairs[i].sensor) {
+            prMergeSensorPair(w, &w->pairs[i]);
+
+            continue;
+        }
+
+        prBody *b1 = w->bodies[first], *b2 = w->bodies[second];
+
+        // NOTE: An awake body will wake up any sleeping body it touches.
+        if (prIsBodySleeping(b1) && prIsBodyAwake(b2))
+            prSetBodySleeping(b1, false);
+        else if (prIsBodySleeping(b2) && prIsBodyAwake(b1))
+            prSetBodySleeping(b2, false);
+
+        prCollision collision = w->pairs[i].collision;
+
+        const int index = prFindContact(ct, first, second, child);
+
+        if (index >= 0) {
+            prContactEntry *entry = &ct->entries[index];
+
+            collision.friction = entry->collision.friction;
+            collision.restitution = entry->collision.restitution;
+
+            for (int j = 0; j < collision.count; j++) {
+                int k = -1;
+
+                for (int l = 0; l < entry->collision.count; l++) {
+                    const int id = entry->collision.contacts[l].id;
+
+                    if (collision.contacts[j].id == id) {
+                        k = l;
+
+                        break;
+                    }
+                }
+
+                if (k >= 0) {
+                    const float accNormalScalar = entry->collision.contacts[k]
+                                                      .cache.normalScalar;
+                    const float accTangentScalar = entry->collision.contacts[k]
+                                                       .cache.tangentScalar;
+
+                    collision.contacts[j].cache.normalScalar = accNormalScalar;
+                    collision.contacts[j].cache.tangentScalar = accTangentScalar;
+                } else {
+                    collision.contacts[j].cache.normalScalar = 0.0f;
+                    collision.contacts[j].cache.tangentScalar = 0.0f;
+                }
+            }
+
+            entry->first = first, entry->second = second;
+            entry->generation = ct->generation;
+            entry->collision = collision;
+        } else {
+            prMixCollisionMaterials(&collision, b1, b2);
+
+            arrput(ct->newEntries,
+                   ((prContactEntry) { .first = first,
+                                       .second = second,
+                                       .child = child,
+                                       .generation = ct->generation,
+                                       .collision = collision }));
+        }
+    }
+
+    prInsertNewContacts(ct), prInsertNewContacts(ot);
+
+    // NOTE: The begin events are reported in the order of the new sensor overlaps.
+    for (int i = 0; i < arrlen(ot->newEntries); i++)
+        arrput(w->sensors.beginEvents,
+               prGetSensorEvent(w,
+                                ot->newEntries[i].first,
+                                ot->newEntries[i].second));
+
+    prSweepContactTable(ct);
+
+    prSweepSensorOverlaps(w);
+}
+
+/* 
+    Merges the overlap of a candidate `pair` with a sensor body into 
+    the sensor overlaps of `w`, deferring each new overlap to the end of the merge.
+*/
+static void prMergeSensorPair(prWorld *w, const prCandidatePair *pair) {
+    prContactTable *ct = &w->sensors.overlaps;
+
+    const int index = prFindContact(ct, pair->first, pair->second, pair->child);
+
+    if (index >= 0) {
+        ct->entries[index].generation = ct->generation;
+
+        return;
+    }
+
+    arrput(ct->newEntries,
+           ((prContactEntry) { .first = pair->first,
+                               .second = pair->second,
+                               .child = pair->child,
+                               .generation = ct->generation }));
+}
+
+/* Reports an end event for each sensor overlap of `w` that was not found again. */
+static void prSweepSensorOverlaps(prWorld *w) {
+    prContactTable *ct = &w->sensors.overlaps;
+
+    for (int i = 0; i < arrlen(ct->entries); i++) {
+        const prContactEntry *entry = &ct->entries[i];
+
+        // NOTE: There are no end events for the bodies removed from `w`.
+        if (entry->generation == ct->generation || prIsContactRemoved(w, entry))
+            continue;
+
+        arrput(w->sensors.endEvents,
+               prGetSensorEvent(w, entry->first, entry->second));
+    }
+
+    prSweepContactTable(ct);
+}
+
+/* Returns the event for the sensor overlap of the bodies at `first` and `second` in `w`. */
+static prBodyPair prGetSensorEvent(const prWorld *w, int first, int second) {
+    prBody *b1 = w->bodies[first], *b2 = w->bodies[second];
+
+    if (prGetBodyFlags(b1) & PR_FLAG_SENSOR)
+        return (prBodyPair) { .first = b1, .second = b2 };
+    else
+        return (prBodyPair) { .first = b2, .second = b1 };
+}
+
+/* Mixes the materials of `b1` and `b2` into the friction and restitution of `collision`. */
+static void prMixCollisionMaterials(prCollision *collision,
+                                    const prBody *b1,
+                                    const prBody *b2) {
+    // NOTE: Bodies sharing a collision shape may still have different materials.
+    const prMaterial m1 = prGetBodyMaterial(b1), m2 = prGetBodyMaterial(b2);
+
+    collision->friction = 0.5f * (m1.friction + m2.friction);
+    collision->restitution = fminf(m1.restitution, m2.restitution);
+
+    if (collision->friction <= 0.0f) collision->friction = 0.0f;
+    if (collision->restitution <= 0.0f) collision->restitution = 0.0f;
+}
+
+/* Returns the root of the island node with the given `index` in `ci`. */
+static int prFindIslandRoot(prContactIslands *ci, int index) {
+    while (ci->parents[index] != index) {
+        // NOTE: Path halving!
+        ci->parents[index] = ci->parents[ci->parents[index]];
+
+        index = ci->parents[index];
+    }
+
+    return index;
+}
+
+/* Copies the motion data of each body in `w` to the body storage of `w`. */
+static void prLoadWorldBodies(prWorld *w) {
+    prResizeBodyStorage(&w->storage, arrlen(w->bodies));
+
+    // NOTE: The body storage index of each body is the same as its index in `w`.
+    for (int i = 0; i < arrlen(w->bodies); i++)
+        prLoadBodyToStorage(&w->storage, i, w->bodies[i]);
+}
+
+/* Copies the motion data in the body storage of `w` back to each body in `w`. */
+static void prStoreWorldBodies(prWorld *w) {
+    for (int i = 0; i < arrlen(w->bodies); i++)
+        if (w->bodies[i] != NULL)
+            prStoreBodyFromStorage(&w->storage, i, w->bodies[i]);
+}
+
+/* Returns the index of an empty slot for a new body in `w`. */
+static int prAllocateWorldSlot(prWorld *w) {
+    if (arrlen(w->slots.freeIndexes) > 0) return arrpop(w->slots.freeIndexes);
+
+    // NOTE: A generation of zero never refers to any body.
+    arrput(w->bodies, NULL), arrput(w->slots.generations, 1);
+    arrput(w->slots.sparse, -1);
+
+    return arrlen(w->bodies) - 1;
+}
+
+/* 
+    Allows the slots of the bodies removed from `w` to be reused,
+    once no contacts refer to them anymore.
+*/
+static void prRecycleWorldSlots(prWorld *w) {
+    while (arrlen(w->slots.removedIndexes) > 0)
+        arrput(w->slots.freeIndexes, arrpop(w->slots.removedIndexes));
+}
+
+/* Wakes up each sleeping body of `w` that shares an island with an awake body. */
+static void prWakeContactIslands(prWorld *w) {
+    if (!w->sleeping.enabled) return;
+
+    prContactIslands *ci = &w->islands;
+
+    const prContactEntry *entries = w->contacts.entries;
+
+    const int bodyCount = arrlen(w->bodies), contactCount = arrlen(entries);
+
+    // NOTE: Each island node is the index of a body, and each root marks an awake island.
+    arrsetlen(ci->parents, bodyCount), arrsetlen(ci->roots, bodyCount);
+
+    for (int i = 0; i < bodyCount; i++)
+        ci->parents[i] = i, ci->roots[i] = 0;
+
+    /*
+        NOTE: Unlike `prBuildContactIslands()`, this walks through the contacts
+        of sleeping bodies, so a body that woke up (from a contact, a setter or
+        a bullet hit) wakes up the whole pile of bodies it is resting on.
+    */
+    for (int i = 0; i < contactCount; i++) {
+        if (prIsContactRemoved(w, &entries[i])) continue;
+
+        const int index1 = entries[i].first, index2 = entries[i].second;
+
+        // NOTE: Bodies with infinite mass do not connect islands.
+        if (prGetBodyInverseMass(w->bodies[index1]) <= 0.0f
+            || prGetBodyInverseMass(w->bodies[index2]) <= 0.0f)
+            continue;
+
+        const int node1 = prFindIslandRoot(ci, index1);
+        const int node2 = prFindIslandRoot(ci, index2);
+
+        if (node1 < node2) ci->parents[node2] = node1;
+        else if (node2 < node1) ci->parents[node1] = node2;
+    }
+
+    bool awake = false;
+
+    for (int i = 0; i < contactCount; i++) {
+        if (prIsContactRemoved(w, &entries[i])) continue;
+
+        const int index1 = entries[i].first, index2 = entries[i].second;
+
+        prBody *b1 = w->bodies[index1], *b2 = w->bodies[index2];
+
+        // NOTE: An awake kinematic body also wakes up the bodies it touches.
+        if (prIsBodyAwake(b1) && prGetBodyInverseMass(b2) > 0.0f)
+            ci->roots[prFindIslandRoot(ci, index2)] = 1, awake = true;
+
+        if (prIsBodyAwake(b2) && prGetBodyInverseMass(b1) > 0.0f)
+            ci->roots[prFindIslandRoot(ci, index1)] = 1, awake = true;
+    }
+
+    if (!awake) return;
+
+    for (int i = 0; i < bodyCount; i++) {
+        prBody *b = w->bodies[i];
+
+        if (prIsBodySleeping(b) && ci->roots[prFindIslandRoot(ci, i)])
+            prSetBodySleeping(b, false);
+    }
+}
+
+/* Groups the contacts of `w` into islands that do not share any movable bodies. */
+static void prBuildContactIslands(prWorld *w) {
+    prContactIslands *ci = &w->islands;
+
+    const prBodyStorage *bs = &w->storage;
+
+    const prContactEntry *entries = w->contacts.entries;
+
+    const int contactCount = arrlen(entries);
+
+    // NOTE: Each island node is the body storage index of a body.
+    arrsetlen(ci->parents, bs->count), arrsetlen(ci->roots, bs->count);
+
+    for (int i = 0; i < bs->count; i++)
+        ci->parents[i] = i, ci->roots[i] = -1;
+
+    arrsetlen(ci->indexes, contactCount);
+
+    for (int i = 0; i < contactCount; i++) {
+        const int index1 = entries[i].first, index2 = entries[i].second;
+
+        /*
+            NOTE: The contacts of removed or sleeping bodies will not be solved,
+            and `prWakeContactIslands()` has already woken up every sleeping body
+            that touches an awake body, so no such contact is skipped here.
+        */
+        if (prIsContactRemoved(w, &entries[i]) || bs->sleeping[index1]
+            || bs->sleeping[index2]) {
+            ci->indexes[i] = -1;
+
+            continue;
+        }
+
+        // NOTE: Bodies with infinite mass are never modified by the solver.
+        int node1 = (bs->inverseMasses[index1] > 0.0f) ? index1 : -1;
+        int node2 = (bs->inverseMasses[index2] > 0.0f) ? index2 : -1;
+
+        ci->indexes[i] = (node1 >= 0) ? node1 : node2;
+
+        if (node1 < 0 || node2 < 0) continue;
+
+        node1 = prFindIslandRoot(ci, node1);
+        node2 = prFindIslandRoot(ci, node2);
+
+        if (node1 < node2) ci->parents[node2] = node1;
+        else if (node2 < node1) ci->parents[node1] = node2;
+    }
+
+    ci->count = 0;
+
+    arrsetlen(ci->offsets, 0);
+
+    /*
+        NOTE: Islands are numbered in the order of their first contact,
+        so the island order only depends on the order of the contact table.
+    */
+    for (int i = 0; i < contactCount; i++) {
+        if (ci->indexes[i] < 0) continue;
+
+        const int root = prFindIslandRoot(ci, ci->indexes[i]);
+
+        if (ci->roots[root] < 0) {
+            ci->roots[root] = ci->count++;
+
+            arrput(ci->offsets, 0);
+        }
+
+        ci->indexes[i] = ci->roots[root];
+
+        ci->offsets[ci->indexes[i]]++;
+    }
+
+    arrput(ci->offsets, 0);
+
+    for (int i = 0, offset = 0; i <= ci->count; i++) {
+        const int islandContactCount = ci->offsets[i];
+
+        ci->offsets[i] = offset, offset += islandContactCount;
+    }
+
+    arrsetlen(ci->contacts, ci->offsets[ci->count]);
+
+    // NOTE: The contacts in each island are kept in the order of the contact table.
+    for (int i = 0; i < contactCount; i++) {
+        if (ci->indexes[i] < 0) continue;
+
+        ci->contacts[ci->offsets[ci->indexes[i]]++] = i;
+    }
+
+    /*
+        NOTE: After the loop above, `ci->offsets[i]` points to the end of
+        the `i`-th island, which is the same as the start of the next island.
+    */
+    for (int i = ci->count; i > 0; i--)
+        ci->offsets[i] = ci->offsets[i - 1];
+
+    ci->offsets[0] = 0;
+}
+
+/* 
+    A callback function for `prRunThreadPool()` 
+    that solves each contact island in the range `[start, end)`.
+*/
+static void prSolveContactIslands(int start,
+                                  int end,
+                                  int threadIndex,
+                                  void *ctx) {
+    prSolveIslandsCtx *solveCtx = ctx;
+
+    prWorld *w = solveCtx->world;
+
+    const prContactIslands *ci = &w->islands;
+
+    int *iterationCount = &w->solver.iterationCounts[threadIndex];
+
+    for (int i = start; i < end; i++) {
+        // NOTE: Each island might converge after a different number of iterations.
+        const int count = prSolveContactConstraints(
+            &w->storage,
+            &w->constraints[ci->offsets[i]],
+            ci->offsets[i + 1] - ci->offsets[i],
+            solveCtx->iterationCount,
+            w->solver.tolerance,
+            solveCtx->inverseDt,
+            &w->solverBuffers[threadIndex]);
+
+        if (*iterationCount < count) *iterationCount = count;
+    }
+}
+
+/* 
+    Collects the contact constraints of `w` that need to be solved,
+    in the order of the contact islands of `w` (if they are solved separately).
+*/
+static void prBuildWorldConstraints(prWorld *w) {
+    prContactEntry *entries = w->contacts.entries;
+
+    const prContactIslands *ci = &w->islands;
+
+    const bool solvesIslands = prSolvesContactIslands(w);
+
+    /*
+        NOTE: The contacts between two bodies with infinite mass (or the contacts
+        of sleeping bodies) do not belong to any island, and they only need 
+        to reset the velocities of static bodies.
+    */
+    const bool useIslands = (solvesIslands || w->sleeping.enabled);
+
+    arrsetlen(w->constraints, 0);
+
+    for (int i = 0; i < arrlen(entries); i++) {
+        if (prIsContactRemoved(w, &entries[i])) continue;
+
+        if (useIslands && ci->indexes[i] < 0) {
+            prApplyAccumulatedImpulsesToStorage(&w->storage,
+                                                entries[i].first,
+                                                entries[i].second,
+                                                &entries[i].collision);
+
+            continue;
+        }
+
+        if (solvesIslands) continue;
+
+        arrput(w->constraints,
+               ((prContactConstraint) { .first = entries[i].first,
+                                        .second = entries[i].second,
+                                        .collision = &entries[i].collision }));
+    }
+
+    if (!solvesIslands) return;
+
+    // NOTE: The constraints of each island are stored next to each other.
+    arrsetlen(w->constraints, ci->offsets[ci->count]);
+
+    for (int i = 0; i < ci->offsets[ci->count]; i++) {
+        const int j = ci->contacts[i];
+
+        w->constraints[i] = (prContactConstraint) {
+            .first = entries[j].first,
+            .second = entries[j].second,
+            .collision = &entries[j].collision
+        };
+    }
+}
+
+/* 
+    A callback function for `prRunThreadPool()` that applies accumulated impulses
+    for each contact constraint in the range `[start, end)`.
+*/
+static void prWarmStartContactConstraints(int start,
+                                          int end,
+                                          int threadIndex,
+                                          void *ctx) {
+    prWorld *w = ctx;
+
+    /*
+        NOTE: With a thread pool, the contacts between two bodies with infinite mass
+        are handled by `prBuildWorldConstraints()`, so this only writes to 
+        the cache of each contact.
+    */
+    for (int i = start; i < end; i++)
+        prApplyAccumulatedImpulsesToStorage(&w->storage,
+                                            w->constraints[i].first,
+                                            w->constraints[i].second,
+                                            w->constraints[i].collision);
+}
+
+/* 
+    Solves the contact constraints of `w` with `iterationCount` iterations,
+    possibly on multiple threads.
+*/
+static void prSolveWorldConstraints(prWorld *w,
+                                    int iterationCount,
+                                    float inverseDt) {
+    if (!prSolvesContactIslands(w)) {
+        w->stats.iterationCount = prSolveContactConstraints(
+            &w->storage,
+            w->constraints,
+            arrlen(w->constraints),
+            iterationCount,
+            w->solver.tolerance,
+            inverseDt,
+            &w->solverBuffers[0]);
+
+        return;
+    }
+
+    for (int i = 0; i < w->threadCount; i++)
+        w->solver.iterationCounts[i] = 0;
+
+    /*
+        NOTE: Islands do not share any bodies that can be moved by the solver,
+        so solving them in parallel gives the same results as solving them in order,
+        and each island stops early by itself with or without a thread pool.
+    */
+    prRunThreadPool(w->pool,
+                    w->islands.count,
+                    prSolveContactIslands,
+                    &(prSolveIslandsCtx) { .world = w,
+                                           .iterationCount = iterationCount,
+                                           .inverseDt = inverseDt });
+
+    // NOTE: The step needed as many iterations as its slowest island.
+    w->stats.iterationCount = 0;
+
+    for (int i = 0; i < w->threadCount; i++)
+        if (w->stats.iterationCount < w->solver.iterationCounts[i])
+            w->stats.iterationCount = w->solver.iterationCounts[i];
+}
+
+/* 
+    Returns `true` if the contact islands of `w` are solved separately, 
+    which is the case with a thread pool or an early exit of the solver.
+*/
+static PR_API_INLINE bool prSolvesContactIslands(const prWorld *w) {
+    return w->pool != NULL || w->solver.tolerance > 0.0f;
+}
+
+/* Returns `true` if `b` is neither static nor sleeping. */
+static PR_API_INLINE bool prIsBodyAwake(const prBody *b) {
+    return prGetBodyType(b) != PR_BODY_STATIC && !prIsBodySleeping(b);
+}
+
+/* Returns `true` if the collision shape of `b` is a 'chain' collision shape. */
+static PR_API_INLINE bool prIsChainBody(const prBody *b) {
+    return prGetShapeType(prGetBodyShape(b)) == PR_SHAPE_CHAIN;
+}
+
+/* Returns `true` if the collision shape of `b` is a 'compound' collision shape. */
+static PR_API_INLINE bool prIsCompoundBody(const prBody *b) {
+    return prGetShapeType(prGetBodyShape(b)) == PR_SHAPE_COMPOUND;
+}
+
+/* 
+    Returns the AABB of the child of the collision shape of `b` at `index`,
+    which is the AABB of `b` unless `b` is a 'compound' body.
+*/
+static PR_API_INLINE prAABB prGetBodyChildAABB(const prBody *b, int index) {
+    if (!prIsCompoundBody(b)) return prGetBodyAABB(b);
+
+    const prShape *s = prGetBodyShape(b);
+
+    return prGetShapeAABB(
+        prGetCompoundChild(s, index),
+        prGetCompoundChildTransform(s, index, prGetBodyTransform(b)));
+}
+
+/* Puts each island of `w` to sleep if all of its bodies have been resting long enough. */
+static void prUpdateWorldSleepStates(prWorld *w, float dt) {
+    if (!w->sleeping.enabled) return;
+
+    prContactIslands *ci = &w->islands;
+
+    arrsetlen(ci->sleepTimes, ci->count);
+
+    for (int i = 0; i < ci->count; i++)
+        ci->sleepTimes[i] = FLT_MAX;
+
+    /*
+        NOTE: Bodies might have been added to `w` during the post-step callback,
+        and those bodies are not in the body storage of `w` yet.
+    */
+    for (int i = 0; i < arrlen(w->bodies); i++) {
+        prBody *b = w->bodies[i];
+
+        if (b == NULL) continue;
+
+        prUpdateBodySleepTime(b,
+                              dt,
+                              w->sleeping.linearThreshold,
+                              w->sleeping.angularThreshold);
+
+        if (!prIsBodyAwake(b) || i >= w->storage.count) continue;
+
+        const int island = ci->roots[prFindIslandRoot(ci, i)];
+
+        if (island < 0) continue;
+
+        ci->sleepTimes[island] = fminf(ci->sleepTimes[island],
+                                       prGetBodySleepTime(b));
+    }
+
+    // NOTE: An island can only fall asleep if all of its bodies are resting.
+    for (int i = 0; i < arrlen(w->bodies); i++) {
+        prBody *b = w->bodies[i];
+
+        if (b == NULL || !prIsBodyAwake(b) || i >= w->storage.count) continue;
+
+        const int island = ci->roots[prFindIslandRoot(ci, i)];
+
+        const float sleepTime = (island >= 0) ? ci->sleepTimes[island]
+                                              : prGetBodySleepTime(b);
+
+        if (sleepTime >= w->sleeping.timeToSleep) prSetBodySleeping(b, true);
+    }
+}
+
+/* 
+    Sweeps each fast-moving bullet of `w` from where it was at the start of 
+    the time step `dt`, sub-stepping it at each time of impact along the way.
+*/
+static void prUpdateWorldBullets(prWorld *w, float dt) {
+    bool updated = false;
+
+    for (int i = 0; i < arrlen(w->bodies); i++) {
+        prBody *b = w->bodies[i];
+
+        if (b == NULL || prGetBodyType(b) != PR_BODY_DYNAMIC
+            || !prIsBodyAwake(b))
+            continue;
+
+        // NOTE: A sensor body never stops at anything, even if it is a bullet.
+        const prBodyFlags flags = prGetBodyFlags(b);
+
+        if (!(flags & PR_FLAG_BULLET) || (flags & PR_FLAG_SENSOR)) continue;
+
+        const prShape *s = prGetBodyShape(b);
+
+        if (s == NULL) continue;
+
+        prVector2 velocity = prGetBodyVelocity(b);
+
+        const prAABB aabb = prGetBodyAABB(b);
+
+        /*
+            NOTE: A body that moves less than half of its smallest extent
+            in a single step cannot pass through anything.
+        */
+        if (prVector2Magnitude(velocity) * dt
+            <= 0.5f * fminf(aabb.width, aabb.height))
+            continue;
+
+        // NOTE: The broad phase still holds the AABBs from before the step.
+        if (!updated) prUpdateWorldBroadPhase(w), updated = true;
+
+        prTransform tx = prGetBodyTransform(b);
+
+        tx.position = prVector2Subtract(tx.position,
+                                        prVector2ScalarMultiply(velocity, dt));
+
+        float remainingTime = dt;
+
+        for (int j = 0; j < BULLET_MAX_SUBSTEP_COUNT; j++) {
+            const prVector2 translation = prVector2ScalarMultiply(velocity,
+                                                                  remainingTime);
+
+            const prAABB txAABB = prGetShapeAABB(s, tx);
+
+            prShapeCastHit hit = { .body = NULL };
+
+            prShapeCastHashQueryCtx queryCtx = { .world = w,
+                                                 .shape = s,
+                                                 .tx = tx,
+                                                 .aabb = txAABB,
+                                                 .translation = translation,
+                                                 .ignoredBody = b,
+                                                 .ignoresOverlaps = true,
+                                                 .hits = &hit,
+                                                 .capacity = 1 };
+
+            prQueryWorldBroadPhase(w,
+                                   prGetSweptAABB(txAABB, translation),
+                                   prShapeCastHashQueryCallback,
+                                   &queryCtx);
+
+            if (hit.body == NULL) {
+                tx.position = prVector2Add(tx.position, translation);
+
+                break;
+            }
+
+            const prVector2 position = tx.position;
+
+            prSetBodyPosition(
+                b,
+                prVector2Add(position,
+                             prVector2ScalarMultiply(translation,
+                                                     hit.fraction)));
+
+            prCollision collision = { .count = 0 };
+
+            // NOTE: The bullet is resolved against `hit.body` at the time of impact.
+            if (prComputeBodyCollision(b, hit.body, &collision)) {
+                prMixCollisionMaterials(&collision, b, hit.body);
+
+                if (prIsBodySleeping(hit.body))
+                    prSetBodySleeping(hit.body, false);
+
+                prApplyAccumulatedImpulses(b, hit.body, &collision);
+
+                for (int k = 0; k < w->solver.iterationCount; k++)
+                    prResolveCollision(b, hit.body, &collision, 1.0f / dt);
+
+                velocity = prGetBodyVelocity(b);
+            }
+
+            /*
+                NOTE: The next sub-step starts a little before the time of impact, 
+                so that the bullet does not keep hitting the same body.
+            */
+            const float backoff = PR_WORLD_BAUMGARTE_SLOP
+                                  / prVector2Magnitude(translation);
+
+            const float fraction = fmaxf(hit.fraction - backoff, 0.0f);
+
+            tx.position = prVector2Add(
+                position, prVector2ScalarMultiply(translation, fraction));
+
+            remainingTime *= 1.0f - hit.fraction;
+        }
+
+        prSetBodyPosition(b, tx.position);
+    }
+}
+
+/* 
+    Updates the broad-phase data structure of `w` only if it is out of date,
+    so that queries between two steps of `w` do not update it again.
+*/
+static void prRefreshWorldBroadPhase(prWorld *w) {
+    if (w->broadPhaseDirty) prUpdateWorldBroadPhase(w);
+}
+
+/* Updates the broad-phase data structure of `w` with the AABB of each body. */
+static void prUpdateWorldBroadPhase(prWorld *w) {
+    const bool persistent = (w->tree != NULL)
+                            || prIsSpatialHashPersistent(w->hash);
+
+    if (!persistent) prClearSpatialHash(w->hash);
+
+    for (int i = 0; i < arrlen(w->bodies); i++) {
+        if (w->bodies[i] == NULL) continue;
+
+        /*
+            NOTE: Static bodies (and 'chain' bodies) are only updated 
+            after they were explicitly moved, or their types or
+            collision shapes were changed.
+        */
+        if (prHasBodyMoved(w->bodies[i])) {
+            prUpdateWorldBroadPhaseForBody(w, i);
+
+            if (persistent) continue;
+        }
+
+        /*
+            NOTE: Sleeping bodies do not move, so they are already 
+            in the persistent broad-phase data structures.
+        */
+        if (persistent && !prIsBodyAwake(w->bodies[i])) continue;
+
+        /*
+            NOTE: 'Chain' bodies are usually huge static level geometry,
+            which would cover most of the broad-phase data structure, 
+            so they are kept in a separate list instead.
+        */
+        if (prIsChainBody(w->bodies[i])) continue;
+
+        /*
+            NOTE: In a persistent spatial hash or a dynamic tree, only the bodies 
+            that moved to different cells (or out of their enlarged AABBs)
+            will be updated.
+        */
+        if (w->tree != NULL) {
+            if (prUpdateDynamicTree(w->tree, prGetBodyAABB(w->bodies[i]), i))
+                prMarkWorldTreeMove(w, i);
+        } else {
+            prUpdateSpatialHash(w->hash, prGetBodyAABB(w->bodies[i]), i);
+        }
+    }
+
+    w->broadPhaseDirty = false;
+}
+
+/* 
+    Updates the broad-phase data structure of `w` with the AABB
+    of the body with the given `index` (if the data structure is persistent),
+    or the list of 'chain' bodies of `w` if the body is a 'chain' body.
+*/
+static void prUpdateWorldBroadPhaseForBody(prWorld *w, int index) {
+    prSetBodyMoved(w->bodies[index], false);
+
+    const int position = prFindWorldChain(w, index);
+
+    // NOTE: The collision shape of the body might have become a 'chain' collision shape.
+    if (prIsChainBody(w->bodies[index])) {
+        if (position < arrlen(w->chains) && w->chains[position] == index) return;
+
+        prRemoveFromWorldBroadPhase(w, index);
+
+        arrins(w->chains, position, index);
+
+        return;
+    }
+
+    if (position < arrlen(w->chains) && w->chains[position] == index)
+        arrdel(w->chains, position);
+
+    if (w->tree != NULL) {
+        if (prUpdateDynamicTree(w->tree, prGetBodyAABB(w->bodies[index]), index))
+            prMarkWorldTreeMove(w, index);
+    } else if (prIsSpatialHashPersistent(w->hash))
+        prUpdateSpatialHash(w->hash, prGetBodyAABB(w->bodies[index]), index);
+}
+
+/* 
+    Removes the body with the given `index` from the broad-phase data structure 
+    of `w` (or from the list of 'chain' bodies of `w`).
+*/
+static void prRemoveFromWorldBroadPhase(prWorld *w, int index) {
+    const int position = prFindWorldChain(w, index);
+
+    if (position < arrlen(w->chains) && w->chains[position] == index)
+        arrdel(w->chains, position);
+
+    if (w->tree != NULL) {
+        prRemoveFromDynamicTree(w->tree, index);
+
+        // NOTE: The tree pairs of the removed body will be dropped in the next step.
+        prMarkWorldTreeMove(w, index);
+    } else {
+        prRemoveFromSpatialHash(w->hash, index);
+    }
+}
+
+/* 
+    Returns the position of the first 'chain' body in `w` 
+    whose index is not less than `index`.
+*/
+static int prFindWorldChain(const prWorld *w, int index) {
+    // NOTE: The list of 'chain' bodies is sorted by their indexes.
+    int low = 0, high = arrlen(w->chains);
+
+    while (low < high) {
+        const int middle = low + ((high - low) / 2);
+
+        if (w->chains[middle] < index) low = middle + 1;
+        else high = middle;
+    }
+
+    return low;
+}
+
+/* 
+    Adds the body with the given `index` to the move buffer of the dynamic tree of `w`,
+    after its enlarged AABB changed (or it was removed from the tree).
+*/
+static void prMarkWorldTreeMove(prWorld *w, int index) {
+    while (arrlen(w->treePairs.moved) <= index)
+        arrput(w->treePairs.moved, false);
+
+    if (w->treePairs.moved[index]) return;
+
+    w->treePairs.moved[index] = true;
+
+    arrput(w->treePairs.moveBuffer, index);
+}
+
+/* 
+    Updates the pairs of bodies whose enlarged AABBs overlap in the dynamic tree
+    of `w` by querying the tree only for the bodies in the move buffer, 
+    then finds the candidate pairs of `w` among those pairs.
+*/
+static void prFindTreePairs(prWorld *w) {
+    prTreePair *pairs = w->treePairs.pairs;
+
+    const bool *moved = w->treePairs.moved;
+
+    int count = 0;
+
+    /*
+        NOTE: The enlarged AABBs of two bodies that did not move still overlap,
+        and the pairs of the bodies that moved will be found again below.
+    */
+    for (int i = 0; i < arrlen(pairs); i++)
+        if (!moved[pairs[i].first] && !moved[pairs[i].second])
+            pairs[count++] = pairs[i];
+
+    arrsetlen(w->treePairs.pairs, count);
+
+    for (int i = 0; i < arrlen(w->treePairs.moveBuffer); i++) {
+        const int index = w->treePairs.moveBuffer[i];
+
+        if (w->bodies[index] == NULL) continue;
+
+        prQueryDynamicTree(w->tree,
+                           prGetDynamicTreeAABB(w->tree, index),
+                           prPreStepHashQueryCallback,
+                           &(prPreStepHashQueryCtx) { .world = w,
+                                                      .bodyIndex = index });
+    }
+
+    for (int i = 0; i < arrlen(w->treePairs.moveBuffer); i++)
+        w->treePairs.moved[w->treePairs.moveBuffer[i]] = false;
+
+    arrsetlen(w->treePairs.moveBuffer, 0);
+
+    // NOTE: Only the pairs whose actual AABBs overlap reach the narrow phase.
+    for (int i = 0; i < arrlen(w->treePairs.pairs); i++) {
+        const prTreePair pair = w->treePairs.pairs[i];
+
+        if (!prAABBsOverlap(prGetBodyAABB(w->bodies[pair.first]),
+                            prGetBodyAABB(w->bodies[pair.second])))
+            continue;
+
+        prPreStepHashPairQueryCallback(pair.first, pair.second, w);
+    }
+}
+
+/* 
+    Finds the candidate pairs of each 'chain' body in `w`, 
+    one for each line segment that the AABB of another body overlaps.
+*/
+static void prFindChainPairs(prWorld *w) {
+    if (arrlen(w->chains) <= 0) return;
+
+    prContactTable *ct = &w->contacts;
+
+    /*
+        NOTE: A sleeping body cannot start or stop touching a 'chain' body,
+        so it never queries the chains, and its contacts with them are kept as is.
+    */
+    for (int i = 0; i < arrlen(ct->entries); i++) {
+        prContactEntry *entry = &ct->entries[i];
+
+        if (prIsContactRemoved(w, entry)) continue;
+
+        const prBody *b1 = w->bodies[entry->first];
+        const prBody *b2 = w->bodies[entry->second];
+
+        if ((prIsChainBody(b1) && !prIsBodyAwake(b2))
+            || (prIsChainBody(b2) && !prIsBodyAwake(b1)))
+            entry->generation = ct->generation;
+    }
+
+    /*
+        NOTE: The loop is driven by the awake bodies rather than by the cells 
+        that a (possibly huge) chain covers, so a level of resting bodies 
+        costs almost nothing, however large its chains are.
+    */
+    for (int i = 0; i < arrlen(w->slots.dense); i++) {
+        const int bodyIndex = w->slots.dense[i];
+
+        const prBody *b = w->bodies[bodyIndex];
+
+        if (!prIsBodyAwake(b) || prIsChainBody(b)) continue;
+
+        for (int j = 0; j < arrlen(w->chains); j++)
+            prAddChainPairs(w, bodyIndex, w->chains[j]);
+    }
+}
+
+/* 
+    Finds all pairs of bodies in `w` that are colliding, 
+    then updates the contact table of `w`.
+*/
+static void prPreStepWorld(prWorld *w) {
+    double lastTime = 0.0;
+
+    PR_API_STATS(lastTime = prGetCurrentTime());
+
+    prUpdateWorldBroadPhase(w);
+
+    // NOTE: Each contact found (or kept) in this step will have the new generation.
+    w->contacts.generation++, w->sensors.overlaps.generation++;
+
+    // NOTE: There are usually about as many pairs in this step as in the last step.
+    prReserveSeparatingAxes(w, arrlen(w->pairs));
+
+    arrsetlen(w->pairs, 0);
+
+    if (w->tree == NULL) {
+        // NOTE: Each pair of bodies will be reported only once!
+        prQuerySpatialHashPairs(w->hash, prPreStepHashPairQueryCallback, w);
+    } else {
+        prFindTreePairs(w);
+    }
+
+    prFindChainPairs(w);
+
+    /*
+        NOTE: The new contacts are sorted by `prMergeCandidatePairs()` anyway,
+        but sorting all pairs also keeps the separating axes of `w` independent
+        of the order of the updates to the broad phase.
+    */
+    if (w->deterministic && arrlen(w->pairs) > 1)
+        qsort(w->pairs,
+              arrlen(w->pairs),
+              sizeof *w->pairs,
+              prCompareCandidatePairs);
+
+    PR_API_STATS(w->stats.candidatePairCount = arrlen(w->pairs));
+
+    prRecordWorldPhaseTime(&w->stats.broadPhaseTime, &lastTime);
+
+    prRunThreadPool(w->pool, arrlen(w->pairs), prComputeCandidatePairs, w);
+
+    /*
+        NOTE: The contact table is updated in the same order as the candidate pairs,
+        so the results do not depend on the number of threads.
+    */
+    prMergeCandidatePairs(w);
+
+    // NOTE: The contacts of the removed bodies were swept by the line above.
+    prRecycleWorldSlots(w);
+
+    PR_API_STATS(w->stats.contactCount = arrlen(w->contacts.entries));
+
+    prRecordWorldPhaseTime(&w->stats.narrowPhaseTime, &lastTime);
+}
+
+/* Copies the contacts of `w` to the contiguous array returned by `prGetWorldContacts()`. */
+static void prExportWorldContacts(prWorld *w) {
+    const prAllocator *allocator = prSetCurrentAllocator(&w->allocator);
+
+    arrsetlen(w->exports.contacts, 0);
+
+    for (int i = 0; i < arrlen(w->contacts.entries); i++) {
+        const prContactEntry *entry = &w->contacts.entries[i];
+
+        // NOTE: Some of the bodies might have been removed since the last step.
+        if (prIsContactRemoved(w, entry)) continue;
+
+        const prCollision *collision = &entry->collision;
+
+        prContactInfo contact = {
+            .first = { .index = entry->first,
+                       .generation = w->slots.generations[entry->first] },
+            .second = { .index = entry->second,
+                        .generation = w->slots.generations[entry->second] },
+            .normal = collision->direction,
+            .count = collision->count
+        };
+
+        for (int j = 0; j < collision->count; j++) {
+            contact.points[j].point = collision->contacts[j].point;
+            contact.points[j].depth = collision->contacts[j].depth;
+
+            contact.points[j].normalImpulse = collision->contacts[j]
+                                                  .cache.normalScalar;
+            contact.points[j].tangentImpulse = collision->contacts[j]
+                                                   .cache.tangentScalar;
+        }
+
+        arrput(w->exports.contacts, contact);
+    }
+
+    w->exports.contactsDirty = false;
+
+    prSetCurrentAllocator(allocator);
+}
+
+/* 
+    Copies the handles and the transforms of the bodies in `w` 
+    to the contiguous arrays returned by `prGetWorldTransforms()`.
+*/
+static void prExportWorldTransforms(prWorld *w) {
+    const prAllocator *allocator = prSetCurrentAllocator(&w->allocator);
+
+    const int bodyCount = arrlen(w->slots.dense);
+
+    arrsetlen(w->exports.handles, bodyCount);
+    arrsetlen(w->exports.transforms, bodyCount);
+
+    for (int i = 0; i < bodyCount; i++) {
+        const int index = w->slots.dense[i];
+
+        w->exports.handles[i] = (prBodyHandle) {
+            .index = index, .generation = w->slots.generations[index]
+        };
+
+        w->exports.transforms[i] = prGetBodyTransform(w->bodies[index]);
+    }
+
+    w->exports.transformsDirty = false;
+
+    prSetCurrentAllocator(allocator);
+}
+
+/* 
+    Clears the accumulated forces on each body in `w`, 
+    then marks the broad-phase data structure of `w` as out of date.
+*/
+static void prPostStepWorld(prWorld *w) {
+    for (int i = 0; i < arrlen(w->slots.dense); i++)
+        prClearBodyForces(w->bodies[w->slots.dense[i]]);
+
+    /*
+        NOTE: The bodies have moved since the start of the step, so the first
+        query after the step updates the broad phase (a spatial hash that is
+        not persistent is only cleared when it is rebuilt).
+    */
+    w->broadPhaseDirty = true;
+}
+
+/* 
+    Proceeds the simulation of `w` over the time step `dt`, in seconds,
+    with `iterationCount` iterations of the constraint solver.
+*/
+static void prStepWorldWithIterations(prWorld *w,
+                                      float dt,
+                                      int iterationCount) {
+    // NOTE: All new memory for `w` comes from its own allocator.
+    const prAllocator *allocator = prSetCurrentAllocator(&w->allocator);
+
+    size_t allocationCount = 0, hashCellCount = 0;
+
+    // NOTE: The stats of `w` only cover its last step (or sub-step).
+    PR_API_STATS(w->stats = PR_API_STRUCT_ZERO(prWorldStats),
+                 allocationCount = prGetWorldAllocationCount(w),
+                 hashCellCount = prGetSpatialHashTouchCount(w->hash));
+
+    prPreStepWorld(w);
+
+    prRunWorldCollisionEvents(w, w->handler.preStep);
+
+    double lastTime = 0.0;
+
+    PR_API_STATS(lastTime = prGetCurrentTime());
+
+    // NOTE: The bodies woken up so far must wake up the rest of their islands.
+    prWakeContactIslands(w);
+
+    /*
+        NOTE: The integration and the constraint solver only work on 
+        the contiguous arrays of the body storage, not on the bodies themselves.
+    */
+    prLoadWorldBodies(w);
+
+    prIntegrateBodyStorageVelocities(&w->storage, w->gravity, dt);
+
+    prRecordWorldPhaseTime(&w->stats.integrateTime, &lastTime);
+
+    // NOTE: The contact islands are needed for the island solver and for sleeping.
+    if (prSolvesContactIslands(w) || w->sleeping.enabled)
+        prBuildContactIslands(w);
+
+    prBuildWorldConstraints(w);
+
+    prRunThreadPool(w->pool,
+                    arrlen(w->constraints),
+                    prWarmStartContactConstraints,
+                    w);
+
+    prRecordWorldPhaseTime(&w->stats.warmStartTime, &lastTime);
+
+    prSolveWorldConstraints(w, iterationCount, 1.0f / dt);
+
+    prRecordWorldPhaseTime(&w->stats.solveTime, &lastTime);
+
+    prIntegrateBodyStoragePositions(&w->storage, dt);
+
+    prStoreWorldBodies(w);
+
+    // NOTE: Only bullets are swept, so nothing else pays for the sub-steps.
+    prUpdateWorldBullets(w, dt);
+
+    prRecordWorldPhaseTime(&w->stats.integrateTime, &lastTime);
+
+    prRunWorldCollisionEvents(w, w->handler.postStep);
+
+    prUpdateWorldSleepStates(w, dt);
+
+    PR_API_STATS(w->stats.hashCellCount = prGetSpatialHashTouchCount(w->hash)
+                                          - hashCellCount);
+
+    // NOTE: The contacts and the transforms of `w` are only exported on demand.
+    w->exports.contactsDirty = w->exports.transformsDirty = true;
+
+    prPostStepWorld(w);
+
+    // NOTE: This also counts the allocations made by the event handlers of `w`.
+    PR_API_STATS(w->stats.allocationCount = prGetWorldAllocationCount(w)
+                                            - allocationCount);
+
+    prSetCurrentAllocator(allocator);
+}
+
+/* 
+    Adds the time elapsed since `*lastTime` to `*phaseTime`, then updates
+    `*lastTime` to the current time (unless `PR_DISABLE_STATS` is defined).
+*/
+static PR_API_INLINE void prRecordWorldPhaseTime(double *phaseTime,
+                                                 double *lastTime) {
+#ifndef PR_DISABLE_STATS
+    const double time = prGetCurrentTime();
+
+    *phaseTime += time - *lastTime, *lastTime = time;
+#endif
+}
+
+/* 
+    Returns the number of blocks allocated (or resized) so far on the calling thread
+    and on the worker threads of `w`.
+*/
+static PR_API_INLINE size_t prGetWorldAllocationCount(const prWorld *w) {
+    return prGetAllocationCount() + prGetThreadPoolAllocationCount(w->pool);
+}
+
+/* 
+    A callback function for `prRunThreadPoolWithBatchSize()` 
+    that steps each world in the range `[start, end)`.
+*/
+static void prStepWorldsCallback(int start,
+                                 int end,
+                                 int threadIndex,
+                                 void *ctx) {
+    prStepWorldsCtx *stepCtx = ctx;
+
+    for (int i = start; i < end; i++)
+        prStepWorld(stepCtx->worlds[i], stepCtx->dt);
+}
+
+/* 
+    Writes the state of `w` to `buffer` if it has at least `size` bytes,
+    skipping the bodies that did not change from the `base` state (if any),
+    then returns the size of the state.
+*/
+static size_t prWriteWorldState(const prWorld *w,
+                                const unsigned char *base,
+                                void *buffer,
+                                size_t size) {
+    prWorldStateHeader baseHeader = { .bodyCount = 0 };
+
+    const unsigned char *baseBodies = NULL;
+
+    if (base != NULL) {
+        memcpy(&baseHeader, base, sizeof baseHeader);
+
+        baseBodies = base + sizeof baseHeader;
+    }
+
+    const prContactTable *ct = &w->contacts, *ot = &w->sensors.overlaps;
+
+    prWorldStateHeader header = {
+        .magic = WORLD_STATE_MAGIC,
+        .version = WORLD_STATE_VERSION,
+        .flags = (base != NULL) ? WORLD_STATE_FLAG_DELTA : 0u,
+        .contactCount = arrlen(ct->entries),
+        .overlapCount = arrlen(ot->entries),
+        .contactGeneration = ct->generation,
+        .overlapGeneration = ot->generation,
+        .accumulator = w->update.accumulator,
+        .alpha = w->update.alpha,
+        .reserved1 = 0u,
+        .reserved2 = 0u
+    };
+
+    /*
+        NOTE: The bodies are counted in the first pass and written in the second pass,
+        always in the order of their slots (which is also the order in `base`).
+    */
+    for (int pass = 0; pass < 2; pass++) {
+        unsigned char *bodies = (unsigned char *) buffer + sizeof header;
+
+        uint32_t count = 0, baseIndex = 0;
+
+        for (int i = 0; i < arrlen(w->bodies); i++) {
+            if (w->bodies[i] == NULL) continue;
+
+            const prWorldStateBody body = {
+                .index = i,
+                .generation = w->slots.generations[i],
+                .state = prGetBodyState(w->bodies[i])
+            };
+
+            prWorldStateBody baseBody = { .index = UINT32_MAX };
+
+            for (; baseIndex < baseHeader.bodyCount; baseIndex++) {
+                memcpy(&baseBody,
+                       baseBodies + baseIndex * sizeof baseBody,
+                       sizeof baseBody);
+
+                if (baseBody.index >= body.index) break;
+            }
+
+            if (baseIndex < baseHeader.bodyCount
+                && memcmp(&baseBody, &body, sizeof body) == 0)
+                continue;
+
+            if (pass > 0) memcpy(bodies + count * sizeof body, &body, sizeof body);
+
+            count++;
+        }
+
+        if (pass > 0) break;
+
+        header.bodyCount = count;
+
+        const size_t result = sizeof header
+                              + header.bodyCount * sizeof(prWorldStateBody)
+                              + (header.contactCount + header.overlapCount)
+                                    * sizeof(prContactEntry);
+
+        if (buffer == NULL || size < result) return result;
+    }
+
+    unsigned char *contacts = (unsigned char *) buffer + sizeof header
+                              + header.bodyCount * sizeof(prWorldStateBody);
+
+    memcpy(buffer, &header, sizeof header);
+
+    if (header.contactCount > 0)
+        memcpy(contacts, ct->entries, header.contactCount * sizeof *ct->entries);
+
+    if (header.overlapCount > 0)
+        memcpy(contacts + header.contactCount * sizeof *ct->entries,
+               ot->entries,
+               header.overlapCount * sizeof *ot->entries);
+
+    return sizeof header + header.bodyCount * sizeof(prWorldStateBody)
+           + (header.contactCount + header.overlapCount)
+                 * sizeof(prContactEntry);
+}
+
+/* 
+    Reads the header of the state in `buffer` to `header`, 
+    then returns `true` if the state is valid and fits in `size` bytes.
+*/
+static bool prReadWorldStateHeader(const void *buffer,
+                                   size_t size,
+                                   prWorldStateHeader *header) {
+    if (buffer == NULL || size < sizeof *header) return false;
+
+    // NOTE: `buffer` might not be aligned for `prWorldStateHeader`.
+    memcpy(header, buffer, sizeof *header);
+
+    if (header->magic != WORLD_STATE_MAGIC
+        || header->version != WORLD_STATE_VERSION)
+        return false;
+
+    const uint64_t expectedSize = sizeof *header
+                                  + (uint64_t) header->bodyCount
+                                        * sizeof(prWorldStateBody)
+                                  + ((uint64_t) header->contactCount
+                                     + header->overlapCount)
+                                        * sizeof(prContactEntry);
+
+    return expectedSize <= size;
+}
+
+/* Returns `true` if the state in `buffer` can be restored to `w`. */
+static bool prCheckWorldState(const prWorld *w,
+                              const unsigned char *buffer,
+                              const prWorldStateHeader *header) {
+    const unsigned char *bodies = buffer + sizeof *header;
+
+    for (uint32_t i = 0; i < header->bodyCount; i++) {
+        prWorldStateBody body;
+
+        memcpy(&body, bodies + i * sizeof body, sizeof body);
+
+        // NOTE: Each body must still be in the same slot as when it was saved.
+        if (body.index >= (uint32_t) arrlen(w->bodies)
+            || w->bodies[body.index] == NULL
+            || w->slots.generations[body.index] != body.generation)
+            return false;
+    }
+
+    const unsigned char *contacts = bodies
+                                    + header->bodyCount
+                                          * sizeof(prWorldStateBody);
+
+    for (uint32_t i = 0; i < header->contactCount + header->overlapCount; i++) {
+        prContactEntry entry;
+
+        memcpy(&entry, contacts + i * sizeof entry, sizeof entry);
+
+        if (entry.first < 0 || entry.first >= arrlen(w->bodies)
+            || entry.second < 0 || entry.second >= arrlen(w->bodies)
+            || entry.child < -1)
+            return false;
+    }
+
+    return true;
+}
+
+/* Restores the bodies of `w` from the state in `buffer`. */
+static void prLoadWorldStateBodies(prWorld *w,
+                                   const unsigned char *buffer,
+                                   const prWorldStateHeader *header) {
+    const unsigned char *bodies = buffer + sizeof *header;
+
+    for (uint32_t i = 0; i < header->bodyCount; i++) {
+        prWorldStateBody body;
+
+        memcpy(&body, bodies + i * sizeof body, sizeof body);
+
+        prSetBodyState(w->bodies[body.index], body.state);
+
+        // NOTE: Even sleeping bodies might have moved in the broad phase.
+        prUpdateWorldBroadPhaseForBody(w, body.index);
+    }
+}
+
+/* Restores the contact cache and the sensor overlaps of `w` from the state in `buffer`. */
+static void prLoadWorldStateContacts(prWorld *w,
+                                     const unsigned char *buffer,
+                                     const prWorldStateHeader *header) {
+    const unsigned char *contacts = buffer + sizeof *header
+                                    + header->bodyCount
+                                          * sizeof(prWorldStateBody);
+
+    prContactTable *ct = &w->contacts, *ot = &w->sensors.overlaps;
+
+    arrsetlen(ct->entries, header->contactCount);
+    arrsetlen(ot->entries, header->overlapCount);
+
+    if (header->contactCount > 0)
+        memcpy(ct->entries, contacts, header->contactCount * sizeof *ct->entries);
+
+    if (header->overlapCount > 0)
+        memcpy(ot->entries,
+               contacts + header->contactCount * sizeof *ct->entries,
+               header->overlapCount * sizeof *ot->entries);
+
+    ct->generation = header->contactGeneration;
+    ot->generation = header->overlapGeneration;
+
+    // NOTE: The order of the contacts is restored as well, which keeps the solver exact.
+    prRebuildContactTable(ct), prRebuildContactTable(ot);
+}